@@ -0,0 +1,291 @@
+// Runs the simulation without a window, for performance regression jobs on machines without a display.
+// Loads a LAS file, builds the terrain, drops bodies on it and steps the world a fixed number of ticks.
+#include "World.h"
+#include "objects/surface/PointCloud.h"
+#include "objects/curves/BSplineSurface.h"
+#include "objects/curves/BSpline.h"
+#include "objects/primitives/IcoSphere.h"
+#include "ecs/components/physics.h"
+#include "ecs/components/transform.h"
+#include "ecs/system/physics.h"
+#include "ecs/system/collision.h"
+#include "threading/ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct HeadlessOptions
+{
+    std::string las_path = "./pointcloud/Medium.las";
+    // Size of the generated terrain, 0 to load the LAS file instead
+    unsigned grid = 0;
+    unsigned bodies = 1000;
+    unsigned ticks = 600;
+    unsigned seed = 1;
+    float radius = 0.5f;
+    // Height of the band above the terrain the bodies are dropped from
+    float spawn_height = 20.0f;
+    bool parallel = true;
+    // Threads stepping the world including the calling thread, 0 for the global pool
+    unsigned threads = 0;
+    bool exact_terrain = false;
+    bool hash = false;
+    bool help = false;
+};
+
+void print_usage(const char* program)
+{
+    std::printf("Usage: %s [options]\n"
+        "  --las <path>       Point cloud the terrain is built from (default ./pointcloud/Medium.las)\n"
+        "  --grid <n>         Generate an n by n terrain instead of loading a point cloud\n"
+        "  --bodies <n>       Number of spheres dropped on the terrain (default 1000)\n"
+        "  --ticks <n>        Number of fixed steps to run (default 600)\n"
+        "  --seed <n>         Seed of the spawn positions (default 1)\n"
+        "  --radius <r>       Radius of the spheres (default 0.5)\n"
+        "  --spawn-height <h> Height of the band above the terrain the spheres start in (default 20)\n"
+        "  --sequential       Run the systems one after another on the calling thread\n"
+        "  --threads <n>      Step the world on n threads, the calling thread included (default every hardware thread)\n"
+        "  --exact-terrain    Test terrain contacts against the B-spline surface instead of its mesh\n"
+        "  --hash             Print a hash of the final body state\n"
+        "  -h, --help         Print this list and exit\n", program);
+}
+
+bool parse_options(int argc, char** argv, HeadlessOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--las" && has_value)
+            options.las_path = argv[++i];
+        else if (arg == "--grid" && has_value)
+            options.grid = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--bodies" && has_value)
+            options.bodies = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--ticks" && has_value)
+            options.ticks = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--seed" && has_value)
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--radius" && has_value)
+            options.radius = std::strtof(argv[++i], nullptr);
+        else if (arg == "--spawn-height" && has_value)
+            options.spawn_height = std::strtof(argv[++i], nullptr);
+        else if (arg == "--sequential")
+            options.parallel = false;
+        else if (arg == "--threads" && has_value)
+            options.threads = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--exact-terrain")
+            options.exact_terrain = true;
+        else if (arg == "--hash")
+            options.hash = true;
+        else if (arg == "--help" || arg == "-h")
+            options.help = true;
+        else
+            return false;
+    }
+    return true;
+}
+
+// std::uniform_real_distribution differs between standard libraries, the raw mt19937 output does not,
+// so the spawn positions and with them the hash are the same on every platform
+float random_unit(std::mt19937& rng)
+{
+    return float(rng() >> 8) / 16777216.0f;
+}
+
+void hash_bytes(uint64_t& hash, const void* data, size_t size)
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+/// @brief FNV-1a over the position and velocity of every body in ECS order
+uint64_t hash_state(World* world)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto bodies = world->get_ecs()->get<PhysicsComponent>();
+    auto transforms = world->get_ecs()->get<TransformComponent>();
+    if (bodies == nullptr || transforms == nullptr)
+        return hash;
+    for (unsigned slot = 0; slot < unsigned(bodies->get_size()); slot++)
+    {
+        auto transform = transforms->get(bodies->get_entity(slot));
+        if (transform == nullptr)
+            continue;
+        auto velocity = bodies->get_velocity(slot);
+        hash_bytes(hash, &transform->position, sizeof(transform->position));
+        hash_bytes(hash, &velocity, sizeof(velocity));
+    }
+    return hash;
+}
+
+/// @brief Builds rolling hills on an n by n grid of control points one unit apart, the same terrain on every machine
+GameObject* generate_surface(unsigned size)
+{
+    std::vector<glm::vec3> points;
+    points.reserve(size * size);
+    for (unsigned z = 0; z < size; z++)
+    {
+        for (unsigned x = 0; x < size; x++)
+        {
+            float height = 5.0f * std::sin(x * 0.05f) * std::cos(z * 0.07f) + 2.0f * std::sin(x * 0.21f + z * 0.13f);
+            points.push_back(glm::vec3(float(x), height, float(z)));
+        }
+    }
+    auto knot_vector = BSpline<glm::vec3>::get_knot_vector(size - 1);
+    return new BSplineSurface(2, 2, size, size, knot_vector, knot_vector, points, 0.5f);
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    HeadlessOptions options;
+    if (!parse_options(argc, argv, options))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (options.help)
+    {
+        print_usage(argv[0]);
+        return 0;
+    }
+
+    // Declared before the world so the workers outlive the systems using them
+    std::unique_ptr<ThreadPool> pool;
+    auto world = new World();
+    world->register_system(new PhysicsSystem(world->get_ecs(), world));
+    auto collisionSystem = new CollisionSystem(world->get_ecs(), world);
+    collisionSystem->set_terrain_query(options.exact_terrain ? TERRAIN_EXACT : TERRAIN_MESH);
+    world->register_system(collisionSystem);
+    world->get_scheduler()->set_parallel(options.parallel);
+    if (options.threads > 0)
+    {
+        pool = std::make_unique<ThreadPool>(options.threads - 1);
+        world->get_scheduler()->set_pool(pool.get());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    GameObject* bsplineSurface;
+    double load_ms = 0.0;
+    double surface_ms;
+    if (options.grid > 0)
+    {
+        bsplineSurface = generate_surface(std::max(options.grid, 3u));
+        surface_ms = elapsed_ms(start);
+    }
+    else
+    {
+        PointCloud* pointCloud;
+        try
+        {
+            pointCloud = new PointCloud(options.las_path.c_str());
+        }
+        catch (const std::exception& e)
+        {
+            std::fprintf(stderr, "Failed to load %s: %s\n", options.las_path.c_str(), e.what());
+            return 1;
+        }
+        load_ms = elapsed_ms(start);
+        start = std::chrono::steady_clock::now();
+        bsplineSurface = pointCloud->convert_to_surface();
+        delete pointCloud;
+        surface_ms = elapsed_ms(start);
+    }
+
+    world->insert(bsplineSurface);
+    auto min = glm::vec3(FLT_MAX);
+    auto max = glm::vec3(-FLT_MAX);
+    for (auto& vertex : bsplineSurface->get_vertices())
+    {
+        min = glm::min(min, vertex.position);
+        max = glm::max(max, vertex.position);
+    }
+    // The bodies start above the terrain, the bounds grow to hold them
+    auto spawn_min = max.y + options.radius;
+    max.y = spawn_min + options.spawn_height + options.radius;
+    world->set_bounds((min + max) / 2.0f, (max - min) / 2.0f);
+    bsplineSurface->get_component<TransformComponent>()->set_position(glm::vec3(0.0001f));
+    world->set_surface_id(bsplineSurface->get_entity());
+
+    std::mt19937 rng(options.seed);
+    for (unsigned i = 0; i < options.bodies; i++)
+    {
+        glm::vec3 position;
+        position.x = min.x + options.radius + random_unit(rng) * (max.x - min.x - 2 * options.radius);
+        position.z = min.z + options.radius + random_unit(rng) * (max.z - min.z - 2 * options.radius);
+        position.y = spawn_min + random_unit(rng) * options.spawn_height;
+        auto sphere = new IcoSphere();
+        world->insert(sphere, position, glm::vec3(options.radius));
+        world->get_ecs()->insert<PhysicsComponent>(sphere->get_entity(), PhysicsComponent());
+    }
+
+    auto terrain_name = options.grid > 0 ? "generated " + std::to_string(options.grid) + "x" + std::to_string(options.grid) : options.las_path;
+    std::printf("terrain: %s, load %.1f ms, surface %.1f ms, %zu vertices\n", terrain_name.c_str(), load_ms, surface_ms,
+        bsplineSurface->get_vertices().size());
+    std::printf("bodies: %u, ticks: %u, seed: %u, %s on %u threads, %s terrain\n", options.bodies, options.ticks, options.seed,
+        options.parallel ? "parallel" : "sequential", pool != nullptr ? pool->get_concurrency() : ThreadPool::get_global().get_concurrency(),
+        options.exact_terrain ? "exact" : "mesh");
+
+    auto delta_time = static_cast<float>(world->get_fixed_delta_time());
+    std::vector<double> tick_ms(options.ticks);
+    std::vector<double> system_ms;
+    std::vector<const char*> system_names;
+    start = std::chrono::steady_clock::now();
+    for (unsigned tick = 0; tick < options.ticks; tick++)
+    {
+        auto tick_start = std::chrono::steady_clock::now();
+        world->update(delta_time);
+        tick_ms[tick] = elapsed_ms(tick_start);
+
+        auto& timings = world->get_scheduler()->get_timings();
+        system_ms.resize(timings.size());
+        system_names.resize(timings.size());
+        for (size_t i = 0; i < timings.size(); i++)
+        {
+            system_ms[i] += timings[i].milliseconds;
+            system_names[i] = timings[i].name;
+        }
+    }
+    auto total_ms = elapsed_ms(start);
+
+    if (options.ticks > 0)
+    {
+        auto sorted = tick_ms;
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&sorted](double p) { return sorted[std::min(sorted.size() - 1, size_t(p * sorted.size()))]; };
+        std::printf("total: %.1f ms, tick mean %.3f ms, min %.3f, p50 %.3f, p95 %.3f, max %.3f\n", total_ms,
+            total_ms / options.ticks, sorted.front(), percentile(0.5), percentile(0.95), sorted.back());
+        for (size_t i = 0; i < system_ms.size(); i++)
+            std::printf("  %-24s %.3f ms/tick\n", system_names[i], system_ms[i] / options.ticks);
+    }
+
+    std::vector<SystemStat> stats;
+    world->get_scheduler()->get_stats(stats);
+    for (auto& stat : stats)
+        std::printf("  %-24s %.*f\n", stat.name, stat.decimals, stat.value);
+
+    if (options.hash)
+        std::printf("hash: %016llx\n", static_cast<unsigned long long>(hash_state(world)));
+
+    delete world;
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdio>
+#include <functional>
+
+/// @brief Reports how far a long running load has come.
+/// The window shows the messages in its title, without a listener the reports are dropped.
+class Progress
+{
+private:
+    static inline std::function<void(const char*)> listener;
+
+public:
+    static void set_listener(std::function<void(const char*)> callback) { listener = std::move(callback); }
+
+    static void report(const char* message)
+    {
+        if (listener)
+            listener(message);
+    }
+
+    /// @brief Reports a stage with the percentage done, e.g. "Processing point cloud to surface: 42.00%"
+    static void report(const char* stage, float percent)
+    {
+        if (!listener)
+            return;
+        char message[128];
+        std::snprintf(message, sizeof(message), "%s: %.2f%%", stage, percent);
+        listener(message);
+    }
+};
\ No newline at end of file
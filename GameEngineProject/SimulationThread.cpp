@@ -0,0 +1,32 @@
+#include "SimulationThread.h"
+#include "World.h"
+#include <chrono>
+
+void SimulationThread::start()
+{
+    if (running)
+        return;
+    world->publish_snapshot();
+    running = true;
+    thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop()
+{
+    running = false;
+    if (thread.joinable())
+        thread.join();
+}
+
+void SimulationThread::run()
+{
+    auto last = std::chrono::steady_clock::now();
+    while (running)
+    {
+        auto now = std::chrono::steady_clock::now();
+        world->advance(std::chrono::duration<double>(now - last).count());
+        last = now;
+        // Commands posted meanwhile wait for the next step, they are not worth waking up early for
+        std::this_thread::sleep_for(std::chrono::duration<double>(world->get_time_to_next_step()));
+    }
+}
\ No newline at end of file
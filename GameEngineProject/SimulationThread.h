@@ -0,0 +1,32 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+class World;
+
+/// @brief Steps a world on its own thread so a frame takes as long as the slower of simulation and rendering instead of both.
+/// The thread steps the world whenever a fixed step is due and publishes a snapshot after, the render thread draws the
+/// newest snapshot and sends its changes to the world through World::post. Nothing else of the world may be touched while it runs.
+class SimulationThread
+{
+private:
+    World* world;
+    std::thread thread;
+    std::atomic<bool> running = false;
+
+    void run();
+
+public:
+    explicit SimulationThread(World* world) : world(world) {}
+    ~SimulationThread() { stop(); }
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    /// @brief Publishes a first snapshot and starts stepping
+    void start();
+    /// @brief Waits for the step in progress and stops, the world belongs to the calling thread again after
+    void stop();
+    bool is_running() const { return running; }
+};
\ No newline at end of file
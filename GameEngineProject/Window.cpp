@@ -11,6 +11,7 @@
 #include "objects/debugTools/Arrow.h"
 #include "colliders/SphereCollider.h"
 #include "World.h"
+#include "SimulationThread.h"
 #include <iostream>
 #include <algorithm>
 #include <imgui/imgui.h>
@@ -25,6 +26,8 @@
 #include "objects/curves/BSpline.h"
 #include "objects/curves/BSplineSurface.h"
 #include "objects/surface/PointCloud.h"
+#include "objects/surface/TileCache.h"
+#include "Progress.h"
 #include "objects/primitives/TrackedSphere.h"
 #include "Particle.h"
 #include "ecs/components/physics.h"
@@ -39,8 +42,6 @@ bool wireframe = false;
 bool mouseActive = false;
 bool drawDebug = false;
 double deltaTime = 0.0;
-double lastWorldUpdate = 0.0;
-constexpr double minDeltaTime = 1 / 60.0;
 float fps = 0.0f;
 float fpsAvg[100] = { 0 };
 std::chrono::time_point<std::chrono::high_resolution_clock> lastFrame = std::chrono::high_resolution_clock::now();
@@ -53,6 +54,19 @@ Frustum frustum;
 DrawCounts drawCounts;
 
 World* world;
+SimulationThread* simulation;
+// The snapshot this frame draws, held by the render thread until the next frame takes a newer one
+const WorldSnapshot* snapshot;
+CollisionSystem* collisionSystem;
+// The simulation settings edited in the panels, the changes are posted to the simulation thread
+bool parallelSystems = true;
+int maxSteps = 5;
+int broadphase = AABB_TREE;
+int terrainQuery = TERRAIN_EXACT;
+// Draws the terrain, only touched by the render thread
+TileCache* tileCache;
+TileCounts tileCounts;
+int tileBudget = TileCache::DEFAULT_MEMORY_BUDGET >> 20;
 Line* debugLine;
 Arrow* debugArrow;
 IcoSphere* debugSphere;
@@ -108,11 +122,15 @@ void spawn_on_position(glm::vec3 position, glm::vec3 scale, glm::vec4 color)
 	auto sphere = new TrackedSphere();
 	sphere->set_shader(ShaderStore::get_shader("default"));
 	sphere->set_material(new ColorMaterial(color));
-	world->insert(sphere, position, scale);
-	world->get_ecs()->insert<PhysicsComponent>(sphere->get_uuid(), new PhysicsComponent());
 	auto curve = sphere->get_track();
 	curve->set_shader(ShaderStore::get_shader("noLight"));
-	world->insert(curve);
+	// The world belongs to the simulation thread, the objects are built here and inserted before its next step
+	world->post([sphere, curve, position, scale]()
+		{
+			world->insert(sphere, position, scale);
+			world->get_ecs()->insert<PhysicsComponent>(sphere->get_entity(), PhysicsComponent());
+			world->insert(curve);
+		});
 }
 
 
@@ -197,7 +215,8 @@ int Window::init()
             light->diffuse = hsl(0, 0, 0.8f);
             light->specular = hsl(0, 0, 0.5f); });
     world->register_system(new PhysicsSystem(world->get_ecs(), world));
-    world->register_system(new CollisionSystem(world->get_ecs(), world));
+    collisionSystem = new CollisionSystem(world->get_ecs(), world);
+    world->register_system(collisionSystem);
 
     //Debugline, arrow and Sphere
     debugLine = new Line();
@@ -218,12 +237,14 @@ int Window::init()
     debugSphere->set_material(new ColorMaterial());
     debugSphere->attatch_to_world(world);
     debugSphere->register_ecs(world->get_ecs());
-    debugSphere->get_component<TransformComponent>()->set_scale(glm::vec3(.1f));
+    debugSphere->set_render_matrix(glm::scale(glm::mat4(1.0f), glm::vec3(.1f)));
     dynamic_cast<ColorMaterial*>(debugSphere->get_material())->color = glm::vec4(0.0f, 0.0f, 1.0f, 0.5f);
 
 
     //setting up pointcloud surface
     glfwSetWindowTitle(glfWindow, "Setting up point cloud surface");
+    Progress::set_listener([](const char* message)
+        { glfwSetWindowTitle(glfWindow, message); });
     auto pointCloud = new PointCloud("./pointcloud/Medium.las");
 
     //Uncomment this code and uncomment out everything 
@@ -233,27 +254,26 @@ int Window::init()
 	//world->insert(pointCloud);
 
     //B-spline Surface creation
-    auto bsplineSurface = pointCloud->convert_to_surface();
+    // The surface is not tessellated up front, the tile cache tessellates the tiles around the camera
+    auto bsplineSurface = dynamic_cast<BSplineSurface*>(pointCloud->convert_to_surface(false));
     delete pointCloud;
-    //bsplineSurface->set_shader(ShaderStore::get_shader("noLight"));
-    bsplineSurface->set_shader(ShaderStore::get_shader("default"));
-    bsplineSurface->set_material(new ColorMaterial());
-    dynamic_cast<ColorMaterial*>(bsplineSurface->get_material())->color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    tileCache = new TileCache(bsplineSurface, ShaderStore::get_shader("default"), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), size_t(tileBudget) << 20);
+    // The surface is only kept in the world for the terrain collisions, without its mesh they use the exact surface
     world->insert(bsplineSurface);
-    auto vertices = bsplineSurface->get_vertices();
-    auto min = glm::vec3(FLT_MAX);
-    auto max = glm::vec3(-FLT_MAX);
-    for (auto& vertex : vertices)
-    {
-        min = glm::min(min, vertex.position);
-        max = glm::max(max, vertex.position);
-    }
+    collisionSystem->set_terrain_query(TERRAIN_EXACT);
+    glm::vec3 min, max;
+    bsplineSurface->get_control_bounds(bsplineSurface->get_min_u(), bsplineSurface->get_max_u(), bsplineSurface->get_min_v(), bsplineSurface->get_max_v(), min, max);
     auto center = (min + max) / 2.0f;
     auto extent = (max - min) / 2.0f;
     world->set_bounds(center, extent);
     bsplineSurface->get_component<TransformComponent>()->set_position(glm::vec3(0.0001f));
-	world->set_surface_id(bsplineSurface->get_uuid());
+	world->set_surface_id(bsplineSurface->get_entity());
+
+    simulation = new SimulationThread(world);
+    simulation->start();
+    snapshot = &world->acquire_snapshot();
 
+    Progress::set_listener(nullptr);
     glfwSetWindowTitle(glfWindow, "GameEngineProject");
     return 0;
 }
@@ -333,15 +353,9 @@ void Window::update() const
     fps = sum / 100;
     glfwPollEvents();
     input.process_keyboard(glfWindow, deltaTime);
-    if (lastWorldUpdate >= minDeltaTime)
-    {
-        world->update(minDeltaTime);
-        lastWorldUpdate = 0;
-    }
-    else
-    {
-        lastWorldUpdate += deltaTime;
-    }
+    snapshot = &world->acquire_snapshot();
+    world->run_render_commands();
+    world->set_capture_cells(drawDebug);
 
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -378,6 +392,32 @@ void Window::update() const
         ImGui::Text("Objects after culling: %d", drawCounts.objects_culled);
         ImGui::Text("Objects filtered: %d", drawCounts.objects_filtered);
         ImGui::Text("Objects drawn: %d", drawCounts.objects_drawn);
+        ImGui::Text("Terrain tiles drawn: %u, missing: %u, queued: %u", tileCounts.drawn, tileCounts.missing, tileCounts.queued);
+        ImGui::Text("Terrain tiles resident: %u, %.1f MB", tileCounts.resident, tileCounts.memory / (1024.0 * 1024.0));
+        if (ImGui::SliderInt("Terrain memory (MB)", &tileBudget, 16, 4096))
+            tileCache->set_memory_budget(size_t(tileBudget) << 20);
+        ImGui::Separator();
+        if (ImGui::Checkbox("Parallel systems", &parallelSystems))
+            world->post([parallel = parallelSystems]() { world->get_scheduler()->set_parallel(parallel); });
+        if (ImGui::SliderInt("Max steps per frame", &maxSteps, 1, 10))
+            world->post([steps = maxSteps]() { world->set_max_steps_per_frame(steps); });
+        ImGui::Text("Steps last update: %u, interpolation %.2f", snapshot->step_count, snapshot->get_interpolation(std::chrono::steady_clock::now()));
+        ImGui::Text("Time dropped: %.2f s", snapshot->dropped_time);
+        for (auto& timing : snapshot->timings)
+        {
+            ImGui::Text("%s: %.3f ms", timing.name, timing.milliseconds);
+        }
+        ImGui::Separator();
+        const char* broadphases[] = { "AABB tree", "Sweep and prune", "Spatial hash grid" };
+        if (ImGui::Combo("Broadphase", &broadphase, broadphases, IM_ARRAYSIZE(broadphases)))
+            world->post([type = broadphase]() { collisionSystem->set_broadphase_type(static_cast<BroadphaseType>(type)); });
+        const char* terrainQueries[] = { "Mesh", "Exact surface" };
+        if (ImGui::Combo("Terrain", &terrainQuery, terrainQueries, IM_ARRAYSIZE(terrainQueries)))
+            world->post([query = terrainQuery]() { collisionSystem->set_terrain_query(static_cast<TerrainQuery>(query)); });
+        for (auto& stat : snapshot->stats)
+        {
+            ImGui::Text("%s: %.*f", stat.name, stat.decimals, stat.value);
+        }
         ImGui::End();
     }
 
@@ -399,11 +439,17 @@ void Window::render() const
 
     if (drawDebug)
     {
-        world->draw_debug(debugLine, debugArrow);
+        world->draw_debug(debugLine, debugArrow, *snapshot);
         debugSphere->draw();
     }
 
-    drawCounts = world->draw(&frustum);
+    drawCounts = world->draw(&frustum, camera.get_pos(), *snapshot);
+    tileCounts = tileCache->draw(&frustum, camera.get_pos());
+    if (drawDebug)
+    {
+        for (auto bounds : tileCache->get_missing())
+            bounds.draw_debug(debugLine);
+    }
 
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
@@ -417,6 +463,8 @@ bool Window::should_close() const
 
 Window::~Window()
 {
+    delete simulation;
+    delete tileCache;
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -5,101 +5,93 @@
 #include "objects/debugTools/Line.h"
 #include "objects/debugTools/Arrow.h"
 #include "colliders/ColliderHandler.h"
+#include "ecs/components/collider.h"
 #include <imgui/imgui.h>
+#include <algorithm>
 
 glm::vec3 checkLoc = glm::vec3(0, 0, 0);
 
 void World::insert(GameObject* object)
 {
-    object->attatch_to_world(this);
-    object->register_ecs(&ecs);
-
-    if (object->get_collider() == nullptr)
-    {
-        objects_non_colliders.push_back(object);
-        return;
-    }
-    tree.insert(object);
+    insert(object, glm::vec3(0.0f));
 }
 void World::insert(GameObject* object, glm::vec3 position)
 {
-    object->attatch_to_world(this);
-    object->register_ecs(&ecs);
-    object->get_component<TransformComponent>()->set_position(position);
-    if (object->get_collider() == nullptr)
-    {
-        objects_non_colliders.push_back(object);
-        return;
-    }
-    tree.insert(object);
+    insert(object, position, glm::vec3(1.0f));
 }
 void World::insert(GameObject* object, glm::vec3 position, glm::vec3 scale)
 {
-    object->attatch_to_world(this);
-    object->register_ecs(&ecs);
-    auto transform = object->get_component<TransformComponent>();
-    transform->set_position(position);
-    transform->set_scale(scale);
-    if (object->get_collider() == nullptr)
-    {
-        objects_non_colliders.push_back(object);
-        return;
-    }
-    tree.insert(object);
+    insert(object, position, scale, glm::quat(1, 0, 0, 0));
 }
+// Every other overload places the object through this one, the transform is set before the object goes into the tree
 void World::insert(GameObject* object, glm::vec3 position, glm::vec3 scale, glm::quat rotation)
 {
     object->attatch_to_world(this);
     object->register_ecs(&ecs);
+    track_object(object);
     auto transform = object->get_component<TransformComponent>();
     transform->set_position(position);
     transform->set_scale(scale);
     transform->set_rotation(rotation);
+    transform->store_previous();
     if (object->get_collider() == nullptr)
     {
         objects_non_colliders.push_back(object);
         return;
     }
+    ecs.insert<ColliderComponent>(object->get_entity(), ColliderComponent{ {}, object->get_collider() });
     tree.insert(object);
 }
 
-DrawCounts World::draw(Frustum* frustum)
+DrawCounts World::draw(Frustum* frustum, const glm::vec3& eye, const WorldSnapshot& snapshot)
 {
-    std::vector<GameObject*> objects;
     DrawCounts counts = { 0, 0, 0 };
-    auto tuple = tree.query_range(tree.get_bounds(), objects, frustum);
-    counts.objects_culled = std::get<0>(tuple);
-    counts.objects_filtered = std::get<1>(tuple);
-    for (auto& object : objects)
+    auto interpolation = snapshot.get_interpolation(std::chrono::steady_clock::now());
+    // The render matrices of the ancestors of the child being placed, the object itself first
+    std::vector<glm::mat4x4> parents;
+    for (auto& item : snapshot.objects)
     {
-        if ((object->get_collider()->is_on_frustum(frustum) || object->get_uuid() == surface_id) && object->should_render())
+        if (item.has_bounds)
         {
-            counts.objects_drawn++;
-            object->draw();
+            counts.objects_culled++;
+            auto bounds = item.bounds;
+            if (!bounds.is_on_frustum(frustum))
+                continue;
+            counts.objects_filtered++;
         }
-    }
-    for (auto& object : objects_non_colliders)
-    {
-        if (object->should_render())
+        if (item.object->should_render())
         {
             counts.objects_drawn++;
-            object->draw();
+            item.object->set_view_position(eye);
+            parents.assign(1, item.transform.get_interpolated_model_matrix(interpolation));
+            item.object->set_render_matrix(parents[0]);
+            // Children are drawn by their parent, so they are placed from the snapshot here instead of their live transform
+            for (unsigned i = item.first_child; i < item.first_child + item.child_count; i++)
+            {
+                auto& child = snapshot.children[i];
+                parents.resize(child.depth);
+                parents.push_back(parents.back() * child.transform.get_interpolated_model_matrix(interpolation));
+                child.object->set_render_matrix(parents.back());
+            }
+            item.object->draw();
         }
     }
     return counts;
 }
 
-void World::draw_debug(Line* line, Arrow* arrow)
+void World::draw_debug(Line* line, Arrow* arrow, const WorldSnapshot& snapshot)
 {
-    tree.draw_debug(line);
+    for (auto cell : snapshot.cells)
+        cell.draw_debug(line);
     if (directionalLight != nullptr)
     {
         auto dir = glm::normalize(directionalLight->direction);
-        arrow->get_component<TransformComponent>()->set_position(glm::vec3(0));
         auto zAngle = glm::dot(dir, glm::vec3(0, 0, 1));
         auto xAngle = glm::dot(dir, glm::vec3(1, 0, 0));
         auto yAngle = glm::dot(dir, glm::vec3(0, 1, 0));
-        arrow->get_component<TransformComponent>()->set_rotation(glm::vec3(xAngle, yAngle, zAngle));
+        // The arrow is drawn from the render thread, so it is placed through its render matrix instead of its transform
+        TransformComponent transform(glm::vec3(0), glm::quat(glm::vec3(xAngle, yAngle, zAngle)), glm::vec3(1));
+        arrow->set_render_matrix(transform.get_model_matrix());
         dynamic_cast<ColorMaterial*>(arrow->get_material())->color = glm::vec4(directionalLight->ambient.get_rgb_vec3(), 1.0f);
         arrow->draw();
     }
@@ -110,12 +102,94 @@ void World::set_bounds(const glm::vec3& center, const glm::vec3& extent)
     tree.set_bounds(center, extent);
 }
 
-void World::update(float delta_time)
+unsigned World::advance(double frame_time)
 {
-    for (auto& system : systems)
+    commands.run_all();
+    accumulator += std::min(frame_time, MAX_FRAME_TIME);
+    auto steps = static_cast<unsigned>(accumulator / fixed_delta_time);
+    if (steps > max_steps_per_frame)
+    {
+        // Running every step would make this frame longer still and the next one would owe even more steps,
+        // so the steps that do not fit are dropped and the simulation runs slower than real time instead
+        dropped_time += (steps - max_steps_per_frame) * fixed_delta_time;
+        accumulator -= (steps - max_steps_per_frame) * fixed_delta_time;
+        steps = max_steps_per_frame;
+    }
+    for (unsigned i = 0; i < steps; i++)
     {
-        system->update(delta_time);
+        // Rendering only blends the last two states, the steps before the last one need no copy
+        if (i + 1 == steps)
+            store_previous_transforms();
+        update(static_cast<float>(fixed_delta_time));
+        accumulator -= fixed_delta_time;
     }
+    interpolation = static_cast<float>(accumulator / fixed_delta_time);
+    last_step_count = steps;
+    if (steps > 0)
+        publish_snapshot();
+    return steps;
+}
+
+void World::publish_snapshot()
+{
+    auto& snapshot = snapshots.get_back();
+    snapshot.objects.clear();
+    snapshot.children.clear();
+    for (auto& [entity, object] : objects_by_entity)
+    {
+        if (object == nullptr || !ecs.is_alive(entity))
+            continue;
+        AABB bounds;
+        auto has_bounds = object->get_render_bounds(bounds);
+        auto first_child = static_cast<unsigned>(snapshot.children.size());
+        capture_children(object, 1, snapshot);
+        auto child_count = static_cast<unsigned>(snapshot.children.size()) - first_child;
+        snapshot.objects.push_back({ object, *object->get_component<TransformComponent>(), bounds, has_bounds, first_child, child_count });
+    }
+    snapshot.timings = scheduler.get_timings();
+    snapshot.stats.clear();
+    scheduler.get_stats(snapshot.stats);
+    snapshot.cells.clear();
+    if (capture_cells.load(std::memory_order_relaxed))
+        tree.get_cells(snapshot.cells);
+    snapshot.time = std::chrono::steady_clock::now();
+    snapshot.interpolation = interpolation;
+    snapshot.fixed_delta_time = fixed_delta_time;
+    snapshot.step_count = last_step_count;
+    snapshot.dropped_time = dropped_time;
+    snapshots.publish();
+}
+
+const WorldSnapshot& World::acquire_snapshot()
+{
+    snapshots.acquire();
+    return snapshots.get_front();
+}
+
+// A child without a transform of its own is drawn where its parent is
+void World::capture_children(GameObject* object, unsigned depth, WorldSnapshot& snapshot)
+{
+    for (auto child : object->get_children())
+    {
+        auto transform = ecs.get<TransformComponent>(child->get_entity());
+        snapshot.children.push_back({ child, transform != nullptr ? *transform : TransformComponent(glm::vec3(0), glm::quat(1, 0, 0, 0), glm::vec3(1)), depth });
+        capture_children(child, depth + 1, snapshot);
+    }
+}
+
+void World::store_previous_transforms()
+{
+    auto transforms = ecs.get<TransformComponent>();
+    if (transforms == nullptr)
+        return;
+    auto data = transforms->data();
+    for (int i = 0; i < transforms->get_size(); i++)
+        data[i].store_previous();
+}
+
+void World::update(float delta_time)
+{
+    scheduler.run(delta_time);
     std::vector<GameObject*> objects;
     AABB bounds = tree.get_bounds();
     tree.query_range(bounds, objects);
@@ -230,17 +304,22 @@ void World::draw_light_editor()
     }
 }
 
-GameObject* World::get_object(UUID id)
+void World::track_object(GameObject* object)
 {
-    auto object = tree.get_node([&id](GameObject* object)
-        { return object->get_uuid() == id; });
-    if (object == nullptr)
-    {
-        for (auto& object : objects_non_colliders)
-        {
-            if (object->get_uuid() == id)
-                return object;
-        }
-    }
-    return object;
+    auto entity = object->get_entity();
+    auto index = entity.get_index();
+    if (index >= objects_by_entity.size())
+        objects_by_entity.resize(index + 1, { Entity::null(), nullptr });
+    objects_by_entity[index] = { entity, object };
+}
+
+GameObject* World::get_object(Entity entity)
+{
+    auto index = entity.get_index();
+    if (entity.is_null() || index >= objects_by_entity.size())
+        return nullptr;
+    auto& entry = objects_by_entity[index];
+    if (entry.first != entity || !ecs.is_alive(entity))
+        return nullptr;
+    return entry.second;
 }
\ No newline at end of file
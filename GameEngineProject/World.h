@@ -4,12 +4,20 @@
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include "collections/QuadTree.h"
-#include "collections/OcTree.h"
+#include "collections/Octree.h"
 #include "culling/Frustum.h"
 #include "Light.h"
 #include "ecs/ecs_map.h"
+#include "ecs/components/transform.h"
 #include "ecs/system/base.h"
+#include "ecs/system/scheduler.h"
+#include "threading/ThreadPool.h"
+#include "threading/CommandQueue.h"
+#include "threading/TripleBuffer.h"
 
 class GameObject;
 class Arrow;
@@ -21,10 +29,59 @@ struct DrawCounts
     unsigned objects_drawn;
 };
 
+/// @brief What the renderer needs of an object, copied out of the simulation after a step
+struct RenderObject
+{
+    GameObject* object;
+    // Holds the state before the last step as well, so the renderer can interpolate
+    TransformComponent transform;
+    // Bounds to cull with, objects without bounds are always drawn
+    AABB bounds;
+    bool has_bounds;
+    // The children of the object in WorldSnapshot::children, all of its descendants in depth first order
+    unsigned first_child;
+    unsigned child_count;
+};
+
+/// @brief A child drawn with its parent, placed by its transform relative to the parent
+struct RenderChild
+{
+    GameObject* object;
+    TransformComponent transform;
+    // 1 for a child of the object itself, 2 for a child of that child and so on
+    unsigned depth;
+};
+
+/// @brief Immutable copy of the simulation state after a step, the render thread draws from it while the next step runs
+struct WorldSnapshot
+{
+    std::vector<RenderObject> objects;
+    std::vector<RenderChild> children;
+    std::vector<SystemTiming> timings;
+    std::vector<SystemStat> stats;
+    // The octree cells, only copied while the debug view asks for them
+    std::vector<AABB> cells;
+    // When the snapshot was published and how far the accumulator was into the next step at that time
+    std::chrono::steady_clock::time_point time;
+    float interpolation = 1.0f;
+    double fixed_delta_time = 1 / 60.0;
+    unsigned step_count = 0;
+    double dropped_time = 0.0;
+
+    /// @brief Gets how far rendering is between the last two steps, the snapshot keeps ageing while the next step runs
+    float get_interpolation(std::chrono::steady_clock::time_point now) const
+    {
+        auto age = std::chrono::duration<double>(now - time).count();
+        return static_cast<float>(std::min(1.0, interpolation + age / fixed_delta_time));
+    }
+};
+
 class World
 {
 public:
     static constexpr unsigned MAX_POINT_LIGHTS = 4;
+    /// @brief The longest frame that is caught up, a longer one (a breakpoint, dragging the window) loses the rest of its time
+    static constexpr double MAX_FRAME_TIME = 0.25;
 
 private:
     OcTree<GameObject*> tree;
@@ -33,8 +90,28 @@ private:
     DirectionalLight* directionalLight = nullptr;
     SpotLight* spotLight = nullptr;
     ECSGlobalMap ecs;
-    std::vector<BaseSystem*> systems;
-    UUID surface_id;
+    SystemScheduler scheduler = SystemScheduler(&ThreadPool::get_global());
+    // Indexed by Entity::get_index, the stored handle tells a live object from a stale one that reused the index
+    std::vector<std::pair<Entity, GameObject*>> objects_by_entity;
+    Entity surface_id;
+    // The systems always run with this time step, real time is turned into whole steps by the accumulator
+    double fixed_delta_time = 1 / 60.0;
+    unsigned max_steps_per_frame = 5;
+    double accumulator = 0.0;
+    // How far rendering is between the last two steps, 0 draws the previous state and 1 the current one
+    float interpolation = 1.0f;
+    unsigned last_step_count = 0;
+    double dropped_time = 0.0;
+    // Changes posted by other threads, run by the simulation before its next step
+    CommandQueue commands;
+    // Changes to render state posted by the simulation, run by the render thread
+    CommandQueue render_commands;
+    TripleBuffer<WorldSnapshot> snapshots;
+    std::atomic<bool> capture_cells = false;
+
+    void track_object(GameObject* object);
+    void store_previous_transforms();
+    void capture_children(GameObject* object, unsigned depth, WorldSnapshot& snapshot);
 
 public:
     World()
@@ -54,13 +131,47 @@ public:
     void insert(GameObject* object, glm::vec3 position, glm::vec3 scale);
     void insert(GameObject* object, glm::vec3 position, glm::vec3 scale, glm::quat rotation);
 
-    DrawCounts draw(Frustum* frustum);
+    /// @brief Draws the objects of a snapshot that are inside the frustum, interpolated to the current time
+    /// @param eye The position of the camera, objects with several levels of detail pick the one drawn from it
+    DrawCounts draw(Frustum* frustum, const glm::vec3& eye, const WorldSnapshot& snapshot);
 
-    void draw_debug(Line* line, Arrow* arrow);
+    void draw_debug(Line* line, Arrow* arrow, const WorldSnapshot& snapshot);
 
     void set_bounds(const glm::vec3& center, const glm::vec3& extent);
 
+    /// @brief Runs every system and object once
     void update(float delta_time);
+    /// @brief Runs the posted commands, then as many fixed steps as the real time since the last frame covers, at most
+    /// max_steps_per_frame of them, and publishes a snapshot if a step ran.
+    /// The time left over is carried to the next frame and sets how far rendering interpolates into the last step.
+    /// @param frame_time The real time since the last frame in seconds
+    /// @return The number of steps run
+    unsigned advance(double frame_time);
+    void set_fixed_delta_time(double delta_time) { fixed_delta_time = delta_time; }
+    double get_fixed_delta_time() const { return fixed_delta_time; }
+    void set_max_steps_per_frame(unsigned steps) { max_steps_per_frame = steps; }
+    unsigned get_max_steps_per_frame() const { return max_steps_per_frame; }
+    float get_interpolation() const { return interpolation; }
+    unsigned get_last_step_count() const { return last_step_count; }
+    /// @brief Gets the simulated time lost because frames took longer than the steps could catch up
+    double get_dropped_time() const { return dropped_time; }
+    /// @brief Gets how long until the accumulator holds a whole step
+    double get_time_to_next_step() const { return fixed_delta_time - accumulator; }
+
+    /// @brief Runs a command on the thread that steps the world, before the next step. Anything that changes the simulation
+    /// from another thread, such as inserting objects or changing a system, has to go through here
+    void post(std::function<void()> command) { commands.post(std::move(command)); }
+    /// @brief Runs a command on the render thread when it next takes a snapshot, for objects changing what they draw during a step
+    void post_to_render(std::function<void()> command) { render_commands.post(std::move(command)); }
+    /// @brief Runs the commands the simulation posted for the render thread
+    void run_render_commands() { render_commands.run_all(); }
+    /// @brief Copies the state the renderer needs and makes it the newest snapshot, called by the thread that steps the world
+    void publish_snapshot();
+    /// @brief Takes the newest snapshot if a new one was published, called by the render thread
+    /// @return The snapshot the render thread holds until the next call
+    const WorldSnapshot& acquire_snapshot();
+    /// @brief Sets if the snapshots carry the octree cells for the debug view
+    void set_capture_cells(bool capture) { capture_cells.store(capture, std::memory_order_relaxed); }
     void set_point_light(PointLight* light, unsigned index);
     void set_directional_light(DirectionalLight* light);
     void set_spot_light(SpotLight* light);
@@ -72,7 +183,9 @@ public:
     SpotLight* get_spot_light() { return spotLight; }
     ECSGlobalMap* get_ecs() { return &ecs; }
     void draw_light_editor();
-    void register_system(BaseSystem* system) { systems.push_back(system); }
+    /// @brief Registers a system to run every update, the world takes ownership of it
+    void register_system(BaseSystem* system) { scheduler.add(system); }
+    SystemScheduler* get_scheduler() { return &scheduler; }
     AABB get_bounds() { return tree.get_bounds(); }
 
     void set_shader(const Shader* shader)
@@ -96,6 +209,7 @@ public:
             delete object;
         }
         objects_non_colliders.clear();
+        objects_by_entity.clear();
         for (auto light : pointLights)
         {
             delete light;
@@ -104,8 +218,8 @@ public:
         delete spotLight;
     }
 
-    GameObject* get_object(UUID id);
+    GameObject* get_object(Entity entity);
 
-    void set_surface_id(UUID id) { surface_id = id; }
-    UUID get_surface_id() { return surface_id; }
+    void set_surface_id(Entity id) { surface_id = id; }
+    Entity get_surface_id() { return surface_id; }
 };
\ No newline at end of file
@@ -0,0 +1,353 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../colliders/AABB.h"
+#include "../culling/Frustum.h"
+#include "../threading/ThreadPool.h"
+
+/// @brief Cell of a LinearOcTree, the items of a cell are a contiguous run of the Morton sorted items
+struct LinearOcTreeNode
+{
+    unsigned first_item;
+    unsigned item_count;
+    // Children are stored next to each other, the child for octant o is at first_child + popcount(child_mask & ((1 << o) - 1))
+    unsigned first_child;
+    // Morton code of the cell, 3 bits per level
+    unsigned code;
+    unsigned char child_mask;
+    unsigned char level;
+};
+
+/// @brief Octree without pointers, bulk built from a list of items.
+/// Items are sorted by the Morton code of their position and every cell owns a contiguous run of them,
+/// the cells are stored breadth first in a single array and children are found by index arithmetic.
+/// Items outside the bounds are dropped, the same as OcTree. Moving items require a new build.
+template <typename T, unsigned BucketSize = 8>
+class LinearOcTree
+{
+public:
+    static constexpr unsigned MAX_LEVEL = 10;
+
+private:
+    static constexpr unsigned CELLS_PER_AXIS = 1u << MAX_LEVEL;
+    // Below this many items a build runs the sort on the calling thread
+    static constexpr unsigned PARALLEL_SORT_THRESHOLD = 16384;
+
+    AABB boundary = AABB();
+    std::function<glm::vec3(const T&)> get_position;
+    ThreadPool* pool;
+
+    std::vector<T> items;
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned> keys;
+    std::vector<LinearOcTreeNode> nodes;
+    // Key in the upper 32 bits, index into the unsorted input in the lower 32 bits
+    std::vector<uint64_t> sort_buffer;
+    std::vector<uint64_t> sort_scratch;
+
+    static unsigned expand_bits(unsigned value)
+    {
+        value = (value | (value << 16)) & 0x030000FFu;
+        value = (value | (value << 8)) & 0x0300F00Fu;
+        value = (value | (value << 4)) & 0x030C30C3u;
+        value = (value | (value << 2)) & 0x09249249u;
+        return value;
+    }
+
+    static unsigned compact_bits(unsigned value)
+    {
+        value &= 0x09249249u;
+        value = (value | (value >> 2)) & 0x030C30C3u;
+        value = (value | (value >> 4)) & 0x0300F00Fu;
+        value = (value | (value >> 8)) & 0x030000FFu;
+        value = (value | (value >> 16)) & 0x000003FFu;
+        return value;
+    }
+
+    unsigned get_key(const glm::vec3& position) const
+    {
+        auto scaled = (position - boundary.min) / (boundary.max - boundary.min) * float(CELLS_PER_AXIS);
+        auto cell = glm::clamp(glm::ivec3(scaled), glm::ivec3(0), glm::ivec3(CELLS_PER_AXIS - 1));
+        return (expand_bits(cell.x) << 2) | (expand_bits(cell.y) << 1) | expand_bits(cell.z);
+    }
+
+    /// @brief Gets the bounds of a cell from its Morton code
+    void get_cell_bounds(const LinearOcTreeNode& node, glm::vec3& min, glm::vec3& max) const
+    {
+        glm::vec3 cell(compact_bits(node.code >> 2), compact_bits(node.code >> 1), compact_bits(node.code));
+        auto size = (boundary.max - boundary.min) / float(1u << node.level);
+        min = boundary.min + cell * size;
+        max = min + size;
+    }
+
+    /// @brief Stable LSD radix sort of sort_buffer on the key bits, chunks of the input are counted and scattered in parallel
+    void sort()
+    {
+        auto count = static_cast<unsigned>(sort_buffer.size());
+        sort_scratch.resize(count);
+        unsigned chunk_count = 1;
+        if (pool != nullptr && count >= PARALLEL_SORT_THRESHOLD)
+            chunk_count = std::min(pool->get_concurrency(), count / (PARALLEL_SORT_THRESHOLD / 4));
+        auto chunk_size = (count + chunk_count - 1) / chunk_count;
+        std::vector<unsigned> offsets(chunk_count * 256);
+
+        for (unsigned shift = 32; shift < 32 + 3 * MAX_LEVEL; shift += 8)
+        {
+            auto run_chunks = [&](const std::function<void(unsigned, unsigned, unsigned)>& func)
+            {
+                if (chunk_count == 1)
+                {
+                    func(0, 0, count);
+                    return;
+                }
+                pool->parallel_for(0, chunk_count, 1, [&](int begin, int end)
+                    {
+                        for (int chunk = begin; chunk < end; chunk++)
+                            func(chunk, chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size));
+                    });
+            };
+
+            std::fill(offsets.begin(), offsets.end(), 0);
+            run_chunks([&](unsigned chunk, unsigned begin, unsigned end)
+                {
+                    auto histogram = &offsets[chunk * 256];
+                    for (unsigned i = begin; i < end; i++)
+                        histogram[(sort_buffer[i] >> shift) & 0xFF]++;
+                });
+
+            // Digit major prefix sum so every chunk scatters to its own slice of each digit
+            unsigned total = 0;
+            for (unsigned digit = 0; digit < 256; digit++)
+            {
+                for (unsigned chunk = 0; chunk < chunk_count; chunk++)
+                {
+                    auto bucket = offsets[chunk * 256 + digit];
+                    offsets[chunk * 256 + digit] = total;
+                    total += bucket;
+                }
+            }
+
+            run_chunks([&](unsigned chunk, unsigned begin, unsigned end)
+                {
+                    auto offset = &offsets[chunk * 256];
+                    for (unsigned i = begin; i < end; i++)
+                        sort_scratch[offset[(sort_buffer[i] >> shift) & 0xFF]++] = sort_buffer[i];
+                });
+            sort_buffer.swap(sort_scratch);
+        }
+    }
+
+    void build_nodes()
+    {
+        nodes.clear();
+        if (items.empty())
+            return;
+        nodes.push_back({ 0, static_cast<unsigned>(items.size()), 0, 0, 0, 0 });
+        for (size_t n = 0; n < nodes.size(); n++)
+        {
+            auto node = nodes[n];
+            if (node.item_count <= BucketSize || node.level == MAX_LEVEL)
+                continue;
+
+            auto shift = 3 * (MAX_LEVEL - node.level - 1);
+            auto first_child = static_cast<unsigned>(nodes.size());
+            unsigned char mask = 0;
+            auto begin = keys.begin() + node.first_item;
+            auto end = begin + node.item_count;
+            while (begin != end)
+            {
+                auto octant = (*begin >> shift) & 7;
+                auto next = std::partition_point(begin, end, [shift, octant](unsigned key)
+                    { return ((key >> shift) & 7) <= octant; });
+                nodes.push_back({ static_cast<unsigned>(begin - keys.begin()), static_cast<unsigned>(next - begin), 0,
+                    (node.code << 3) | octant, 0, static_cast<unsigned char>(node.level + 1) });
+                mask |= 1 << octant;
+                begin = next;
+            }
+            nodes[n].first_child = first_child;
+            nodes[n].child_mask = mask;
+        }
+    }
+
+    /// @brief Visits the cells depth first, visit returns false to skip the children of a cell
+    template <typename V>
+    void traverse(V&& visit) const
+    {
+        if (nodes.empty())
+            return;
+        unsigned stack[7 * MAX_LEVEL + 1];
+        unsigned size = 0;
+        stack[size++] = 0;
+        while (size > 0)
+        {
+            auto& node = nodes[stack[--size]];
+            if (!visit(node) || node.child_mask == 0)
+                continue;
+            auto children = std::popcount(node.child_mask);
+            for (int i = children - 1; i >= 0; i--)
+                stack[size++] = node.first_child + i;
+        }
+    }
+
+public:
+    /// @brief Creates an empty tree
+    /// @param get_position Gets the position an item is sorted by
+    /// @param pool The pool the build sorts on, null to build on the calling thread
+    LinearOcTree(std::function<glm::vec3(const T&)> get_position, ThreadPool* pool = nullptr) : get_position(get_position), pool(pool) {}
+
+    void set_bounds(const glm::vec3& center, const glm::vec3& extent)
+    {
+        boundary.center = center;
+        boundary.extent = extent;
+        boundary.recalculate();
+    }
+
+    AABB get_bounds() const { return boundary; }
+
+    /// @brief Replaces the contents of the tree with the items inside the bounds
+    void build(const std::vector<T>& source)
+    {
+        sort_buffer.clear();
+        std::vector<glm::vec3> source_positions(source.size());
+        for (unsigned i = 0; i < source.size(); i++)
+        {
+            source_positions[i] = get_position(source[i]);
+            if (boundary.contains(source_positions[i]))
+                sort_buffer.push_back((uint64_t(get_key(source_positions[i])) << 32) | i);
+        }
+        sort();
+
+        auto count = sort_buffer.size();
+        items.resize(count);
+        positions.resize(count);
+        keys.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            auto index = static_cast<unsigned>(sort_buffer[i]);
+            items[i] = source[index];
+            positions[i] = source_positions[index];
+            keys[i] = static_cast<unsigned>(sort_buffer[i] >> 32);
+        }
+        build_nodes();
+    }
+
+    void clear()
+    {
+        items.clear();
+        positions.clear();
+        keys.clear();
+        nodes.clear();
+    }
+
+    size_t size() const { return items.size(); }
+    size_t get_node_count() const { return nodes.size(); }
+    const std::vector<LinearOcTreeNode>& get_nodes() const { return nodes; }
+
+    /// @brief Finds the items inside a range, and inside the frustum if one is given
+    /// @return The number of items tested and the number of items found
+    template <typename F>
+    std::tuple<unsigned, unsigned> query_range(AABB range, std::vector<F>& found, Frustum* frustum = nullptr)
+    {
+        unsigned total = 0;
+        unsigned found_count = 0;
+        traverse([&](const LinearOcTreeNode& node)
+            {
+                glm::vec3 min, max;
+                get_cell_bounds(node, min, max);
+                if (glm::any(glm::greaterThan(min, range.max)) || glm::any(glm::lessThan(max, range.min)))
+                    return false;
+                if (frustum != nullptr)
+                {
+                    auto bounds = AABB((min + max) * 0.5f, (max - min) * 0.5f);
+                    if (!bounds.is_on_frustum(frustum))
+                        return false;
+                }
+                if (node.child_mask != 0)
+                    return true;
+
+                for (unsigned i = node.first_item; i < node.first_item + node.item_count; i++)
+                {
+                    total++;
+                    auto data = dynamic_cast<F>(items[i]);
+                    if (data != nullptr && range.contains(positions[i]))
+                    {
+                        found_count++;
+                        found.push_back(data);
+                    }
+                }
+                return false;
+            });
+        return std::make_tuple(total, found_count);
+    }
+
+    /// @brief Finds the items inside the frustum
+    /// @return The number of items tested and the number of items found
+    template <typename F>
+    std::tuple<unsigned, unsigned> query(std::vector<F>& found, Frustum* frustum)
+    {
+        unsigned total = 0;
+        unsigned found_count = 0;
+        traverse([&](const LinearOcTreeNode& node)
+            {
+                glm::vec3 min, max;
+                get_cell_bounds(node, min, max);
+                auto bounds = AABB((min + max) * 0.5f, (max - min) * 0.5f);
+                if (!bounds.is_on_frustum(frustum))
+                    return false;
+                if (node.child_mask != 0)
+                    return true;
+
+                for (unsigned i = node.first_item; i < node.first_item + node.item_count; i++)
+                {
+                    total++;
+                    auto data = dynamic_cast<F>(items[i]);
+                    if (data != nullptr && frustum->contains(positions[i]))
+                    {
+                        found_count++;
+                        found.push_back(data);
+                    }
+                }
+                return false;
+            });
+        return std::make_tuple(total, found_count);
+    }
+
+    template <typename F>
+    void query(std::vector<F>& found)
+    {
+        for (auto& item : items)
+        {
+            auto data = dynamic_cast<F>(item);
+            if (data != nullptr)
+                found.push_back(data);
+        }
+    }
+
+    /// @brief Gets the first item in Morton order that matches the predicate
+    T get_node(std::function<bool(T)> predicate)
+    {
+        for (auto& item : items)
+        {
+            if (predicate(item))
+                return item;
+        }
+        return nullptr;
+    }
+
+    void draw_debug(Line* line)
+    {
+        for (auto& node : nodes)
+        {
+            glm::vec3 min, max;
+            get_cell_bounds(node, min, max);
+            auto bounds = AABB((min + max) * 0.5f, (max - min) * 0.5f);
+            bounds.draw_debug(line);
+        }
+    }
+};
\ No newline at end of file
@@ -1,8 +1,54 @@
 #pragma once
 
-template <typename T>
+#include <vector>
+
+/// @brief Bucket of items stored in a tree cell.
+/// The first Capacity items live inline in the cell, any further items spill into a vector.
+/// Trees split a cell once its inline items are full, so only cells that cannot be split any further spill.
+template <typename T, unsigned Capacity = 8>
 struct Node
 {
-    T data;
-    // Node *next;
+private:
+    T items[Capacity];
+    unsigned count = 0;
+    std::vector<T> overflow;
+
+public:
+    unsigned size() const { return count + static_cast<unsigned>(overflow.size()); }
+    bool empty() const { return size() == 0; }
+    bool is_full() const { return count == Capacity; }
+
+    T& operator[](unsigned index) { return index < Capacity ? items[index] : overflow[index - Capacity]; }
+
+    void push(T item)
+    {
+        if (count < Capacity)
+            items[count++] = item;
+        else
+            overflow.push_back(item);
+    }
+
+    /// @brief Removes an item by moving the last item into its place
+    /// @return true if the item was in the bucket
+    bool remove(const T& item)
+    {
+        for (unsigned i = 0; i < size(); i++)
+        {
+            if ((*this)[i] != item)
+                continue;
+            (*this)[i] = (*this)[size() - 1];
+            if (!overflow.empty())
+                overflow.pop_back();
+            else
+                count--;
+            return true;
+        }
+        return false;
+    }
+
+    void clear()
+    {
+        count = 0;
+        overflow.clear();
+    }
 };
\ No newline at end of file
@@ -1,31 +1,5 @@
-#include "OcTree.h"
-#include "../objects/base/GameObject.h"
-#include "../objects/base/GameObject.h"
+#include "Octree.h"
 #include "../objects/debugTools/Line.h"
-#include <vector>
-
-template <typename T>
-void OcTree<T>::recalculate()
-{
-    throw "Cannot recalculate OcTree of unknown type";
-}
-
-template <>
-void OcTree<GameObject*>::recalculate()
-{
-    std::vector<GameObject*> all_objects;
-    query<GameObject*>(all_objects);
-
-    for (auto& object : all_objects)
-    {
-        pop(object);
-    }
-    unsubdivide();
-    for (auto& object : all_objects)
-    {
-        insert(object);
-    }
-}
 
 void OcTreeBase::draw_debug(Line* line, bool draw_bounds)
 {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <unordered_map>
 #include "../colliders/AABB.h"
 #include "Node.h"
 #include "../culling/Frustum.h"
@@ -25,7 +26,9 @@ public:
     void set_leaf(bool vleaf) { leaf = vleaf; }
 };
 
-template <typename T>
+/// @brief Octree storing up to BucketSize items per cell before the cell is split.
+/// Cells at the maximum depth keep accepting items past BucketSize so an insert inside the bounds is never dropped.
+template <typename T, unsigned BucketSize = 8>
 class OcTree : public OcTreeBase
 {
 private:
@@ -38,12 +41,112 @@ private:
     OcTree* southWestLower;
     OcTree* southEastLower;
     OcTree* parent;
+    OcTree* root;
+    int depth = 0;
 
-    bool recalculated = false;
+    // Only used on the root, the cell every item currently lives in
+    std::unordered_map<T, OcTree*> locations;
 
-    Node<T>* node = nullptr;
+    Node<T, BucketSize> node;
 
-    void subdivide()
+    void set_location(T point, OcTree* cell)
+    {
+        root->locations[point] = cell;
+    }
+
+    void store(T point)
+    {
+        node.push(point);
+        set_location(point, this);
+    }
+
+    void attach_child(OcTree* child, const glm::vec3& center, const glm::vec3& extent)
+    {
+        child->set_bounds(center, extent);
+        child->parent = this;
+        child->root = root;
+        child->depth = depth + 1;
+    }
+
+    bool insert_into_children(T point, int max_depth)
+    {
+        if (northWestUpper->insert(point, max_depth))
+            return true;
+        if (northEastUpper->insert(point, max_depth))
+            return true;
+        if (southWestUpper->insert(point, max_depth))
+            return true;
+        if (southEastUpper->insert(point, max_depth))
+            return true;
+        if (northWestLower->insert(point, max_depth))
+            return true;
+        if (northEastLower->insert(point, max_depth))
+            return true;
+        if (southWestLower->insert(point, max_depth))
+            return true;
+        return southEastLower->insert(point, max_depth);
+    }
+
+    /// @brief Checks if the items of the eight children fit in this cell with room to spare, the margin keeps items
+    /// moving along a cell border from splitting and collapsing the same cell every tick
+    bool can_collapse()
+    {
+        if (is_leaf())
+            return false;
+        unsigned count = node.size();
+        for (auto child : { northWestUpper, northEastUpper, southWestUpper, southEastUpper, northWestLower, northEastLower, southWestLower, southEastLower })
+        {
+            if (!child->is_leaf())
+                return false;
+            count += child->node.size();
+        }
+        return count <= BucketSize / 2;
+    }
+
+    /// @brief Pulls the items of the eight leaf children into this cell and deletes the children
+    void collapse()
+    {
+        for (auto child : { northWestUpper, northEastUpper, southWestUpper, southEastUpper, northWestLower, northEastLower, southWestLower, southEastLower })
+        {
+            for (unsigned i = 0; i < child->node.size(); i++)
+                store(child->node[i]);
+        }
+        delete_children();
+    }
+
+    /// @brief Collapses the closest parent cell and then its ancestors for as long as their items fit in a single cell
+    void merge_underfull()
+    {
+        auto current = is_leaf() ? parent : this;
+        while (current != nullptr && current->can_collapse())
+        {
+            current->collapse();
+            current = current->parent;
+        }
+    }
+
+    void delete_children()
+    {
+        delete northWestUpper;
+        delete northEastUpper;
+        delete southWestUpper;
+        delete southEastUpper;
+        delete northWestLower;
+        delete northEastLower;
+        delete southWestLower;
+        delete southEastLower;
+        northWestUpper = nullptr;
+        northEastUpper = nullptr;
+        southWestUpper = nullptr;
+        southEastUpper = nullptr;
+        northWestLower = nullptr;
+        northEastLower = nullptr;
+        southWestLower = nullptr;
+        southEastLower = nullptr;
+        set_leaf(true);
+    }
+
+    void subdivide(int max_depth)
     {
         glm::vec3 center = get_bounds().center;
         glm::vec3 extent = get_bounds().extent;
@@ -58,120 +161,38 @@ private:
         glm::vec3 swl_center = center + glm::vec3(-extent.x / 2, -extent.y / 2, -extent.z / 2);
         glm::vec3 sel_center = center + glm::vec3(extent.x / 2, -extent.y / 2, -extent.z / 2);
 
-        northWestUpper = new OcTree<T>();
-        northWestUpper->set_bounds(nwu_center, extentDivide);
-        northEastUpper = new OcTree<T>();
-        northEastUpper->set_bounds(neu_center, extentDivide);
-        southWestUpper = new OcTree<T>();
-        southWestUpper->set_bounds(swu_center, extentDivide);
-        southEastUpper = new OcTree<T>();
-        southEastUpper->set_bounds(seu_center, extentDivide);
-        northWestLower = new OcTree<T>();
-        northWestLower->set_bounds(nwl_center, extentDivide);
-        northEastLower = new OcTree<T>();
-        northEastLower->set_bounds(nel_center, extentDivide);
-        southWestLower = new OcTree<T>();
-        southWestLower->set_bounds(swl_center, extentDivide);
-        southEastLower = new OcTree<T>();
-        southEastLower->set_bounds(sel_center, extentDivide);
-        northWestUpper->parent = this;
-        northEastUpper->parent = this;
-        southWestUpper->parent = this;
-        southEastUpper->parent = this;
-        northWestLower->parent = this;
-        northEastLower->parent = this;
-        southWestLower->parent = this;
-        southEastLower->parent = this;
+        northWestUpper = new OcTree();
+        northEastUpper = new OcTree();
+        southWestUpper = new OcTree();
+        southEastUpper = new OcTree();
+        northWestLower = new OcTree();
+        northEastLower = new OcTree();
+        southWestLower = new OcTree();
+        southEastLower = new OcTree();
+        attach_child(northWestUpper, nwu_center, extentDivide);
+        attach_child(northEastUpper, neu_center, extentDivide);
+        attach_child(southWestUpper, swu_center, extentDivide);
+        attach_child(southEastUpper, seu_center, extentDivide);
+        attach_child(northWestLower, nwl_center, extentDivide);
+        attach_child(northEastLower, nel_center, extentDivide);
+        attach_child(southWestLower, swl_center, extentDivide);
+        attach_child(southEastLower, sel_center, extentDivide);
         set_leaf(false);
 
-        if (northWestUpper->insert(node->data))
+        auto items = node;
+        node.clear();
+        for (unsigned i = 0; i < items.size(); i++)
         {
-            delete node;
-            node = nullptr;
-            return;
-        }
-        if (northEastUpper->insert(node->data))
-        {
-            delete node;
-            node = nullptr;
-            return;
-        }
-        if (southWestUpper->insert(node->data))
-        {
-            delete node;
-            node = nullptr;
-            return;
-        }
-        if (southEastUpper->insert(node->data))
-        {
-            delete node;
-            node = nullptr;
-            return;
-        }
-        if (northWestLower->insert(node->data))
-        {
-            delete node;
-            node = nullptr;
-            return;
-        }
-        if (northEastLower->insert(node->data))
-        {
-            delete node;
-            node = nullptr;
-            return;
-        }
-        if (southWestLower->insert(node->data))
-        {
-            delete node;
-            node = nullptr;
-            return;
-        }
-        southEastLower->insert(node->data);
-        delete node;
-        node = nullptr;
-    }
-
-    bool unsubdivide()
-    {
-        if (!is_leaf())
-        {
-            northWestUpper->unsubdivide();
-            northEastUpper->unsubdivide();
-            southWestUpper->unsubdivide();
-            southEastUpper->unsubdivide();
-            northWestLower->unsubdivide();
-            northEastLower->unsubdivide();
-            southWestLower->unsubdivide();
-            southEastLower->unsubdivide();
-            if (northWestUpper->node == nullptr && northEastUpper->node == nullptr && southWestUpper->node == nullptr && southEastUpper->node == nullptr &&
-                northWestLower->node == nullptr && northEastLower->node == nullptr && southWestLower->node == nullptr && southEastLower->node == nullptr)
-            {
-                delete northWestUpper;
-                delete northEastUpper;
-                delete southWestUpper;
-                delete southEastUpper;
-                delete northWestLower;
-                delete northEastLower;
-                delete southWestLower;
-                delete southEastLower;
-                northWestUpper = nullptr;
-                northEastUpper = nullptr;
-                southWestUpper = nullptr;
-                southEastUpper = nullptr;
-                northWestLower = nullptr;
-                northEastLower = nullptr;
-                southWestLower = nullptr;
-                southEastLower = nullptr;
-                set_leaf(true);
-                return true;
-            }
+            if (!insert_into_children(items[i], max_depth - 1))
+                store(items[i]);
         }
-        return false;
     }
 
 public:
+    static constexpr int MAX_DEPTH = 20;
+
     OcTree() : northWestUpper(nullptr), northEastUpper(nullptr), southWestUpper(nullptr), southEastUpper(nullptr),
-        northWestLower(nullptr), northEastLower(nullptr), southWestLower(nullptr), southEastLower(nullptr)
+        northWestLower(nullptr), northEastLower(nullptr), southWestLower(nullptr), southEastLower(nullptr), parent(nullptr), root(this)
     {
         set_leaf(true);
     };
@@ -187,78 +208,42 @@ public:
         delete southEastLower;
     };
 
-    bool insert(T point, int max_depth = 20)
+    /// @brief Inserts an item, fails only when the item is outside the bounds of the tree
+    /// @param point The item
+    /// @param max_depth How many more levels the cells below this one may be split into
+    bool insert(T point, int max_depth = MAX_DEPTH)
     {
         if (!get_bounds().contains(point))
             return false;
 
-        if (node == nullptr && is_leaf())
+        if (is_leaf())
         {
-            node = new Node<T>();
-            node->data = point;
-            return true;
+            if (!node.is_full() || max_depth <= 0)
+            {
+                store(point);
+                return true;
+            }
+            subdivide(max_depth);
         }
 
-        if (max_depth == 0)
-            return false;
-
-        if (is_leaf())
-            subdivide();
-
-        if (northWestUpper->insert(point, max_depth - 1))
-            return true;
-        if (northEastUpper->insert(point, max_depth - 1))
-            return true;
-        if (southWestUpper->insert(point, max_depth - 1))
-            return true;
-        if (southEastUpper->insert(point, max_depth - 1))
-            return true;
-        if (northWestLower->insert(point, max_depth - 1))
+        if (insert_into_children(point, max_depth - 1))
             return true;
-        if (northEastLower->insert(point, max_depth - 1))
-            return true;
-        if (southWestLower->insert(point, max_depth - 1))
-            return true;
-        if (southEastLower->insert(point, max_depth - 1))
-            return true;
-        return false;
+        // Rounding can leave a point on a seam none of the children contain, the cell keeps it itself
+        store(point);
+        return true;
     };
     T pop(T point)
     {
-        T result = nullptr;
-        if (node != nullptr && node->data == point && is_leaf())
-        {
-            result = node->data;
-            delete node;
-            node = nullptr;
-            return result;
-        }
-        if (northWestUpper == nullptr)
-            return result;
-        result = northWestUpper->pop(point);
-        if (result != nullptr)
-            return result;
-        result = northEastUpper->pop(point);
-        if (result != nullptr)
-            return result;
-        result = southWestUpper->pop(point);
-        if (result != nullptr)
-            return result;
-        result = southEastUpper->pop(point);
-        if (result != nullptr)
-            return result;
-        result = northWestLower->pop(point);
-        if (result != nullptr)
-            return result;
-        result = northEastLower->pop(point);
-        if (result != nullptr)
-            return result;
-        result = southWestLower->pop(point);
-        if (result != nullptr)
-            return result;
-        result = southEastLower->pop(point);
-        return result;
+        auto location = root->locations.find(point);
+        if (location == root->locations.end())
+            return nullptr;
+        auto cell = location->second;
+        root->locations.erase(location);
+        cell->node.remove(point);
+        cell->merge_underfull();
+        return point;
     }
+
     template <typename F>
     std::tuple<unsigned, unsigned> query_range(AABB range, std::vector<F>& found, Frustum* frustum = nullptr)
     {
@@ -276,17 +261,15 @@ public:
                 return std::make_tuple(total, found_count);
         }
 
-        F data = nullptr;
-        if (node != nullptr)
+        for (unsigned i = 0; i < node.size(); i++)
         {
-            data = dynamic_cast<F>(node->data);
+            auto data = dynamic_cast<F>(node[i]);
             total++;
-        }
-
-        if (data != nullptr && range.contains(data))
-        {
-            found_count++;
-            found.push_back(data);
+            if (data != nullptr && range.contains(data))
+            {
+                found_count++;
+                found.push_back(data);
+            }
         }
 
         if (is_leaf())
@@ -325,12 +308,12 @@ public:
         if (!get_bounds().contains(range))
             return;
 
-        F data = nullptr;
-        if (node != nullptr)
-            data = dynamic_cast<F>(node->data);
-
-        if (data != nullptr && range.contains(data) && filter(data))
-            found.push_back(data);
+        for (unsigned i = 0; i < node.size(); i++)
+        {
+            auto data = dynamic_cast<F>(node[i]);
+            if (data != nullptr && range.contains(data) && filter(data))
+                found.push_back(data);
+        }
 
         if (is_leaf())
             return;
@@ -348,12 +331,12 @@ public:
     template <typename F>
     void query(std::vector<F>& found)
     {
-        F data = nullptr;
-        if (node != nullptr)
-            data = dynamic_cast<F>(node->data);
-
-        if (data != nullptr)
-            found.push_back(data);
+        for (unsigned i = 0; i < node.size(); i++)
+        {
+            auto data = dynamic_cast<F>(node[i]);
+            if (data != nullptr)
+                found.push_back(data);
+        }
 
         if (is_leaf())
             return;
@@ -371,12 +354,12 @@ public:
     template <typename F>
     void query(std::vector<F>& found, std::function<bool(const F)> filter)
     {
-        F data = nullptr;
-        if (node != nullptr)
-            data = dynamic_cast<F>(node->data);
-
-        if (data != nullptr && filter(data))
-            found.push_back(data);
+        for (unsigned i = 0; i < node.size(); i++)
+        {
+            auto data = dynamic_cast<F>(node[i]);
+            if (data != nullptr && filter(data))
+                found.push_back(data);
+        }
 
         if (is_leaf())
             return;
@@ -387,6 +370,8 @@ public:
         southEastUpper->query(found, filter);
         northWestLower->query(found, filter);
         northEastLower->query(found, filter);
+        southWestLower->query(found, filter);
+        southEastLower->query(found, filter);
     }
 
     template <typename F>
@@ -394,16 +379,15 @@ public:
     {
         auto total = 0;
         auto found_count = 0;
-        F data = nullptr;
-        if (node != nullptr)
+        for (unsigned i = 0; i < node.size(); i++)
         {
-            data = dynamic_cast<F>(node->data);
+            auto data = dynamic_cast<F>(node[i]);
             total++;
-        }
-        if (data != nullptr && frustum->contains(get_position(data)))
-        {
-            found.push_back(data);
-            found_count++;
+            if (data != nullptr && frustum->contains(get_position(data)))
+            {
+                found.push_back(data);
+                found_count++;
+            }
         }
 
         if (is_leaf())
@@ -436,7 +420,44 @@ public:
         return std::make_tuple(total, found_count);
     }
 
-    void recalculate();
+    /// @brief Moves the items that left their leaf since the last call, items that stayed in their cell cost a single bounds check.
+    /// Items that left the bounds of the whole tree are dropped from it.
+    void recalculate()
+    {
+        std::vector<T> moved;
+        for (auto& [point, cell] : root->locations)
+        {
+            if (!cell->get_bounds().contains(point))
+                moved.push_back(point);
+        }
+
+        for (auto& point : moved)
+        {
+            // Reinserting or merging for an earlier item can move a later one to another cell, so the cell is looked up again
+            auto location = root->locations.find(point);
+            if (location == root->locations.end())
+                continue;
+            auto cell = location->second;
+            if (cell->get_bounds().contains(point))
+                continue;
+
+            cell->node.remove(point);
+            root->locations.erase(location);
+
+            // Climb to the closest cell still containing the item and push it back down from there
+            auto target = cell->parent;
+            while (target != nullptr && !target->get_bounds().contains(point))
+                target = target->parent;
+            if (target != nullptr)
+                target->insert(point, MAX_DEPTH - target->depth);
+
+            cell->merge_underfull();
+        }
+    }
+
+    /// @brief Gets the number of items in the tree
+    size_t size() const { return root->locations.size(); }
+
     void draw_debug(Line* line, bool draw_bounds = true) override
     {
         OcTreeBase::draw_debug(line, draw_bounds);
@@ -452,10 +473,23 @@ public:
         southEastLower->draw_debug(line, false);
     }
 
+    /// @brief Collects the bounds of this cell and of every cell below it
+    void get_cells(std::vector<AABB>& cells)
+    {
+        cells.push_back(get_bounds());
+        if (is_leaf())
+            return;
+        for (auto child : { northWestUpper, northEastUpper, southWestUpper, southEastUpper, northWestLower, northEastLower, southWestLower, southEastLower })
+            child->get_cells(cells);
+    }
+
     T get_node(std::function<bool(T)> predicate)
     {
-        if (node != nullptr && predicate(node->data))
-            return node->data;
+        for (unsigned i = 0; i < node.size(); i++)
+        {
+            if (predicate(node[i]))
+                return node[i];
+        }
         if (is_leaf())
             return nullptr;
         auto result = northWestUpper->get_node(predicate);
@@ -484,11 +518,9 @@ public:
 
     void clear()
     {
-        if (node != nullptr)
-        {
-            delete node;
-            node = nullptr;
-        }
+        if (this == root)
+            locations.clear();
+        node.clear();
         if (northWestUpper != nullptr)
         {
             delete northWestUpper;
@@ -3,8 +3,8 @@
 #include "../objects/base/GameObject.h"
 #include <vector>
 
-template <typename T>
-void QuadTree<T>::recalculate()
+template <typename T, unsigned BucketSize>
+void QuadTree<T, BucketSize>::recalculate()
 {
     throw "Cannot recalculate QuadTree of unknown type";
 }
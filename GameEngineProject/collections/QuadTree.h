@@ -6,7 +6,9 @@
 #include <iostream>
 #include "Node.h"
 
-template <typename T>
+/// @brief Quadtree over the xz plane storing up to BucketSize items per cell before the cell is split.
+/// Cells at the maximum depth keep accepting items past BucketSize so an insert inside the bounds is never dropped.
+template <typename T, unsigned BucketSize = 8>
 class QuadTree
 {
 private:
@@ -19,9 +21,20 @@ private:
     AABB boundary;
     bool recalculated = false;
 
-    Node<T>* node = nullptr;
+    Node<T, BucketSize> node;
 
-    void subdivide()
+    bool insert_into_children(T point, int max_depth)
+    {
+        if (northWest->insert(point, max_depth))
+            return true;
+        if (northEast->insert(point, max_depth))
+            return true;
+        if (southWest->insert(point, max_depth))
+            return true;
+        return southEast->insert(point, max_depth);
+    }
+
+    void subdivide(int max_depth)
     {
         glm::vec3 center = boundary.center;
         glm::vec3 extent = boundary.extent;
@@ -33,40 +46,26 @@ private:
         glm::vec3 sw_center = center + glm::vec3(-extent.x / 2, 0, -extent.z / 2);
         glm::vec3 se_center = center + glm::vec3(extent.x / 2, 0, -extent.z / 2);
 
-        northWest = new QuadTree<T>();
+        northWest = new QuadTree();
         northWest->set_bounds(nw_center, extentDivide);
-        northEast = new QuadTree<T>();
+        northEast = new QuadTree();
         northEast->set_bounds(ne_center, extentDivide);
-        southWest = new QuadTree<T>();
+        southWest = new QuadTree();
         southWest->set_bounds(sw_center, extentDivide);
-        southEast = new QuadTree<T>();
+        southEast = new QuadTree();
         southEast->set_bounds(se_center, extentDivide);
         northWest->parent = this;
         northEast->parent = this;
         southWest->parent = this;
         southEast->parent = this;
 
-        if (northWest->insert(node->data))
+        auto items = node;
+        node.clear();
+        for (unsigned i = 0; i < items.size(); i++)
         {
-            delete node;
-            node = nullptr;
-            return;
+            if (!insert_into_children(items[i], max_depth - 1))
+                node.push(items[i]);
         }
-        if (northEast->insert(node->data))
-        {
-            delete node;
-            node = nullptr;
-            return;
-        }
-        if (southWest->insert(node->data))
-        {
-            delete node;
-            node = nullptr;
-            return;
-        }
-        southEast->insert(node->data);
-        delete node;
-        node = nullptr;
     };
 
     bool unsubdivide()
@@ -77,7 +76,8 @@ private:
             northEast->unsubdivide();
             southWest->unsubdivide();
             southEast->unsubdivide();
-            if (northWest->node == nullptr && northEast->node == nullptr && southWest->node == nullptr && southEast->node == nullptr)
+            if (northWest->is_leaf() && northEast->is_leaf() && southWest->is_leaf() && southEast->is_leaf() &&
+                northWest->node.empty() && northEast->node.empty() && southWest->node.empty() && southEast->node.empty())
             {
                 delete northWest;
                 delete northEast;
@@ -105,47 +105,42 @@ public:
     };
 
     bool is_leaf() const { return northWest == nullptr; }
-    bool insert(T point)
+    static constexpr int MAX_DEPTH = 20;
+
+    /// @brief Inserts an item, fails only when the item is outside the bounds of the tree
+    /// @param point The item
+    /// @param max_depth How many more levels the cells below this one may be split into
+    bool insert(T point, int max_depth = MAX_DEPTH)
     {
         if (!boundary.contains(point))
             return false;
 
-        if (node == nullptr && is_leaf())
+        if (is_leaf())
         {
-            node = new Node<T>();
-            node->data = point;
-            return true;
+            if (!node.is_full() || max_depth <= 0)
+            {
+                node.push(point);
+                return true;
+            }
+            subdivide(max_depth);
         }
 
-        if (is_leaf())
-            subdivide();
-
-        if (northWest->insert(point))
+        if (insert_into_children(point, max_depth - 1))
             return true;
-        if (northEast->insert(point))
-            return true;
-        if (southWest->insert(point))
-            return true;
-        if (southEast->insert(point))
-            return true;
-        return false;
+        // Rounding can leave a point on a seam none of the children contain, the cell keeps it itself
+        node.push(point);
+        return true;
     };
 
     T pop(T point)
     {
-        T result = nullptr;
-        if (node != nullptr && node->data == point && is_leaf())
-        {
-            result = node->data;
-            delete node;
-            node = nullptr;
-            return result;
-        }
+        if (node.remove(point))
+            return point;
 
         if (northWest == nullptr)
-            return result;
+            return nullptr;
 
-        result = northWest->pop(point);
+        T result = northWest->pop(point);
         if (result != nullptr)
             return result;
         result = northEast->pop(point);
@@ -158,13 +153,16 @@ public:
         return result;
     };
 
-    void query_range(const AABB& range, std::vector<T>& found)
+    void query_range(AABB range, std::vector<T>& found)
     {
         if (!boundary.contains(range))
             return;
 
-        if (node != nullptr && range.contains(node->data))
-            found.push_back(node->data);
+        for (unsigned i = 0; i < node.size(); i++)
+        {
+            if (range.contains(node[i]))
+                found.push_back(node[i]);
+        }
 
         if (northWest == nullptr)
             return;
@@ -174,13 +172,16 @@ public:
         southWest->query_range(range, found);
         southEast->query_range(range, found);
     };
-    void query_range(const AABB& range, std::vector<T>& found, std::function<bool(const T&)> filter)
+    void query_range(AABB range, std::vector<T>& found, std::function<bool(const T&)> filter)
     {
         if (!boundary.contains(range))
             return;
 
-        if (node != nullptr && range.contains(node->data) && filter(node->data))
-            found.push_back(node->data);
+        for (unsigned i = 0; i < node.size(); i++)
+        {
+            if (range.contains(node[i]) && filter(node[i]))
+                found.push_back(node[i]);
+        }
 
         if (northWest == nullptr)
             return;
@@ -207,6 +208,7 @@ public:
     {
         boundary.center = center;
         boundary.extent = extent;
+        boundary.recalculate();
     }
     void recalculate();
 };
\ No newline at end of file
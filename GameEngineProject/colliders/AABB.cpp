@@ -3,6 +3,7 @@
 #include "../ShaderStore.h"
 #include "../Material.h"
 #include "../objects/base/GameObject.h"
+#include <cmath>
 
 AABB::AABB(glm::vec3 center, glm::vec3 extent) : center(center), extent(extent)
 {
@@ -48,8 +49,7 @@ void AABB::draw_debug(Line* line)
     line->draw();
 }
 
-template <>
-bool AABB::contains<GameObject*>(GameObject* const& point) const
+bool AABB::contains(GameObject* const& point) const
 {
     return contains(point->get_component<TransformComponent>()->get_position());
 }
@@ -71,7 +71,7 @@ bool AABB::is_on_frustum(Frustum* frustum)
 
 bool AABB::is_on_or_forward_plane(Plane* plane)
 {
-    const float r = extent.x * abs(plane->normal.x) + extent.y * abs(plane->normal.y) + extent.z * abs(plane->normal.z);
+    const float r = extent.x * std::abs(plane->normal.x) + extent.y * std::abs(plane->normal.y) + extent.z * std::abs(plane->normal.z);
     return -r <= plane->getSignedDistanceToPlane(center);
 }
 
@@ -11,6 +11,8 @@ class Line;
 class AABB : public Collider<AABB>
 {
 public:
+    static constexpr ColliderShape SHAPE = SHAPE_AABB;
+
     glm::vec3 center;
     glm::vec3 extent;
     glm::vec3 min;
@@ -34,8 +36,7 @@ public:
         throw message + typeid(T).name();
     }
 
-    template <>
-    bool contains<glm::vec3>(const glm::vec3& point) const
+    bool contains(const glm::vec3& point) const
     {
         return (min.x <= point.x &&
             max.x >= point.x &&
@@ -55,12 +56,13 @@ public:
             center.z + extent.z >= other.center.z - other.extent.z);
     }
 
-    template <>
-    bool contains<GameObject*>(GameObject* const& point) const;
+    bool contains(GameObject* const& point) const;
 
     void update(GameObject* object) override;
 
     bool is_on_frustum(Frustum* frustum) override;
+    glm::vec3 get_center() override { return center; }
+    AABB get_bounds() override { return AABB(center, extent); }
 
     bool is_on_or_forward_plane(Plane* plane);
 
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <glm/vec3.hpp>
+#include "../ecs/entity.h"
+
+class ThreadPool;
+
+/// @brief Two bodies whose bounds overlap, a broadphase reports every pair once
+struct BroadphasePair
+{
+    Entity a;
+    Entity b;
+};
+
+/// @brief Finds the pairs of bodies that might be touching so the narrowphase only tests those.
+/// Bodies are identified by their entity and stay in the broadphase until they are removed.
+class Broadphase
+{
+protected:
+    // Broadphases that can search on several threads use this pool, null when they should stay on the calling thread
+    ThreadPool* pool = nullptr;
+
+public:
+    virtual ~Broadphase() = default;
+
+    /// @brief Adds a body or moves an existing one to new bounds
+    virtual void update(Entity entity, const glm::vec3& min, const glm::vec3& max) = 0;
+    /// @brief Removes a body, does nothing if the body is not in the broadphase
+    virtual void remove(Entity entity) = 0;
+    /// @brief Replaces the contents of pairs with every pair of bodies whose bounds overlap
+    virtual void find_pairs(std::vector<BroadphasePair>& pairs) = 0;
+    /// @brief Gets the number of bodies in the broadphase
+    virtual size_t size() const = 0;
+    /// @brief Gets the name shown when selecting a broadphase
+    virtual const char* get_name() const = 0;
+
+    void set_pool(ThreadPool* pool) { this->pool = pool; }
+};
\ No newline at end of file
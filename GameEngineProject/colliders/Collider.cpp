@@ -1,37 +1,33 @@
 #include "Collider.h"
 #include "SphereCollider.h"
+#include "AABB.h"
+#include "Sweep.h"
 #include "../objects/base/GameObject.h"
 
+AABB ColliderBase::get_bounds()
+{
+    return AABB(get_center(), glm::vec3(get_radius()));
+}
+
 template <>
-float ColliderBase::collision_delta<SphereCollider>(SphereCollider* collider, float delta_time)
+float ColliderBase::collision_delta<SphereCollider>(SphereCollider* collider, const glm::vec3& motion)
 {
-    if (dynamic_cast<SphereCollider*>(this) == nullptr)
+    if (get_shape() != SHAPE_SPHERE)
         return -1;
-    auto th = dynamic_cast<SphereCollider*>(this);
-    auto r1 = th->get_radius();
-    auto r2 = collider->get_radius();
-    auto p1 = th->get_center();
-    auto p2 = collider->get_center();
-    auto r = r1 + r2;
-    auto d2 = glm::distance2(p1, p2);
-    auto r2d2 = r * r - d2;
-    if (r2d2 > 0)
-    {
-        auto d = glm::sqrt(d2);
-        auto t = (r - d) / d;
-        return t;
-    }
-    return -1;
+    auto end = collider->get_center() - get_center();
+    return Sweep::sphere_point(end - motion, motion, get_radius() + collider->get_radius());
 }
 
 template <>
-float ColliderBase::collision_delta<ColliderBase>(ColliderBase* collider, float delta_time)
+float ColliderBase::collision_delta<ColliderBase>(ColliderBase* collider, const glm::vec3& motion)
 {
-    return collision_delta(dynamic_cast<SphereCollider*>(collider), delta_time);
+    if (collider->get_shape() != SHAPE_SPHERE)
+        return -1;
+    return collision_delta(static_cast<SphereCollider*>(collider), motion);
 }
 
 template <typename T>
-float ColliderBase::collision_delta(T* collider, float delta_time)
+float ColliderBase::collision_delta(T* collider, const glm::vec3& motion)
 {
     return -1;
 }
\ No newline at end of file
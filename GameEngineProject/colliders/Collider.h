@@ -7,6 +7,8 @@
 #include "../culling/Frustum.h"
 
 class GameObject;
+class AABB;
+class SphereCollider;
 
 enum CollisionResponse
 {
@@ -21,21 +23,33 @@ enum CollisionChannel
     DYNAMIC
 };
 
+/// @brief Tag of the concrete collider type, narrowphase tests are looked up by the tags of both colliders
+enum ColliderShape
+{
+    SHAPE_SPHERE,
+    SHAPE_AABB,
+    // Any convex collider, tested through its support function with GJK
+    SHAPE_CONVEX,
+    SHAPE_COUNT
+};
+
 class ColliderBase
 {
 private:
     GameObject* parent;
     CollisionResponse response;
     CollisionChannel channel;
+    ColliderShape shape;
 
 public:
-    ColliderBase(GameObject* parent) : parent(parent), response(CollisionResponse::COLLIDE), channel(CollisionChannel::DYNAMIC) {}
-    ColliderBase() : parent(nullptr) {}
+    ColliderBase(GameObject* parent, ColliderShape shape = SHAPE_CONVEX) : parent(parent), response(CollisionResponse::COLLIDE), channel(CollisionChannel::DYNAMIC), shape(shape) {}
+    ColliderBase() : parent(nullptr), shape(SHAPE_CONVEX) {}
     virtual ~ColliderBase() {}
 
     GameObject* get_parent() { return parent; }
     CollisionResponse get_response() { return response; }
     CollisionChannel get_channel() { return channel; }
+    ColliderShape get_shape() const { return shape; }
 
     void set_response(CollisionResponse response) { this->response = response; }
     void set_channel(CollisionChannel channel) { this->channel = channel; }
@@ -45,8 +59,13 @@ public:
     virtual float get_radius() { return 0.0f; }
     virtual glm::vec3 get_center() { return glm::vec3(0.0f); }
     virtual bool is_on_frustum(Frustum* frustum) { return true; }
+    /// @brief Gets the world space bounds of the collider, used by the broadphase
+    virtual AABB get_bounds();
+    /// @brief Finds when during the last tick this collider first touched another one, both are at their positions at the end of the tick
+    /// @param motion How far the other collider moved relative to this one during the tick
+    /// @return The fraction of the tick at the first touch, -1 if they did not touch or already overlapped at the start of the tick
     template <typename T>
-    float collision_delta(T* collider, float delta_time);
+    float collision_delta(T* collider, const glm::vec3& motion);
 
     virtual glm::vec3 find_furthest_point(glm::vec3 direction) = 0;
     glm::vec3 support(ColliderBase& other, glm::vec3 direction)
@@ -59,6 +78,11 @@ public:
     }
 };
 
+template <>
+float ColliderBase::collision_delta<SphereCollider>(SphereCollider* collider, const glm::vec3& motion);
+template <>
+float ColliderBase::collision_delta<ColliderBase>(ColliderBase* collider, const glm::vec3& motion);
+
 template <typename T>
 class Collider : public ColliderBase
 {
@@ -66,8 +90,9 @@ protected:
     std::vector<std::function<void(Collider*)>> onCollisionCallbacks;
 
 public:
-    Collider(GameObject* parent) : ColliderBase(parent) {}
-    Collider() : ColliderBase() {}
+    // T::SHAPE tags every collider with its concrete type so the narrowphase never needs a dynamic_cast
+    Collider(GameObject* parent) : ColliderBase(parent, T::SHAPE) {}
+    Collider() : ColliderBase(nullptr, T::SHAPE) {}
     virtual ~Collider() {}
     void add_callback(std::function<void(Collider*)> callback) { onCollisionCallbacks.push_back(callback); }
 
@@ -3,6 +3,8 @@
 #include "ConvexHull.h"
 #include "SphereCollider.h"
 #include "../objects/base/GameObject.h"
+#include <array>
+#include <utility>
 
 static glm::vec3 get_collision_normal(AABB* a, AABB* b)
 {
@@ -55,80 +57,265 @@ static glm::vec3 get_collision_normal(SphereCollider* a, SphereCollider* b)
 {
     glm::vec3 normal = a->get_center() - b->get_center();
     float distance = glm::length(normal);
-    if (distance < a->radius + b->radius)
+    if (distance < a->get_radius() + b->get_radius())
     {
         return glm::normalize(normal);
     }
     return glm::normalize(normal);
 }
 
-glm::vec3 ColliderHandler::get_collision_normal(ColliderBase* a, ColliderBase* b)
+static bool get_contact(SphereCollider* a, SphereCollider* b, Contact& contact)
+{
+    auto offset = b->get_center() - a->get_center();
+    auto radius = a->get_radius() + b->get_radius();
+    auto distance2 = glm::dot(offset, offset);
+    if (distance2 > radius * radius)
+        return false;
+    auto distance = glm::sqrt(distance2);
+    // Spheres on the same center are pushed apart along y
+    contact.normal = distance > 1e-6f ? offset / distance : glm::vec3(0, 1, 0);
+    contact.depth = radius - distance;
+    return true;
+}
+
+static bool get_contact(SphereCollider* a, AABB* b, Contact& contact)
 {
-    auto sca = dynamic_cast<SphereCollider*>(a);
-    auto scb = dynamic_cast<SphereCollider*>(b);
-    auto aba = dynamic_cast<AABB*>(a);
-    auto abb = dynamic_cast<AABB*>(b);
-    if (sca != nullptr && scb != nullptr)
+    auto center = a->get_center();
+    auto radius = a->get_radius();
+    auto min = b->center - b->extent;
+    auto max = b->center + b->extent;
+    auto closest = glm::clamp(center, min, max);
+    auto offset = closest - center;
+    auto distance2 = glm::dot(offset, offset);
+    if (distance2 > radius * radius)
+        return false;
+    if (distance2 > 1e-12f)
+    {
+        auto distance = glm::sqrt(distance2);
+        contact.normal = offset / distance;
+        contact.depth = radius - distance;
+        return true;
+    }
+
+    // The center is inside the box, push out through the closest face
+    auto to_min = center - min;
+    auto to_max = max - center;
+    auto depth = to_min.x;
+    contact.normal = glm::vec3(1, 0, 0);
+    if (to_max.x < depth)
+    {
+        depth = to_max.x;
+        contact.normal = glm::vec3(-1, 0, 0);
+    }
+    if (to_min.y < depth)
     {
-        return get_collision_normal(sca, scb);
+        depth = to_min.y;
+        contact.normal = glm::vec3(0, 1, 0);
     }
-    else if (sca != nullptr && abb != nullptr)
+    if (to_max.y < depth)
     {
-        return get_collision_normal(sca, abb);
+        depth = to_max.y;
+        contact.normal = glm::vec3(0, -1, 0);
     }
-    else if (aba != nullptr && scb != nullptr)
+    if (to_min.z < depth)
     {
-        return get_collision_normal(aba, scb);
+        depth = to_min.z;
+        contact.normal = glm::vec3(0, 0, 1);
     }
-    else if (aba != nullptr && abb != nullptr)
+    if (to_max.z < depth)
     {
-        return get_collision_normal(aba, abb);
+        depth = to_max.z;
+        contact.normal = glm::vec3(0, 0, -1);
     }
-    auto at = type_name<decltype(a)>();
-    auto bt = type_name<decltype(b)>();
-    throw;
+    contact.depth = depth + radius;
+    return true;
 }
 
-CollisionType ColliderHandler::get_collision_type(ColliderBase* a, ColliderBase* b)
+static bool get_contact(AABB* a, AABB* b, Contact& contact)
+{
+    auto offset = b->center - a->center;
+    auto overlap = a->extent + b->extent - glm::abs(offset);
+    if (overlap.x < 0.0f || overlap.y < 0.0f || overlap.z < 0.0f)
+        return false;
+    // Separate along the axis with the least overlap
+    int axis = 0;
+    if (overlap.y < overlap[axis])
+        axis = 1;
+    if (overlap.z < overlap[axis])
+        axis = 2;
+    contact.normal = glm::vec3(0.0f);
+    contact.normal[axis] = offset[axis] < 0.0f ? -1.0f : 1.0f;
+    contact.depth = overlap[axis];
+    return true;
+}
+
+namespace
 {
-    auto sca = dynamic_cast<SphereCollider*>(a);
-    auto scb = dynamic_cast<SphereCollider*>(b);
-    auto aba = dynamic_cast<AABB*>(a);
-    auto abb = dynamic_cast<AABB*>(b);
-    if (sca != nullptr && scb != nullptr)
+    // Every pair of shapes without a dedicated test falls back to GJK, which works on any two convex colliders
+
+    template <ColliderShape A, ColliderShape B>
+    struct ContainsTest
     {
-        return { sca->contains(*scb), get_collision_normal(sca, scb), a, b };
-    }
-    else if (sca != nullptr && abb != nullptr)
+        static bool call(ColliderBase* a, ColliderBase* b) { return GJK::intersects(*a, *b); }
+    };
+
+    template <ColliderShape A, ColliderShape B>
+    struct NormalTest
     {
-        return { sca->contains(*abb), get_collision_normal(sca, abb), a, b };
-    }
-    else if (aba != nullptr && scb != nullptr)
+        static glm::vec3 call(ColliderBase* a, ColliderBase* b)
+        {
+            glm::vec3 normal;
+            float depth;
+            if (GJK::penetration(*a, *b, normal, depth))
+                return normal;
+            return glm::normalize(b->get_center() - a->get_center());
+        }
+    };
+
+    template <ColliderShape A, ColliderShape B>
+    struct ContactTest
+    {
+        static bool call(ColliderBase* a, ColliderBase* b, Contact& contact, GJK::Simplex* cache)
+        {
+            return GJK::penetration(*a, *b, contact.normal, contact.depth, cache);
+        }
+    };
+
+    template <>
+    struct ContainsTest<SHAPE_SPHERE, SHAPE_SPHERE>
+    {
+        static bool call(ColliderBase* a, ColliderBase* b) { return static_cast<SphereCollider*>(a)->contains(*static_cast<SphereCollider*>(b)); }
+    };
+
+    template <>
+    struct ContainsTest<SHAPE_SPHERE, SHAPE_AABB>
+    {
+        static bool call(ColliderBase* a, ColliderBase* b) { return static_cast<SphereCollider*>(a)->contains(*static_cast<AABB*>(b)); }
+    };
+
+    template <>
+    struct ContainsTest<SHAPE_AABB, SHAPE_SPHERE>
+    {
+        static bool call(ColliderBase* a, ColliderBase* b) { return ContainsTest<SHAPE_SPHERE, SHAPE_AABB>::call(b, a); }
+    };
+
+    template <>
+    struct ContainsTest<SHAPE_AABB, SHAPE_AABB>
+    {
+        static bool call(ColliderBase* a, ColliderBase* b) { return static_cast<AABB*>(a)->contains(*static_cast<AABB*>(b)); }
+    };
+
+    template <>
+    struct NormalTest<SHAPE_SPHERE, SHAPE_SPHERE>
+    {
+        static glm::vec3 call(ColliderBase* a, ColliderBase* b) { return get_collision_normal(static_cast<SphereCollider*>(a), static_cast<SphereCollider*>(b)); }
+    };
+
+    template <>
+    struct NormalTest<SHAPE_SPHERE, SHAPE_AABB>
+    {
+        static glm::vec3 call(ColliderBase* a, ColliderBase* b) { return get_collision_normal(static_cast<SphereCollider*>(a), static_cast<AABB*>(b)); }
+    };
+
+    template <>
+    struct NormalTest<SHAPE_AABB, SHAPE_SPHERE>
     {
-        return { aba->contains(*scb), get_collision_normal(aba, scb), a, b };
+        static glm::vec3 call(ColliderBase* a, ColliderBase* b) { return get_collision_normal(static_cast<AABB*>(a), static_cast<SphereCollider*>(b)); }
+    };
+
+    template <>
+    struct NormalTest<SHAPE_AABB, SHAPE_AABB>
+    {
+        static glm::vec3 call(ColliderBase* a, ColliderBase* b) { return get_collision_normal(static_cast<AABB*>(a), static_cast<AABB*>(b)); }
+    };
+
+    template <>
+    struct ContactTest<SHAPE_SPHERE, SHAPE_SPHERE>
+    {
+        static bool call(ColliderBase* a, ColliderBase* b, Contact& contact, GJK::Simplex*) { return get_contact(static_cast<SphereCollider*>(a), static_cast<SphereCollider*>(b), contact); }
+    };
+
+    template <>
+    struct ContactTest<SHAPE_SPHERE, SHAPE_AABB>
+    {
+        static bool call(ColliderBase* a, ColliderBase* b, Contact& contact, GJK::Simplex*) { return get_contact(static_cast<SphereCollider*>(a), static_cast<AABB*>(b), contact); }
+    };
+
+    template <>
+    struct ContactTest<SHAPE_AABB, SHAPE_SPHERE>
+    {
+        static bool call(ColliderBase* a, ColliderBase* b, Contact& contact, GJK::Simplex*)
+        {
+            if (!get_contact(static_cast<SphereCollider*>(b), static_cast<AABB*>(a), contact))
+                return false;
+            contact.normal = -contact.normal;
+            return true;
+        }
+    };
+
+    template <>
+    struct ContactTest<SHAPE_AABB, SHAPE_AABB>
+    {
+        static bool call(ColliderBase* a, ColliderBase* b, Contact& contact, GJK::Simplex*) { return get_contact(static_cast<AABB*>(a), static_cast<AABB*>(b), contact); }
+    };
+
+    template <template <ColliderShape, ColliderShape> class Test, size_t A, size_t... B>
+    constexpr auto make_row(std::index_sequence<B...>)
+    {
+        return std::array{ &Test<ColliderShape(A), ColliderShape(B)>::call... };
     }
-    else if (aba != nullptr && abb != nullptr)
+
+    /// @brief Fills table[a][b] with Test<a, b>::call for every pair of shapes
+    template <template <ColliderShape, ColliderShape> class Test, size_t... A>
+    constexpr auto make_table(std::index_sequence<A...>)
     {
-        return { aba->contains(*abb), get_collision_normal(aba, abb), a, b };
+        return std::array{ make_row<Test, A>(std::make_index_sequence<SHAPE_COUNT>())... };
     }
-    auto at = type_name<decltype(a)>();
-    auto bt = type_name<decltype(b)>();
-    throw;
+
+    constexpr auto contains_table = make_table<ContainsTest>(std::make_index_sequence<SHAPE_COUNT>());
+    constexpr auto normal_table = make_table<NormalTest>(std::make_index_sequence<SHAPE_COUNT>());
+    constexpr auto contact_table = make_table<ContactTest>(std::make_index_sequence<SHAPE_COUNT>());
+}
+
+glm::vec3 ColliderHandler::get_collision_normal(ColliderBase* a, ColliderBase* b)
+{
+    return normal_table[a->get_shape()][b->get_shape()](a, b);
+}
+
+CollisionType ColliderHandler::get_collision_type(ColliderBase* a, ColliderBase* b)
+{
+    return { contains(a, b), get_collision_normal(a, b), a, b };
 }
 
 bool ColliderHandler::contains(ColliderBase* a, ColliderBase* b)
 {
-    auto sca = dynamic_cast<SphereCollider*>(a);
-    auto scb = dynamic_cast<SphereCollider*>(b);
-    auto aba = dynamic_cast<AABB*>(a);
-    auto abb = dynamic_cast<AABB*>(b);
-    if (sca != nullptr && scb != nullptr)
-        return sca->contains(*scb);
-    else if (sca != nullptr && abb != nullptr)
-        return sca->contains(*abb);
-    else if (aba != nullptr && scb != nullptr)
-        return aba->contains(*scb);
-    else if (aba != nullptr && abb != nullptr)
-        return aba->contains(*abb);
-    return false;
+    return contains_table[a->get_shape()][b->get_shape()](a, b);
+}
+
+bool ColliderHandler::get_contact(ColliderBase* a, ColliderBase* b, Contact& contact, GJK::Simplex* cache)
+{
+    contact.a = a;
+    contact.b = b;
+    return contact_table[a->get_shape()][b->get_shape()](a, b, contact, cache);
+}
+
+bool ColliderHandler::uses_gjk(ColliderShape a, ColliderShape b)
+{
+    // Spheres and AABBs have dedicated tests against each other
+    return a == SHAPE_CONVEX || b == SHAPE_CONVEX;
 }
+
+void ColliderHandler::get_contacts(const std::vector<ColliderPair>& pairs, std::vector<ContactManifold>& manifolds)
+{
+    manifolds.clear();
+    ContactManifold manifold;
+    for (unsigned i = 0; i < pairs.size(); i++)
+    {
+        auto& pair = pairs[i];
+        manifold.pair = i;
+        manifold.contact.a = pair.a;
+        manifold.contact.b = pair.b;
+        if (contact_table[pair.a->get_shape()][pair.b->get_shape()](pair.a, pair.b, manifold.contact, pair.cache))
+            manifolds.push_back(manifold);
+    }
+}
\ No newline at end of file
@@ -1,8 +1,9 @@
 #pragma once
 
+#include <vector>
 #include <glm/vec3.hpp>
-#include <detail/typename.h>
 #include "Collider.h"
+#include "GJK.h"
 
 struct CollisionType
 {
@@ -13,6 +14,35 @@ struct CollisionType
     ColliderBase* b;
 };
 
+/// @brief Contact between two overlapping colliders
+struct Contact
+{
+    ColliderBase* a;
+    ColliderBase* b;
+    /// @brief The normal of the contact pointing from collider a to collider b
+    glm::vec3 normal;
+    /// @brief How far the colliders overlap along the normal
+    float depth;
+};
+
+/// @brief Two colliders to find the contact of, with the GJK simplex of the last query on the pair
+struct ColliderPair
+{
+    ColliderBase* a;
+    ColliderBase* b;
+    GJK::Simplex* cache;
+};
+
+/// @brief The contact of one pair from a batch. Bodies do not rotate, so a single normal and depth describe the whole contact
+struct ContactManifold
+{
+    /// @brief Index of the pair in the batch
+    unsigned pair;
+    Contact contact;
+};
+
+/// @brief Narrowphase tests between colliders.
+/// Tests are looked up in tables indexed by the shape tags of both colliders, pairs of shapes without a dedicated test use GJK
 namespace ColliderHandler
 {
     template <class TA, class TB>
@@ -48,4 +78,18 @@ namespace ColliderHandler
     }
 
     CollisionType get_collision_type(ColliderBase* a, ColliderBase* b);
+
+    /// @brief Finds the contact between two colliders. Sphere-sphere and sphere-AABB are solved directly,
+    /// every other pair of convex colliders goes through GJK and EPA
+    /// @param contact Filled with the contact if the colliders overlap
+    /// @param cache The GJK simplex of the last query on this pair, can be null
+    /// @return true if the colliders overlap
+    bool get_contact(ColliderBase* a, ColliderBase* b, Contact& contact, GJK::Simplex* cache = nullptr);
+
+    /// @brief Checks if the contact between two shapes is found with GJK, only those pairs use a GJK::Simplex cache
+    bool uses_gjk(ColliderShape a, ColliderShape b);
+
+    /// @brief Finds the contacts of a batch of pairs
+    /// @param manifolds Replaced with a manifold for every pair that overlaps, in the order of the pairs
+    void get_contacts(const std::vector<ColliderPair>& pairs, std::vector<ContactManifold>& manifolds);
 };
\ No newline at end of file
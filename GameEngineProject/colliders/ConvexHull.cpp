@@ -1,10 +1,15 @@
 #include "ConvexHull.h"
+#include "GJK.h"
+#include "QuickHull.h"
+#include "../threading/ThreadPool.h"
+#include <glm/gtx/norm.hpp>
 #include "../ShaderStore.h"
 #include "../Material.h"
 #include "../objects/base/GameObject.h"
 
-ConvexHull::ConvexHull(AABB bounds, GameObjectBase* parent) : parent(parent)
+ConvexHull::ConvexHull(AABB bounds, GameObjectBase* parent) : ConvexHull(std::vector<glm::vec3>(), dynamic_cast<GameObject*>(parent))
 {
+    this->parent = parent;
     hull = new GameObjectBase();
     hull->set_shader(ShaderStore::get_shader("noLight"));
     hull->set_mode(GL_LINE);
@@ -40,6 +45,83 @@ ConvexHull::ConvexHull(AABB bounds, GameObjectBase* parent) : parent(parent)
 
     hull->update_vertices(vertices);
     hull->update_indices(indices);
+
+    std::vector<glm::vec3> corners;
+    for (auto& vertex : vertices)
+        corners.push_back(vertex.position);
+    set_points(corners);
+}
+
+ConvexHull::ConvexHull(const std::vector<glm::vec3>& points, GameObject* parent) : Collider(parent), hull(nullptr), parent(parent), center(0.0f)
+{
+    set_points(points);
+}
+
+void ConvexHull::set_points(const std::vector<glm::vec3>& points)
+{
+    this->points = points;
+    update(get_parent());
+}
+
+void ConvexHull::update(GameObject* object)
+{
+    world_points.resize(points.size());
+    center = glm::vec3(0.0f);
+    glm::mat4 model(1.0f);
+    if (object != nullptr && object->get_component<TransformComponent>() != nullptr)
+        model = object->get_model_matrix();
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        world_points[i] = glm::vec3(model * glm::vec4(points[i], 1.0f));
+        center += world_points[i];
+    }
+    if (!points.empty())
+        center /= static_cast<float>(points.size());
+}
+
+float ConvexHull::get_radius()
+{
+    auto radius2 = 0.0f;
+    for (auto& point : world_points)
+        radius2 = glm::max(radius2, glm::distance2(point, center));
+    return glm::sqrt(radius2);
+}
+
+AABB ConvexHull::get_bounds()
+{
+    if (world_points.empty())
+        return AABB(center, glm::vec3(0.0f));
+    auto min = world_points[0];
+    auto max = world_points[0];
+    for (auto& point : world_points)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    return AABB((min + max) * 0.5f, (max - min) * 0.5f);
+}
+
+glm::vec3 ConvexHull::find_furthest_point(glm::vec3 direction)
+{
+    if (world_points.empty())
+        return center;
+    auto furthest = world_points[0];
+    auto furthest_distance = glm::dot(furthest, direction);
+    for (auto& point : world_points)
+    {
+        auto distance = glm::dot(point, direction);
+        if (distance > furthest_distance)
+        {
+            furthest_distance = distance;
+            furthest = point;
+        }
+    }
+    return furthest;
+}
+
+bool ConvexHull::contains(ConvexHull& other)
+{
+    return GJK::intersects(*this, other);
 }
 
 void ConvexHull::gift_wrap(GameObjectBase* GameObjectBase)
@@ -49,17 +131,45 @@ void ConvexHull::gift_wrap(GameObjectBase* GameObjectBase)
 
 void ConvexHull::quick_hull(GameObjectBase* GameObjectBase)
 {
-    // TODO implement quick hull algorithm
+    auto vertices = GameObjectBase->get_vertices();
+    std::vector<glm::vec3> positions(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+        positions[i] = vertices[i].position;
+    source = QuickHull::get_cached(positions, MAX_VERTICES, &ThreadPool::get_global());
+    set_points(source->points);
+
+    if (hull == nullptr)
+        return;
+    // Draw every edge of the hull once, an edge is shared by two triangles
+    std::vector<Vertex> hull_vertices;
+    for (auto& point : source->points)
+        hull_vertices.push_back(Vertex(point));
+    std::vector<unsigned> indices;
+    for (size_t i = 0; i < source->indices.size(); i += 3)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            auto a = source->indices[i + j];
+            auto b = source->indices[i + (j + 1) % 3];
+            if (a < b)
+            {
+                indices.push_back(a);
+                indices.push_back(b);
+            }
+        }
+    }
+    hull->update_vertices(hull_vertices);
+    hull->update_indices(indices);
 }
 
 void ConvexHull::draw_debug()
 {
-    hull->draw();
+    if (hull != nullptr)
+        hull->draw();
 }
 
 template <>
 bool ConvexHull::contains<ConvexHull>(const ConvexHull& collider) const
 {
-    // TODO implement intersection check with GJK algorithm
-    return false;
+    return GJK::intersects(*const_cast<ConvexHull*>(this), const_cast<ConvexHull&>(collider));
 }
\ No newline at end of file
@@ -1,26 +1,45 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <glm/vec3.hpp>
 #include "AABB.h"
 #include "Collider.h"
+#include "QuickHull.h"
 
 class GameObjectBase;
 
-/// @brief Not implemented yet
+/// @brief Convex collider around a set of points.
+/// The points are kept relative to the parent and moved by its transform on update, intersections are found with GJK.
 class ConvexHull : public Collider<ConvexHull>
 {
 private:
     GameObjectBase* hull;
     GameObjectBase* parent;
+    // Points of the hull relative to the parent
+    std::vector<glm::vec3> points;
+    // The points moved by the transform of the parent on the last update
+    std::vector<glm::vec3> world_points;
+    glm::vec3 center;
+    // The cached hull quick_hull built the points from, held so hulls around the same mesh keep sharing it
+    std::shared_ptr<const QuickHull::Hull> source;
 
 public:
+    static constexpr ColliderShape SHAPE = SHAPE_CONVEX;
+
+    /// @brief The most corners quick_hull keeps, more corners only make the support function slower
+    static constexpr unsigned MAX_VERTICES = 64;
+
     /// @brief Default constructor
-    ConvexHull() : hull(nullptr), parent(nullptr) {};
+    ConvexHull() : hull(nullptr), parent(nullptr), center(0.0f) {};
     /// @brief Constructor that creates a convex hull based on AABB bounds
     /// @param bounds The bounds of the convex hull
     /// @param parent The GameObjectBase that is the parent of the convex hull
     ConvexHull(AABB bounds, GameObjectBase* parent);
+    /// @brief Constructor that creates a convex hull around a set of points, without a debug mesh
+    /// @param points The points relative to the parent, points inside the hull only cost time in the support function
+    /// @param parent The GameObject whose transform moves the hull, null to keep the points where they are
+    ConvexHull(const std::vector<glm::vec3>& points, GameObject* parent);
     ~ConvexHull()
     {
         delete hull;
@@ -29,11 +48,26 @@ public:
     /// @brief Uses the gift wrapping algorithm to create a convex hull around the GameObjectBase in 2d space (x,z) and expands it to 3d space with the highest and lowest y values of the GameObjectBase
     /// @param GameObjectBase The GameObjectBase to create a convex hull around
     void gift_wrap(GameObjectBase* GameObjectBase);
-    /// @brief Uses the quick hull algorithm to create a convex hull around the GameObjectBase in 3d space
+    /// @brief Uses the quick hull algorithm to create a convex hull around the GameObjectBase in 3d space.
+    /// The hull is capped to MAX_VERTICES corners and cached, so another hull around the same vertices is not built again
     /// @param GameObjectBase The GameObjectBase to create a convex hull around
     void quick_hull(GameObjectBase* GameObjectBase);
     /// @brief Draws the convex hull in debug mode
     void draw_debug();
+
+    const std::vector<glm::vec3>& get_points() const { return points; }
+    void set_points(const std::vector<glm::vec3>& points);
+
+    void update(GameObject* object) override;
+    glm::vec3 get_center() override { return center; }
+    /// @brief Gets the distance from the center to the furthest point of the hull
+    float get_radius() override;
+    AABB get_bounds() override;
+    glm::vec3 find_furthest_point(glm::vec3 direction) override;
+
+    /// @brief Checks if the convex hull intersects with another convex hull using GJK
+    bool contains(ConvexHull& other) override;
+
     /// @brief Checks if the convex hull intersects with another collider and if so returns true
     /// @tparam T
     /// @param collider The collider to check for intersection with
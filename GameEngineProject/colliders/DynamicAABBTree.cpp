@@ -0,0 +1,388 @@
+#include "DynamicAABBTree.h"
+#include "../threading/ThreadPool.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+
+// How many ticks of its last movement the bounds of a body are stretched ahead of it
+static constexpr float DISPLACEMENT_MULTIPLIER = 4.0f;
+// Below this many bodies pairs are searched on the calling thread
+static constexpr size_t PARALLEL_PAIR_THRESHOLD = 2048;
+
+static float surface_area(const glm::vec3& min, const glm::vec3& max)
+{
+    auto size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static bool overlaps(const glm::vec3& min_a, const glm::vec3& max_a, const glm::vec3& min_b, const glm::vec3& max_b)
+{
+    return min_a.x <= max_b.x && max_a.x >= min_b.x &&
+        min_a.y <= max_b.y && max_a.y >= min_b.y &&
+        min_a.z <= max_b.z && max_a.z >= min_b.z;
+}
+
+DynamicAABBTree::DynamicAABBTree(float margin) : margin(margin)
+{
+}
+
+int DynamicAABBTree::allocate_node()
+{
+    if (free_list == NULL_NODE)
+    {
+        nodes.push_back(TreeNode());
+        free_list = static_cast<int>(nodes.size()) - 1;
+        nodes[free_list].parent = NULL_NODE;
+    }
+    auto node = free_list;
+    free_list = nodes[node].parent;
+    nodes[node].parent = NULL_NODE;
+    nodes[node].child1 = NULL_NODE;
+    nodes[node].child2 = NULL_NODE;
+    nodes[node].height = 0;
+    nodes[node].entity = Entity::null();
+    return node;
+}
+
+void DynamicAABBTree::free_node(int node)
+{
+    nodes[node].parent = free_list;
+    nodes[node].height = -1;
+    free_list = node;
+}
+
+void DynamicAABBTree::refit(int node)
+{
+    auto& parent = nodes[node];
+    auto& child1 = nodes[parent.child1];
+    auto& child2 = nodes[parent.child2];
+    parent.min = glm::min(child1.min, child2.min);
+    parent.max = glm::max(child1.max, child2.max);
+    parent.height = 1 + std::max(child1.height, child2.height);
+}
+
+void DynamicAABBTree::insert_leaf(int leaf)
+{
+    if (root == NULL_NODE)
+    {
+        root = leaf;
+        nodes[root].parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down to the sibling that grows the total surface area of the tree the least
+    auto leaf_min = nodes[leaf].min;
+    auto leaf_max = nodes[leaf].max;
+    auto index = root;
+    while (!nodes[index].is_leaf())
+    {
+        auto& node = nodes[index];
+        auto area = surface_area(node.min, node.max);
+        auto combined_area = surface_area(glm::min(node.min, leaf_min), glm::max(node.max, leaf_max));
+        // Cost of making a new parent for this node and the leaf
+        auto cost = 2.0f * combined_area;
+        // Cost every ancestor pays for growing to fit the leaf
+        auto inheritance = 2.0f * (combined_area - area);
+
+        auto descend_cost = [&](const TreeNode& child)
+        {
+            auto grown = surface_area(glm::min(child.min, leaf_min), glm::max(child.max, leaf_max));
+            if (child.is_leaf())
+                return grown + inheritance;
+            return grown - surface_area(child.min, child.max) + inheritance;
+        };
+        auto cost1 = descend_cost(nodes[node.child1]);
+        auto cost2 = descend_cost(nodes[node.child2]);
+
+        if (cost < cost1 && cost < cost2)
+            break;
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    auto sibling = index;
+    auto old_parent = nodes[sibling].parent;
+    auto new_parent = allocate_node();
+    nodes[new_parent].parent = old_parent;
+    nodes[new_parent].child1 = sibling;
+    nodes[new_parent].child2 = leaf;
+    nodes[sibling].parent = new_parent;
+    nodes[leaf].parent = new_parent;
+    if (old_parent == NULL_NODE)
+        root = new_parent;
+    else if (nodes[old_parent].child1 == sibling)
+        nodes[old_parent].child1 = new_parent;
+    else
+        nodes[old_parent].child2 = new_parent;
+
+    for (index = new_parent; index != NULL_NODE; index = nodes[index].parent)
+    {
+        index = balance(index);
+        refit(index);
+    }
+}
+
+void DynamicAABBTree::remove_leaf(int leaf)
+{
+    if (leaf == root)
+    {
+        root = NULL_NODE;
+        return;
+    }
+
+    auto parent = nodes[leaf].parent;
+    auto grand_parent = nodes[parent].parent;
+    auto sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+    free_node(parent);
+
+    if (grand_parent == NULL_NODE)
+    {
+        root = sibling;
+        nodes[sibling].parent = NULL_NODE;
+        return;
+    }
+
+    if (nodes[grand_parent].child1 == parent)
+        nodes[grand_parent].child1 = sibling;
+    else
+        nodes[grand_parent].child2 = sibling;
+    nodes[sibling].parent = grand_parent;
+
+    for (auto index = grand_parent; index != NULL_NODE; index = nodes[index].parent)
+    {
+        index = balance(index);
+        refit(index);
+    }
+}
+
+// Rotates the taller grandchild up when the heights of the two children differ by more than one, returns the node now in this position
+int DynamicAABBTree::balance(int a)
+{
+    if (nodes[a].is_leaf() || nodes[a].height < 2)
+        return a;
+
+    auto b = nodes[a].child1;
+    auto c = nodes[a].child2;
+    auto difference = nodes[c].height - nodes[b].height;
+    if (difference >= -1 && difference <= 1)
+        return a;
+
+    // The taller child moves up into the place of a, a takes the shorter grandchild
+    auto up = difference > 1 ? c : b;
+    auto f = nodes[up].child1;
+    auto g = nodes[up].child2;
+
+    nodes[up].child1 = a;
+    nodes[up].parent = nodes[a].parent;
+    nodes[a].parent = up;
+    if (nodes[up].parent == NULL_NODE)
+        root = up;
+    else if (nodes[nodes[up].parent].child1 == a)
+        nodes[nodes[up].parent].child1 = up;
+    else
+        nodes[nodes[up].parent].child2 = up;
+
+    auto taller = nodes[f].height > nodes[g].height ? f : g;
+    auto shorter = taller == f ? g : f;
+    nodes[up].child2 = taller;
+    if (up == c)
+        nodes[a].child2 = shorter;
+    else
+        nodes[a].child1 = shorter;
+    nodes[shorter].parent = a;
+
+    refit(a);
+    refit(up);
+    return up;
+}
+
+void DynamicAABBTree::update(Entity entity, const glm::vec3& min, const glm::vec3& max)
+{
+    auto index = entity.get_index();
+    if (index >= proxies.size())
+        proxies.resize(index + 1, NULL_NODE);
+
+    auto leaf = proxies[index];
+    if (leaf != NULL_NODE && nodes[leaf].entity != entity)
+    {
+        // The index was reused by a new entity while the old one was never removed
+        remove_leaf(leaf);
+        free_node(leaf);
+        leaf_count--;
+        leaf = NULL_NODE;
+    }
+
+    auto center = (min + max) * 0.5f;
+    glm::vec3 displacement(0.0f);
+    if (leaf != NULL_NODE)
+    {
+        auto& node = nodes[leaf];
+        displacement = center - node.center;
+        node.center = center;
+        if (glm::all(glm::lessThanEqual(node.min, min)) && glm::all(glm::greaterThanEqual(node.max, max)))
+            return;
+        // Stretch the new bounds ahead of the motion so a body moving steadily is not reinserted every tick
+        displacement *= DISPLACEMENT_MULTIPLIER;
+        remove_leaf(leaf);
+    }
+    else
+    {
+        leaf = allocate_node();
+        nodes[leaf].entity = entity;
+        nodes[leaf].center = center;
+        proxies[index] = leaf;
+        leaf_count++;
+    }
+
+    nodes[leaf].min = min - glm::vec3(margin) + glm::min(displacement, glm::vec3(0.0f));
+    nodes[leaf].max = max + glm::vec3(margin) + glm::max(displacement, glm::vec3(0.0f));
+    insert_leaf(leaf);
+}
+
+void DynamicAABBTree::remove(Entity entity)
+{
+    auto index = entity.get_index();
+    if (index >= proxies.size())
+        return;
+    auto leaf = proxies[index];
+    if (leaf == NULL_NODE || nodes[leaf].entity != entity)
+        return;
+    remove_leaf(leaf);
+    free_node(leaf);
+    proxies[index] = NULL_NODE;
+    leaf_count--;
+}
+
+bool DynamicAABBTree::contains(Entity entity) const
+{
+    auto index = entity.get_index();
+    return index < proxies.size() && proxies[index] != NULL_NODE && nodes[proxies[index]].entity == entity;
+}
+
+void DynamicAABBTree::query(const glm::vec3& min, const glm::vec3& max, std::vector<Entity>& found) const
+{
+    if (root == NULL_NODE)
+        return;
+    std::vector<int> stack;
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        auto& node = nodes[stack.back()];
+        stack.pop_back();
+        if (!overlaps(node.min, node.max, min, max))
+            continue;
+        if (node.is_leaf())
+        {
+            found.push_back(node.entity);
+            continue;
+        }
+        stack.push_back(node.child1);
+        stack.push_back(node.child2);
+    }
+}
+
+void DynamicAABBTree::self_pairs(int node, std::vector<BroadphasePair>& pairs) const
+{
+    auto& parent = nodes[node];
+    if (parent.is_leaf())
+        return;
+    self_pairs(parent.child1, pairs);
+    self_pairs(parent.child2, pairs);
+    cross_pairs(parent.child1, parent.child2, pairs);
+}
+
+void DynamicAABBTree::cross_pairs(int a, int b, std::vector<BroadphasePair>& pairs) const
+{
+    auto& node_a = nodes[a];
+    auto& node_b = nodes[b];
+    if (!overlaps(node_a.min, node_a.max, node_b.min, node_b.max))
+        return;
+    if (node_a.is_leaf() && node_b.is_leaf())
+    {
+        pairs.push_back({ node_a.entity, node_b.entity });
+        return;
+    }
+    // Descend into the larger of the two so both sides shrink at about the same rate
+    if (node_b.is_leaf() || (!node_a.is_leaf() && surface_area(node_a.min, node_a.max) > surface_area(node_b.min, node_b.max)))
+    {
+        cross_pairs(node_a.child1, b, pairs);
+        cross_pairs(node_a.child2, b, pairs);
+    }
+    else
+    {
+        cross_pairs(a, node_b.child1, pairs);
+        cross_pairs(a, node_b.child2, pairs);
+    }
+}
+
+// Collides the tree with itself, every pair of overlapping leaves is found exactly once because the two sides of a
+// search are always disjoint subtrees
+void DynamicAABBTree::find_pairs(std::vector<BroadphasePair>& pairs)
+{
+    pairs.clear();
+    if (root == NULL_NODE)
+        return;
+    if (pool == nullptr || leaf_count < PARALLEL_PAIR_THRESHOLD)
+    {
+        self_pairs(root, pairs);
+        return;
+    }
+
+    // Split the top of the search into independent tasks, a task with the same node on both sides searches within that subtree
+    tasks.clear();
+    tasks.push_back({ root, root });
+    size_t target = pool->get_concurrency() * 8;
+    for (size_t next = 0; next < tasks.size() && tasks.size() - next < target; next++)
+    {
+        auto [a, b] = tasks[next];
+        auto& node_a = nodes[a];
+        auto& node_b = nodes[b];
+        if (a == b)
+        {
+            if (node_a.is_leaf())
+                continue;
+            tasks.push_back({ node_a.child1, node_a.child1 });
+            tasks.push_back({ node_a.child2, node_a.child2 });
+            tasks.push_back({ node_a.child1, node_a.child2 });
+        }
+        else if (!overlaps(node_a.min, node_a.max, node_b.min, node_b.max))
+        {
+            continue;
+        }
+        else if (!node_a.is_leaf())
+        {
+            tasks.push_back({ node_a.child1, b });
+            tasks.push_back({ node_a.child2, b });
+        }
+        else if (!node_b.is_leaf())
+        {
+            tasks.push_back({ a, node_b.child1 });
+            tasks.push_back({ a, node_b.child2 });
+        }
+        else
+        {
+            // Two overlapping leaves, the parallel pass reports the pair
+            continue;
+        }
+        // The expanded task is replaced by its children
+        tasks[next] = { NULL_NODE, NULL_NODE };
+    }
+
+    // Every task writes its own list so the result is in the same order whichever thread ran the task
+    task_pairs.resize(tasks.size());
+    pool->parallel_for(0, static_cast<int>(tasks.size()), 1, [this](int begin, int end)
+        {
+            for (int i = begin; i < end; i++)
+            {
+                auto [a, b] = tasks[i];
+                auto& found = task_pairs[i];
+                found.clear();
+                if (a == NULL_NODE)
+                    continue;
+                if (a == b)
+                    self_pairs(a, found);
+                else
+                    cross_pairs(a, b, found);
+            }
+        });
+    for (auto& found : task_pairs)
+        pairs.insert(pairs.end(), found.begin(), found.end());
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <glm/vec3.hpp>
+#include "Broadphase.h"
+
+/// @brief Incrementally updated bounding volume hierarchy.
+/// Every body is a leaf holding its bounds grown by a margin, a body that stays inside its grown bounds does not touch the tree.
+/// Leaves are inserted next to the sibling that grows the surface area the least and the tree is kept balanced with rotations.
+class DynamicAABBTree : public Broadphase
+{
+private:
+    static constexpr int NULL_NODE = -1;
+
+    struct TreeNode
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+        // The parent, or the next free node while the node is on the free list
+        int parent;
+        int child1;
+        int child2;
+        // 0 for leaves, -1 for free nodes
+        int height;
+        Entity entity;
+        // Center of the real bounds of a leaf at the last update, used to predict where the body is going
+        glm::vec3 center;
+
+        bool is_leaf() const { return child1 == NULL_NODE; }
+    };
+
+    std::vector<TreeNode> nodes;
+    int root = NULL_NODE;
+    int free_list = NULL_NODE;
+    size_t leaf_count = 0;
+    float margin;
+    // Indexed by Entity::get_index, the leaf of every body
+    std::vector<int> proxies;
+    std::vector<std::pair<int, int>> tasks;
+    std::vector<std::vector<BroadphasePair>> task_pairs;
+
+    int allocate_node();
+    void free_node(int node);
+    void insert_leaf(int leaf);
+    void remove_leaf(int leaf);
+    int balance(int node);
+    void refit(int node);
+    void self_pairs(int node, std::vector<BroadphasePair>& pairs) const;
+    void cross_pairs(int a, int b, std::vector<BroadphasePair>& pairs) const;
+
+public:
+    /// @brief Creates an empty tree
+    /// @param margin How far the stored bounds reach past the real bounds of a body
+    explicit DynamicAABBTree(float margin = 0.1f);
+
+    void update(Entity entity, const glm::vec3& min, const glm::vec3& max) override;
+    void remove(Entity entity) override;
+    void find_pairs(std::vector<BroadphasePair>& pairs) override;
+    size_t size() const override { return leaf_count; }
+    const char* get_name() const override { return "AABB tree"; }
+
+    /// @brief Checks if a body is in the tree
+    bool contains(Entity entity) const;
+    /// @brief Finds the bodies whose stored bounds overlap a box
+    /// @param found The bodies are appended to this
+    void query(const glm::vec3& min, const glm::vec3& max, std::vector<Entity>& found) const;
+
+    /// @brief Gets the height of the tree, a balanced tree stays close to log2 of the body count
+    int get_height() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+};
\ No newline at end of file
@@ -0,0 +1,492 @@
+#include "GJK.h"
+#include "Collider.h"
+#include <algorithm>
+#include <atomic>
+#include <initializer_list>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+
+static constexpr int MAX_ITERATIONS = 64;
+static constexpr int MAX_EPA_ITERATIONS = 64;
+// Relative progress below which GJK stops looking for a closer point
+static constexpr float GJK_TOLERANCE = 1e-6f;
+// How close the support point has to be to the nearest face of the polytope for EPA to stop
+static constexpr float EPA_TOLERANCE = 1e-4f;
+
+static std::atomic<uint64_t> query_count = 0;
+static std::atomic<uint64_t> iteration_count = 0;
+static std::atomic<uint64_t> epa_iteration_count = 0;
+
+static glm::vec3 support(ColliderBase& a, ColliderBase& b, const glm::vec3& direction)
+{
+    return a.support(b, direction);
+}
+
+// The closest_on functions find the point of a simplex closest to the origin and reduce the simplex to the points
+// of the feature that point lies on
+
+static glm::vec3 closest_on_segment(GJK::Simplex& simplex, int i, int j)
+{
+    auto a = simplex.points[i];
+    auto ab = simplex.points[j] - a;
+    auto length2 = glm::dot(ab, ab);
+    auto t = length2 > 0.0f ? glm::dot(-a, ab) / length2 : 0.0f;
+    GJK::Simplex result;
+    if (t <= 0.0f)
+    {
+        result.points[0] = simplex.points[i];
+        result.directions[0] = simplex.directions[i];
+        result.size = 1;
+    }
+    else if (t >= 1.0f)
+    {
+        result.points[0] = simplex.points[j];
+        result.directions[0] = simplex.directions[j];
+        result.size = 1;
+    }
+    else
+    {
+        result.points[0] = simplex.points[i];
+        result.directions[0] = simplex.directions[i];
+        result.points[1] = simplex.points[j];
+        result.directions[1] = simplex.directions[j];
+        result.size = 2;
+    }
+    simplex = result;
+    return a + glm::clamp(t, 0.0f, 1.0f) * ab;
+}
+
+static void keep(GJK::Simplex& simplex, std::initializer_list<int> indices)
+{
+    GJK::Simplex result;
+    for (auto i : indices)
+    {
+        result.points[result.size] = simplex.points[i];
+        result.directions[result.size] = simplex.directions[i];
+        result.size++;
+    }
+    simplex = result;
+}
+
+// Voronoi region test of the origin against triangle abc, from Ericson's Real-Time Collision Detection
+static glm::vec3 closest_on_triangle(GJK::Simplex& simplex, int i, int j, int k)
+{
+    auto a = simplex.points[i];
+    auto b = simplex.points[j];
+    auto c = simplex.points[k];
+    auto ab = b - a;
+    auto ac = c - a;
+    auto ap = -a;
+    auto d1 = glm::dot(ab, ap);
+    auto d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+    {
+        keep(simplex, { i });
+        return a;
+    }
+
+    auto bp = -b;
+    auto d3 = glm::dot(ab, bp);
+    auto d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3)
+    {
+        keep(simplex, { j });
+        return b;
+    }
+
+    auto vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+    {
+        auto v = d1 / (d1 - d3);
+        keep(simplex, { i, j });
+        return a + v * ab;
+    }
+
+    auto cp = -c;
+    auto d5 = glm::dot(ab, cp);
+    auto d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6)
+    {
+        keep(simplex, { k });
+        return c;
+    }
+
+    auto vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+    {
+        auto w = d2 / (d2 - d6);
+        keep(simplex, { i, k });
+        return a + w * ac;
+    }
+
+    auto va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+    {
+        auto w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        keep(simplex, { j, k });
+        return b + w * (c - b);
+    }
+
+    auto sum = va + vb + vc;
+    if (sum == 0.0f)
+    {
+        // Degenerate triangle, the closest of its edges decides
+        GJK::Simplex edge = simplex;
+        auto closest = closest_on_segment(edge, i, j);
+        auto best = edge;
+        for (auto [e0, e1] : { std::pair{ j, k }, std::pair{ i, k } })
+        {
+            GJK::Simplex other = simplex;
+            auto point = closest_on_segment(other, e0, e1);
+            if (glm::dot(point, point) < glm::dot(closest, closest))
+            {
+                closest = point;
+                best = other;
+            }
+        }
+        simplex = best;
+        return closest;
+    }
+    keep(simplex, { i, j, k });
+    return a + ab * (vb / sum) + ac * (vc / sum);
+}
+
+static glm::vec3 closest_on_tetrahedron(GJK::Simplex& simplex)
+{
+    static const int faces[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } };
+    auto best_distance = std::numeric_limits<float>::max();
+    glm::vec3 best_point(0.0f);
+    GJK::Simplex best = simplex;
+    bool outside = false;
+    for (auto& face : faces)
+    {
+        auto a = simplex.points[face[0]];
+        auto normal = glm::cross(simplex.points[face[1]] - a, simplex.points[face[2]] - a);
+        auto origin_side = glm::dot(-a, normal);
+        auto opposite_side = glm::dot(simplex.points[face[3]] - a, normal);
+        // The origin is behind this face when it is on the other side from the fourth point, a flat tetrahedron tests every face
+        if (origin_side * opposite_side > 0.0f)
+            continue;
+        outside = true;
+        GJK::Simplex reduced = simplex;
+        auto point = closest_on_triangle(reduced, face[0], face[1], face[2]);
+        auto distance = glm::dot(point, point);
+        if (distance < best_distance)
+        {
+            best_distance = distance;
+            best_point = point;
+            best = reduced;
+        }
+    }
+    if (!outside)
+        return glm::vec3(0.0f);
+    simplex = best;
+    return best_point;
+}
+
+static glm::vec3 closest_point(GJK::Simplex& simplex)
+{
+    switch (simplex.size)
+    {
+    case 1:
+        return simplex.points[0];
+    case 2:
+        return closest_on_segment(simplex, 0, 1);
+    case 3:
+        return closest_on_triangle(simplex, 0, 1, 2);
+    default:
+        return closest_on_tetrahedron(simplex);
+    }
+}
+
+static void push(GJK::Simplex& simplex, const glm::vec3& point, const glm::vec3& direction)
+{
+    simplex.points[simplex.size] = point;
+    simplex.directions[simplex.size] = direction;
+    simplex.size++;
+}
+
+/// @brief Runs GJK, leaves the simplex containing the origin if the colliders overlap
+static bool run_gjk(ColliderBase& a, ColliderBase& b, GJK::Simplex& simplex, GJK::Simplex* cache)
+{
+    simplex.size = 0;
+    if (cache != nullptr && glm::dot(cache->separating_axis, cache->separating_axis) > 0.0f)
+    {
+        auto point = support(a, b, cache->separating_axis);
+        if (glm::dot(point, cache->separating_axis) < 0.0f)
+        {
+            query_count.fetch_add(1, std::memory_order_relaxed);
+            iteration_count.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    if (cache != nullptr)
+    {
+        // Rebuild the cached simplex at the current positions, points that collapsed onto each other are dropped
+        for (int i = 0; i < cache->size; i++)
+        {
+            auto point = support(a, b, cache->directions[i]);
+            bool duplicate = false;
+            for (int j = 0; j < simplex.size; j++)
+                duplicate |= glm::dot(simplex.points[j] - point, simplex.points[j] - point) < 1e-12f;
+            if (!duplicate)
+                push(simplex, point, cache->directions[i]);
+        }
+    }
+    if (simplex.size == 0)
+    {
+        auto direction = b.get_center() - a.get_center();
+        if (glm::dot(direction, direction) < 1e-12f)
+            direction = glm::vec3(1.0f, 0.0f, 0.0f);
+        push(simplex, support(a, b, direction), direction);
+    }
+
+    bool overlapping = false;
+    glm::vec3 direction(0.0f);
+    int iterations = 0;
+    for (; iterations < MAX_ITERATIONS; iterations++)
+    {
+        auto closest = closest_point(simplex);
+        auto distance2 = glm::dot(closest, closest);
+        if (simplex.size == 4 || distance2 < 1e-12f)
+        {
+            overlapping = true;
+            break;
+        }
+
+        direction = -closest;
+        auto point = support(a, b, direction);
+        // The support point does not reach past the origin, so the origin is outside the Minkowski difference
+        if (glm::dot(point, direction) < 0.0f)
+            break;
+        // No closer point can be found, the colliders are touching at most
+        if (distance2 - glm::dot(closest, point) <= GJK_TOLERANCE * distance2)
+            break;
+        push(simplex, point, direction);
+    }
+
+    query_count.fetch_add(1, std::memory_order_relaxed);
+    iteration_count.fetch_add(iterations + 1, std::memory_order_relaxed);
+    if (cache != nullptr)
+    {
+        *cache = simplex;
+        cache->separating_axis = overlapping ? glm::vec3(0.0f) : direction;
+    }
+    return overlapping;
+}
+
+bool GJK::intersects(ColliderBase& a, ColliderBase& b, Simplex* cache)
+{
+    Simplex simplex;
+    return run_gjk(a, b, simplex, cache);
+}
+
+/// @brief Grows a simplex containing the origin into a tetrahedron so EPA has a volume to expand
+static bool make_tetrahedron(ColliderBase& a, ColliderBase& b, GJK::Simplex& simplex)
+{
+    static const glm::vec3 axes[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    auto try_direction = [&](const glm::vec3& direction)
+    {
+        auto point = support(a, b, direction);
+        for (int i = 0; i < simplex.size; i++)
+        {
+            if (glm::dot(simplex.points[i] - point, simplex.points[i] - point) < 1e-10f)
+                return false;
+        }
+        if (simplex.size == 2)
+        {
+            auto along = glm::cross(simplex.points[1] - simplex.points[0], point - simplex.points[0]);
+            if (glm::dot(along, along) < 1e-12f)
+                return false;
+        }
+        else if (simplex.size == 3)
+        {
+            auto normal = glm::cross(simplex.points[1] - simplex.points[0], simplex.points[2] - simplex.points[0]);
+            if (std::abs(glm::dot(normal, point - simplex.points[0])) < 1e-10f)
+                return false;
+        }
+        push(simplex, point, direction);
+        return true;
+    };
+
+    while (simplex.size < 4)
+    {
+        bool grown = false;
+        if (simplex.size == 3)
+        {
+            auto normal = glm::cross(simplex.points[1] - simplex.points[0], simplex.points[2] - simplex.points[0]);
+            grown = try_direction(normal) || try_direction(-normal);
+        }
+        else if (simplex.size == 2)
+        {
+            // Try directions around the segment
+            auto along = simplex.points[1] - simplex.points[0];
+            auto side = std::abs(along.x) < 0.57f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+            auto perpendicular = glm::cross(along, side);
+            for (int i = 0; i < 6 && !grown; i++)
+            {
+                grown = try_direction(perpendicular);
+                perpendicular = glm::cross(along, perpendicular);
+                if (i == 3)
+                    perpendicular = glm::cross(along, glm::cross(along, side));
+            }
+        }
+        else
+        {
+            for (auto& axis : axes)
+            {
+                if ((grown = try_direction(axis)))
+                    break;
+            }
+        }
+        if (!grown)
+            return false;
+    }
+    return true;
+}
+
+struct PolytopeFace
+{
+    int a, b, c;
+    glm::vec3 normal;
+    float distance;
+};
+
+static bool make_face(const std::vector<glm::vec3>& vertices, const glm::vec3& inside, int a, int b, int c, PolytopeFace& face)
+{
+    auto normal = glm::cross(vertices[b] - vertices[a], vertices[c] - vertices[a]);
+    auto length = glm::length(normal);
+    if (length < 1e-12f)
+        return false;
+    normal /= length;
+    // Faces wind so their normal points out of the polytope. The origin can lie on the surface when the colliders
+    // only touch, so the side is decided by a point that is always strictly inside
+    if (glm::dot(normal, vertices[a] - inside) < 0.0f)
+    {
+        std::swap(b, c);
+        normal = -normal;
+    }
+    face = { a, b, c, normal, glm::max(glm::dot(normal, vertices[a]), 0.0f) };
+    return true;
+}
+
+bool GJK::penetration(ColliderBase& a, ColliderBase& b, glm::vec3& normal, float& depth, Simplex* cache)
+{
+    Simplex simplex;
+    if (!run_gjk(a, b, simplex, cache))
+        return false;
+    if (!make_tetrahedron(a, b, simplex))
+    {
+        // Only flat shapes end up here, they touch without a direction to separate along
+        normal = glm::vec3(0, 1, 0);
+        depth = 0.0f;
+        return true;
+    }
+
+    std::vector<glm::vec3> vertices(simplex.points, simplex.points + 4);
+    auto inside = (vertices[0] + vertices[1] + vertices[2] + vertices[3]) * 0.25f;
+    std::vector<PolytopeFace> faces;
+    static const int tetrahedron[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 0, 2, 3 }, { 1, 3, 2 } };
+    for (auto& indices : tetrahedron)
+    {
+        PolytopeFace face;
+        if (make_face(vertices, inside, indices[0], indices[1], indices[2], face))
+            faces.push_back(face);
+    }
+    if (faces.size() < 4)
+    {
+        normal = glm::vec3(0, 1, 0);
+        depth = 0.0f;
+        return true;
+    }
+
+    std::vector<std::pair<int, int>> horizon;
+    PolytopeFace nearest = faces.front();
+    int iterations = 0;
+    for (; iterations < MAX_EPA_ITERATIONS; iterations++)
+    {
+        nearest = faces.front();
+        for (auto& face : faces)
+        {
+            if (face.distance < nearest.distance)
+                nearest = face;
+        }
+
+        auto point = support(a, b, nearest.normal);
+        if (glm::dot(point, nearest.normal) - nearest.distance < EPA_TOLERANCE)
+            break;
+
+        // Remove every face the new point can see and keep the edges around the hole they leave
+        horizon.clear();
+        for (size_t i = 0; i < faces.size();)
+        {
+            auto& face = faces[i];
+            if (glm::dot(face.normal, point - vertices[face.a]) <= 0.0f)
+            {
+                i++;
+                continue;
+            }
+            for (auto edge : { std::pair{ face.a, face.b }, std::pair{ face.b, face.c }, std::pair{ face.c, face.a } })
+            {
+                // An edge shared by two removed faces is inside the hole, it shows up once in each direction
+                auto reverse = std::find(horizon.begin(), horizon.end(), std::pair{ edge.second, edge.first });
+                if (reverse != horizon.end())
+                    horizon.erase(reverse);
+                else
+                    horizon.push_back(edge);
+            }
+            faces[i] = faces.back();
+            faces.pop_back();
+        }
+
+        auto index = static_cast<int>(vertices.size());
+        vertices.push_back(point);
+        for (auto& [from, to] : horizon)
+        {
+            PolytopeFace face;
+            if (make_face(vertices, inside, from, to, index, face))
+                faces.push_back(face);
+        }
+        if (faces.empty())
+            break;
+    }
+    epa_iteration_count.fetch_add(iterations, std::memory_order_relaxed);
+
+    normal = nearest.normal;
+    depth = nearest.distance;
+    return true;
+}
+
+GJK::Stats GJK::get_stats()
+{
+    return { query_count.load(std::memory_order_relaxed), iteration_count.load(std::memory_order_relaxed), epa_iteration_count.load(std::memory_order_relaxed) };
+}
+
+void GJK::reset_stats()
+{
+    query_count = 0;
+    iteration_count = 0;
+    epa_iteration_count = 0;
+}
+
+GJK::Simplex* GJK::Cache::get(unsigned a, unsigned b)
+{
+    auto& entry = entries[(uint64_t(a) << 32) | b];
+    if (entry.last_used + 1 < frame)
+        entry.simplex.size = 0;
+    entry.last_used = frame;
+    return &entry.simplex;
+}
+
+void GJK::Cache::next_frame()
+{
+    frame++;
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if (it->second.last_used + 1 < frame)
+            it = entries.erase(it);
+        else
+            ++it;
+    }
+}
\ No newline at end of file
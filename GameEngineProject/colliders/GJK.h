@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <glm/vec3.hpp>
+
+class ColliderBase;
+
+/// @brief Intersection and penetration tests between any two convex colliders, using only their support functions.
+/// GJK searches the Minkowski difference a - b for the origin, EPA expands the final simplex to find the shortest way out.
+namespace GJK
+{
+    /// @brief Up to four points of the Minkowski difference together with the directions they were found in.
+    /// The directions are kept so the simplex can be rebuilt from the colliders at their new positions on the next query.
+    struct Simplex
+    {
+        glm::vec3 points[4];
+        glm::vec3 directions[4];
+        int size = 0;
+        // The last search direction when the colliders were apart, it usually still separates them on the next query
+        glm::vec3 separating_axis = glm::vec3(0.0f);
+    };
+
+    /// @brief Counters over every query since the last reset
+    struct Stats
+    {
+        uint64_t queries;
+        uint64_t iterations;
+        uint64_t epa_iterations;
+    };
+
+    /// @brief Checks if two convex colliders overlap
+    /// @param cache The simplex of the last query on this pair, used to start the search and updated with the final simplex. Can be null
+    bool intersects(ColliderBase& a, ColliderBase& b, Simplex* cache = nullptr);
+
+    /// @brief Finds how far two convex colliders overlap
+    /// @param normal Set to the direction b has to move to separate from a
+    /// @param depth Set to how far b has to move along the normal
+    /// @param cache The simplex of the last query on this pair. Can be null
+    /// @return true if the colliders overlap
+    bool penetration(ColliderBase& a, ColliderBase& b, glm::vec3& normal, float& depth, Simplex* cache = nullptr);
+
+    Stats get_stats();
+    void reset_stats();
+
+    /// @brief Simplices of the pairs queried recently, keyed by the pair.
+    /// Bodies move little between ticks so the last simplex is usually close to the answer and the search ends after an iteration or two.
+    class Cache
+    {
+    private:
+        struct Entry
+        {
+            Simplex simplex;
+            unsigned last_used;
+        };
+
+        std::unordered_map<uint64_t, Entry> entries;
+        unsigned frame = 0;
+
+    public:
+        /// @brief Gets the simplex of a pair, empty if the pair was not queried on the last frame
+        /// @param a The id of the first body, the order of a and b has to be the same on every query
+        /// @param b The id of the second body
+        Simplex* get(unsigned a, unsigned b);
+        /// @brief Starts a new frame and forgets the pairs that were not queried on the frame before
+        void next_frame();
+        void clear() { entries.clear(); }
+        size_t size() const { return entries.size(); }
+    };
+};
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "Heightfield.h"
+#include "../objects/base/Vertex.h"
+#include <algorithm>
+#include <glm/common.hpp>
+
+void Heightfield::build_bins(const std::vector<float>& lines, std::vector<unsigned>& bins, float& scale)
+{
+    // One bin per cell, a bin then holds about one grid line and a lookup steps over at most a few
+    auto cells = static_cast<unsigned>(lines.size() - 1);
+    bins.resize(cells);
+    auto width = lines.back() - lines.front();
+    scale = width > 0.0f ? cells / width : 0.0f;
+    unsigned line = 0;
+    for (unsigned bin = 0; bin < cells; bin++)
+    {
+        auto start = lines.front() + bin * (width / cells);
+        while (line + 1 < cells && lines[line + 1] <= start)
+            line++;
+        bins[bin] = line;
+    }
+}
+
+bool Heightfield::find_cell(const std::vector<float>& lines, const std::vector<unsigned>& bins, float scale, float value,
+    unsigned& cell, float& fraction)
+{
+    // Written so nan fails as well
+    if (!(value >= lines.front() && value <= lines.back()))
+        return false;
+    auto bin = std::min(static_cast<unsigned>((value - lines.front()) * scale), static_cast<unsigned>(bins.size() - 1));
+    cell = bins[bin];
+    while (cell + 2 < lines.size() && lines[cell + 1] <= value)
+        cell++;
+    auto width = lines[cell + 1] - lines[cell];
+    fraction = width > 0.0f ? glm::clamp((value - lines[cell]) / width, 0.0f, 1.0f) : 0.0f;
+    return true;
+}
+
+void Heightfield::build(const std::vector<Vertex>& vertices, int rows, int columns)
+{
+    clear();
+    if (rows < 2 || columns < 2 || vertices.size() < size_t(rows) * columns)
+        return;
+
+    xs.resize(rows);
+    zs.resize(columns);
+    for (int i = 0; i < rows; i++)
+        xs[i] = vertices[i * columns].position.x;
+    for (int j = 0; j < columns; j++)
+        zs[j] = vertices[j].position.z;
+    grid_heights.resize(size_t(rows) * columns);
+    grid_normals.resize(size_t(rows) * columns);
+    min_height = vertices[0].position.y;
+    for (size_t i = 0; i < grid_heights.size(); i++)
+    {
+        grid_heights[i] = vertices[i].position.y;
+        grid_normals[i] = vertices[i].normal;
+        min_height = std::min(min_height, grid_heights[i]);
+    }
+    build_bins(xs, x_bins, x_bin_scale);
+    build_bins(zs, z_bins, z_bin_scale);
+}
+
+void Heightfield::clear()
+{
+    xs.clear();
+    zs.clear();
+    grid_heights.clear();
+    grid_normals.clear();
+    x_bins.clear();
+    z_bins.clear();
+    min_height = 0.0f;
+}
+
+bool Heightfield::get_height(float x, float z, float& height, glm::vec3& normal) const
+{
+    unsigned i, j;
+    float s, t;
+    if (empty() || !find_cell(xs, x_bins, x_bin_scale, x, i, s) || !find_cell(zs, z_bins, z_bin_scale, z, j, t))
+    {
+        height = min_height;
+        normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        return false;
+    }
+
+    auto columns = zs.size();
+    auto p0 = i * columns + j;
+    auto p1 = p0 + 1;
+    auto p2 = p0 + columns + 1;
+    auto p3 = p0 + columns;
+    // The diagonal runs from p0 to p2, (p0, p1, p2) is the triangle on the side of larger t
+    float w0, w2, w_side;
+    size_t side;
+    if (t >= s)
+    {
+        w0 = 1.0f - t;
+        w_side = t - s;
+        w2 = s;
+        side = p1;
+    }
+    else
+    {
+        w0 = 1.0f - s;
+        w_side = s - t;
+        w2 = t;
+        side = p3;
+    }
+    height = grid_heights[p0] * w0 + grid_heights[side] * w_side + grid_heights[p2] * w2;
+    normal = grid_normals[p0] * w0 + grid_normals[side] * w_side + grid_normals[p2] * w2;
+    return true;
+}
+
+void Heightfield::get_heights(std::span<const glm::vec3> positions, std::span<float> heights, std::span<glm::vec3> normals) const
+{
+    for (size_t i = 0; i < positions.size(); i++)
+        get_height(positions[i].x, positions[i].z, heights[i], normals[i]);
+}
+
+bool Heightfield::get_cell_range(float min_x, float min_z, float max_x, float max_z,
+    unsigned& min_i, unsigned& min_j, unsigned& max_i, unsigned& max_j) const
+{
+    if (empty() || max_x < xs.front() || min_x > xs.back() || max_z < zs.front() || min_z > zs.back())
+        return false;
+    float fraction;
+    find_cell(xs, x_bins, x_bin_scale, std::max(min_x, xs.front()), min_i, fraction);
+    find_cell(xs, x_bins, x_bin_scale, std::min(max_x, xs.back()), max_i, fraction);
+    find_cell(zs, z_bins, z_bin_scale, std::max(min_z, zs.front()), min_j, fraction);
+    find_cell(zs, z_bins, z_bin_scale, std::min(max_z, zs.back()), max_j, fraction);
+    return true;
+}
\ No newline at end of file
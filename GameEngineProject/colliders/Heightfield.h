@@ -0,0 +1,57 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <glm/vec3.hpp>
+
+struct Vertex;
+
+/// @brief Terrain as heights over a rectilinear grid in the xz plane, for constant time height and normal lookups.
+/// Column i of the grid sits at x = xs[i] and row j at z = zs[j], the spacing may vary but both must increase.
+/// Every cell is split along its (i, j) to (i + 1, j + 1) diagonal into the same two triangles the mesh is drawn with.
+/// A lookup maps x and z to a cell through a table of uniform bins per axis, so it neither searches nor allocates
+/// and any number of threads can query at once.
+class Heightfield
+{
+private:
+    std::vector<float> xs;
+    std::vector<float> zs;
+    // Height and normal of grid point (i, j) are at i * zs.size() + j, the same order as the surface vertices
+    std::vector<float> grid_heights;
+    std::vector<glm::vec3> grid_normals;
+    // For every uniform bin of an axis, the last grid line at or before the start of the bin
+    std::vector<unsigned> x_bins;
+    std::vector<unsigned> z_bins;
+    float x_bin_scale = 0.0f;
+    float z_bin_scale = 0.0f;
+    float min_height = 0.0f;
+
+    static void build_bins(const std::vector<float>& lines, std::vector<unsigned>& bins, float& scale);
+    /// @brief Finds the cell along one axis holding the coordinate and where in the cell it is, from 0 to 1
+    static bool find_cell(const std::vector<float>& lines, const std::vector<unsigned>& bins, float scale, float value,
+        unsigned& cell, float& fraction);
+
+public:
+    /// @brief Builds the heightfield from a rows by columns grid of vertices, vertex (i, j) at i * columns + j.
+    /// Column i is placed at the x of vertex (i, 0) and row j at the z of vertex (0, j).
+    void build(const std::vector<Vertex>& vertices, int rows, int columns);
+    void clear();
+    bool empty() const { return grid_heights.empty(); }
+
+    size_t get_rows() const { return xs.size(); }
+    size_t get_columns() const { return zs.size(); }
+    float get_min_height() const { return min_height; }
+    glm::vec3 get_point(unsigned i, unsigned j) const { return glm::vec3(xs[i], grid_heights[i * zs.size() + j], zs[j]); }
+
+    /// @brief Gets the height of the mesh under a point and the vertex normals blended across the triangle there
+    /// @return false outside the grid, height and normal are then the lowest height and up
+    bool get_height(float x, float z, float& height, glm::vec3& normal) const;
+
+    /// @brief Gets the height and normal under every position, the spans must be the same size
+    void get_heights(std::span<const glm::vec3> positions, std::span<float> heights, std::span<glm::vec3> normals) const;
+
+    /// @brief Gets the cells an xz range covers, clamped to the grid
+    /// @return false if the range misses the grid
+    bool get_cell_range(float min_x, float min_z, float max_x, float max_z,
+        unsigned& min_i, unsigned& min_j, unsigned& max_i, unsigned& max_j) const;
+};
\ No newline at end of file
@@ -0,0 +1,468 @@
+#include "QuickHull.h"
+#include "../threading/ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+// Below this many points the hull is built on the calling thread
+static constexpr size_t PARALLEL_THRESHOLD = 16384;
+
+namespace
+{
+    struct Face
+    {
+        unsigned vertices[3];
+        glm::vec3 normal;
+        float offset;
+        // Points in front of this face that are not yet inside the hull
+        std::vector<unsigned> conflicts;
+        bool removed = false;
+
+        float distance(const glm::vec3& point) const { return glm::dot(normal, point) - offset; }
+    };
+
+    class Builder
+    {
+    private:
+        const std::vector<glm::vec3>& points;
+        float epsilon;
+        std::vector<Face> faces;
+        // Directed edge a -> b to the face that has it, the face on the other side of an edge has the edge b -> a
+        std::unordered_map<uint64_t, unsigned> edges;
+        std::vector<unsigned> visible;
+        std::vector<std::pair<unsigned, unsigned>> horizon;
+        std::vector<unsigned> orphans;
+        std::vector<unsigned> stack;
+
+        static uint64_t edge_key(unsigned a, unsigned b) { return (uint64_t(a) << 32) | b; }
+
+        unsigned add_face(unsigned a, unsigned b, unsigned c)
+        {
+            Face face;
+            face.vertices[0] = a;
+            face.vertices[1] = b;
+            face.vertices[2] = c;
+            face.normal = glm::cross(points[b] - points[a], points[c] - points[a]);
+            auto length = glm::length(face.normal);
+            face.normal = length > 0.0f ? face.normal / length : glm::vec3(0.0f);
+            face.offset = glm::dot(face.normal, points[a]);
+            auto index = static_cast<unsigned>(faces.size());
+            faces.push_back(std::move(face));
+            edges[edge_key(a, b)] = index;
+            edges[edge_key(b, c)] = index;
+            edges[edge_key(c, a)] = index;
+            return index;
+        }
+
+        void remove_face(unsigned index)
+        {
+            auto& face = faces[index];
+            face.removed = true;
+            for (int i = 0; i < 3; i++)
+                edges.erase(edge_key(face.vertices[i], face.vertices[(i + 1) % 3]));
+        }
+
+        /// @brief Gives a point to the new face it is furthest in front of, points behind every face are inside the hull
+        void assign(unsigned point, unsigned first_face)
+        {
+            auto best = epsilon;
+            unsigned best_face = 0xFFFFFFFFu;
+            for (auto f = first_face; f < faces.size(); f++)
+            {
+                auto distance = faces[f].distance(points[point]);
+                if (distance > best)
+                {
+                    best = distance;
+                    best_face = f;
+                }
+            }
+            if (best_face != 0xFFFFFFFFu)
+                faces[best_face].conflicts.push_back(point);
+        }
+
+        /// @brief Finds four points spanning a volume, false if every point lies on a plane
+        bool initial_simplex(unsigned simplex[4]) const
+        {
+            unsigned extremes[6] = {};
+            for (unsigned i = 0; i < points.size(); i++)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    if (points[i][axis] < points[extremes[axis * 2]][axis])
+                        extremes[axis * 2] = i;
+                    if (points[i][axis] > points[extremes[axis * 2 + 1]][axis])
+                        extremes[axis * 2 + 1] = i;
+                }
+            }
+
+            auto best = 0.0f;
+            for (int i = 0; i < 6; i++)
+            {
+                for (int j = i + 1; j < 6; j++)
+                {
+                    auto distance = glm::distance(points[extremes[i]], points[extremes[j]]);
+                    if (distance > best)
+                    {
+                        best = distance;
+                        simplex[0] = extremes[i];
+                        simplex[1] = extremes[j];
+                    }
+                }
+            }
+            if (best <= epsilon)
+                return false;
+
+            auto& a = points[simplex[0]];
+            auto line = glm::normalize(points[simplex[1]] - a);
+            best = 0.0f;
+            for (unsigned i = 0; i < points.size(); i++)
+            {
+                auto distance = glm::length(glm::cross(points[i] - a, line));
+                if (distance > best)
+                {
+                    best = distance;
+                    simplex[2] = i;
+                }
+            }
+            if (best <= epsilon)
+                return false;
+
+            auto normal = glm::normalize(glm::cross(points[simplex[1]] - a, points[simplex[2]] - a));
+            best = 0.0f;
+            for (unsigned i = 0; i < points.size(); i++)
+            {
+                auto distance = std::abs(glm::dot(points[i] - a, normal));
+                if (distance > best)
+                {
+                    best = distance;
+                    simplex[3] = i;
+                }
+            }
+            return best > epsilon;
+        }
+
+        /// @brief Adds the point a face is furthest from to the hull, replacing every face that point can see
+        void add_point(unsigned face_index)
+        {
+            auto& conflicts = faces[face_index].conflicts;
+            auto eye = conflicts[0];
+            auto furthest = faces[face_index].distance(points[eye]);
+            for (auto point : conflicts)
+            {
+                auto distance = faces[face_index].distance(points[point]);
+                if (distance > furthest)
+                {
+                    furthest = distance;
+                    eye = point;
+                }
+            }
+
+            // Flood fill the faces the eye can see, the edges to faces it cannot see form the horizon
+            visible.clear();
+            horizon.clear();
+            stack.clear();
+            stack.push_back(face_index);
+            faces[face_index].removed = true;
+            while (!stack.empty())
+            {
+                auto index = stack.back();
+                stack.pop_back();
+                visible.push_back(index);
+                for (int i = 0; i < 3; i++)
+                {
+                    auto a = faces[index].vertices[i];
+                    auto b = faces[index].vertices[(i + 1) % 3];
+                    auto found = edges.find(edge_key(b, a));
+                    if (found == edges.end())
+                        continue;
+                    auto neighbour = found->second;
+                    if (faces[neighbour].removed)
+                        continue;
+                    if (faces[neighbour].distance(points[eye]) > epsilon)
+                    {
+                        faces[neighbour].removed = true;
+                        stack.push_back(neighbour);
+                    }
+                    else
+                    {
+                        horizon.push_back({ a, b });
+                    }
+                }
+            }
+
+            orphans.clear();
+            for (auto index : visible)
+            {
+                for (auto point : faces[index].conflicts)
+                {
+                    if (point != eye)
+                        orphans.push_back(point);
+                }
+                faces[index].conflicts.clear();
+                faces[index].conflicts.shrink_to_fit();
+                remove_face(index);
+            }
+
+            auto first_new = static_cast<unsigned>(faces.size());
+            for (auto [a, b] : horizon)
+                add_face(a, b, eye);
+            for (auto point : orphans)
+                assign(point, first_new);
+        }
+
+    public:
+        Builder(const std::vector<glm::vec3>& points) : points(points)
+        {
+            auto min = points[0];
+            auto max = points[0];
+            for (auto& point : points)
+            {
+                min = glm::min(min, point);
+                max = glm::max(max, point);
+            }
+            auto scale = glm::max(glm::max(glm::abs(min), glm::abs(max)), max - min);
+            epsilon = 3.0f * std::numeric_limits<float>::epsilon() * (scale.x + scale.y + scale.z);
+        }
+
+        bool build(QuickHull::Hull& hull)
+        {
+            unsigned simplex[4];
+            if (!initial_simplex(simplex))
+                return false;
+
+            // Wind the first four faces so they face away from the fourth point
+            auto& a = points[simplex[0]];
+            auto normal = glm::cross(points[simplex[1]] - a, points[simplex[2]] - a);
+            if (glm::dot(normal, points[simplex[3]] - a) > 0.0f)
+                std::swap(simplex[1], simplex[2]);
+            add_face(simplex[0], simplex[1], simplex[2]);
+            add_face(simplex[0], simplex[3], simplex[1]);
+            add_face(simplex[1], simplex[3], simplex[2]);
+            add_face(simplex[2], simplex[3], simplex[0]);
+            for (unsigned i = 0; i < points.size(); i++)
+            {
+                if (i != simplex[0] && i != simplex[1] && i != simplex[2] && i != simplex[3])
+                    assign(i, 0);
+            }
+
+            // New faces are appended, so one pass over the list reaches every face that ever gets points
+            for (unsigned f = 0; f < faces.size(); f++)
+            {
+                if (!faces[f].removed && !faces[f].conflicts.empty())
+                    add_point(f);
+            }
+
+            std::vector<unsigned> remap(points.size(), 0xFFFFFFFFu);
+            for (auto& face : faces)
+            {
+                if (face.removed)
+                    continue;
+                for (auto vertex : face.vertices)
+                {
+                    if (remap[vertex] == 0xFFFFFFFFu)
+                    {
+                        remap[vertex] = static_cast<unsigned>(hull.points.size());
+                        hull.points.push_back(points[vertex]);
+                    }
+                    hull.indices.push_back(remap[vertex]);
+                }
+            }
+            return true;
+        }
+    };
+}
+
+/// @brief Builds the hull without splitting the input, flat inputs keep their furthest points along the axes and diagonals
+static QuickHull::Hull build_single(const std::vector<glm::vec3>& points)
+{
+    QuickHull::Hull hull;
+    if (points.empty())
+        return hull;
+    Builder builder(points);
+    if (builder.build(hull))
+        return hull;
+
+    // Every point lies on a plane or a line, there are no faces but GJK only needs the corners
+    for (int x = -1; x <= 1; x++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            for (int z = -1; z <= 1; z++)
+            {
+                glm::vec3 direction(x, y, z);
+                if (x == 0 && y == 0 && z == 0)
+                    continue;
+                auto furthest = *std::max_element(points.begin(), points.end(), [&](const glm::vec3& a, const glm::vec3& b)
+                    { return glm::dot(a, direction) < glm::dot(b, direction); });
+                if (std::find(hull.points.begin(), hull.points.end(), furthest) == hull.points.end())
+                    hull.points.push_back(furthest);
+            }
+        }
+    }
+    return hull;
+}
+
+/// @brief Finds the furthest point along directions spread evenly over the sphere, the hull of those fits inside the full hull
+static std::vector<glm::vec3> furthest_points(const std::vector<glm::vec3>& points, unsigned count, ThreadPool* pool)
+{
+    const auto golden_angle = 2.39996323f;
+    std::vector<glm::vec3> directions(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        auto y = 1.0f - 2.0f * (i + 0.5f) / count;
+        auto radius = glm::sqrt(1.0f - y * y);
+        directions[i] = glm::vec3(glm::cos(golden_angle * i) * radius, y, glm::sin(golden_angle * i) * radius);
+    }
+
+    // Every chunk keeps its own furthest point per direction, one pass over the points updates every direction
+    size_t chunk_count = 1;
+    if (pool != nullptr && points.size() >= PARALLEL_THRESHOLD)
+        chunk_count = std::min<size_t>(pool->get_concurrency(), points.size() / (PARALLEL_THRESHOLD / 4));
+    auto chunk_size = (points.size() + chunk_count - 1) / chunk_count;
+    std::vector<float> best(chunk_count * count, -std::numeric_limits<float>::max());
+    std::vector<unsigned> best_index(chunk_count * count, 0);
+    auto find = [&](int begin, int end)
+    {
+        for (int chunk = begin; chunk < end; chunk++)
+        {
+            auto chunk_best = &best[chunk * count];
+            auto chunk_index = &best_index[chunk * count];
+            auto last = std::min(points.size(), (chunk + 1) * chunk_size);
+            for (auto i = chunk * chunk_size; i < last; i++)
+            {
+                for (unsigned d = 0; d < count; d++)
+                {
+                    auto distance = glm::dot(points[i], directions[d]);
+                    if (distance > chunk_best[d])
+                    {
+                        chunk_best[d] = distance;
+                        chunk_index[d] = static_cast<unsigned>(i);
+                    }
+                }
+            }
+        }
+    };
+    if (chunk_count > 1)
+        pool->parallel_for(0, static_cast<int>(chunk_count), 1, find);
+    else
+        find(0, 1);
+
+    std::vector<glm::vec3> unique;
+    for (unsigned d = 0; d < count; d++)
+    {
+        size_t furthest = d;
+        for (size_t chunk = 1; chunk < chunk_count; chunk++)
+        {
+            if (best[chunk * count + d] > best[furthest])
+                furthest = chunk * count + d;
+        }
+        auto& point = points[best_index[furthest]];
+        if (std::find(unique.begin(), unique.end(), point) == unique.end())
+            unique.push_back(point);
+    }
+    return unique;
+}
+
+QuickHull::Hull QuickHull::build(const std::vector<glm::vec3>& points, unsigned max_vertices, ThreadPool* pool)
+{
+    if (max_vertices > 0 && points.size() >= PARALLEL_THRESHOLD)
+    {
+        // A large input would mostly build corners that are thrown away, the furthest points are found from the input directly
+        return build_single(furthest_points(points, max_vertices, pool));
+    }
+
+    size_t chunk_count = 1;
+    if (pool != nullptr && points.size() >= PARALLEL_THRESHOLD)
+        chunk_count = std::min<size_t>(pool->get_concurrency(), points.size() / (PARALLEL_THRESHOLD / 4));
+    if (chunk_count < 2)
+    {
+        auto hull = build_single(points);
+        if (max_vertices == 0 || hull.points.size() <= max_vertices)
+            return hull;
+        return build_single(furthest_points(hull.points, max_vertices, nullptr));
+    }
+
+    // Only the corners of every chunk's hull can be corners of the whole hull
+    std::vector<Hull> chunks(chunk_count);
+    auto chunk_size = (points.size() + chunk_count - 1) / chunk_count;
+    pool->parallel_for(0, static_cast<int>(chunk_count), 1, [&](int begin, int end)
+        {
+            for (int chunk = begin; chunk < end; chunk++)
+            {
+                auto first = points.begin() + chunk * chunk_size;
+                auto last = points.begin() + std::min(points.size(), (chunk + 1) * chunk_size);
+                chunks[chunk] = build_single(std::vector<glm::vec3>(first, last));
+            }
+        });
+    std::vector<glm::vec3> corners;
+    for (auto& chunk : chunks)
+        corners.insert(corners.end(), chunk.points.begin(), chunk.points.end());
+    return build_single(corners);
+}
+
+std::shared_ptr<const QuickHull::Hull> QuickHull::get_cached(const std::vector<glm::vec3>& points, unsigned max_vertices, ThreadPool* pool)
+{
+    // The points are kept to tell apart inputs with the same hash, the hull only lives as long as a caller holds it
+    struct Entry
+    {
+        unsigned max_vertices;
+        std::vector<glm::vec3> points;
+        std::weak_ptr<const Hull> hull;
+    };
+    static std::mutex mutex;
+    static std::unordered_multimap<uint64_t, Entry> cache;
+
+    // FNV-1a over the raw coordinates a word at a time, the same mesh loaded twice hashes the same
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](unsigned word)
+    { hash = (hash ^ word) * 1099511628211ull; };
+    add(max_vertices);
+    add(static_cast<unsigned>(points.size()));
+    for (auto& point : points)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            unsigned word;
+            std::memcpy(&word, &point[axis], sizeof(word));
+            add(word);
+        }
+    }
+
+    auto find = [&]() -> std::shared_ptr<const Hull>
+    {
+        auto [first, last] = cache.equal_range(hash);
+        for (auto it = first; it != last; ++it)
+        {
+            auto& entry = it->second;
+            if (entry.max_vertices != max_vertices || entry.points.size() != points.size())
+                continue;
+            auto hull = entry.hull.lock();
+            if (hull != nullptr && std::memcmp(entry.points.data(), points.data(), points.size() * sizeof(glm::vec3)) == 0)
+                return hull;
+        }
+        return nullptr;
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (auto hull = find())
+            return hull;
+    }
+    auto hull = std::make_shared<const Hull>(build(points, max_vertices, pool));
+    std::lock_guard<std::mutex> lock(mutex);
+    // Another thread may have built the same hull in the meantime
+    if (auto existing = find())
+        return existing;
+    for (auto it = cache.begin(); it != cache.end();)
+    {
+        if (it->second.hull.expired())
+            it = cache.erase(it);
+        else
+            ++it;
+    }
+    cache.emplace(hash, Entry{ max_vertices, points, hull });
+    return hull;
+}
\ No newline at end of file
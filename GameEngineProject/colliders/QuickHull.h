@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <glm/vec3.hpp>
+
+class ThreadPool;
+
+/// @brief Builds the convex hull of a point cloud in 3d with the QuickHull algorithm
+namespace QuickHull
+{
+    struct Hull
+    {
+        /// @brief The corners of the hull
+        std::vector<glm::vec3> points;
+        /// @brief Three indices into points per triangle, wound counter clockwise seen from outside
+        std::vector<unsigned> indices;
+    };
+
+    /// @brief Builds the hull of a set of points.
+    /// Large inputs are split into chunks whose hulls are built in parallel, the hull of their corners is the hull of the whole set.
+    /// @param points The points to build the hull around
+    /// @param max_vertices The most corners the hull may have, a larger hull is replaced by the hull of its furthest points along
+    /// evenly spread directions. 0 keeps every corner
+    /// @param pool The pool to build chunks on, null to build on the calling thread
+    Hull build(const std::vector<glm::vec3>& points, unsigned max_vertices = 0, ThreadPool* pool = nullptr);
+
+    /// @brief Builds the hull of a set of points once and returns the same hull for every later call with the same points and max_vertices.
+    /// The cache only holds weak references, a hull is forgotten once every caller has let go of it
+    /// @param points The points to build the hull around, hashed and compared to find the cached hull
+    std::shared_ptr<const Hull> get_cached(const std::vector<glm::vec3>& points, unsigned max_vertices, ThreadPool* pool = nullptr);
+};
\ No newline at end of file
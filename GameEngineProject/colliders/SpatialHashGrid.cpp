@@ -0,0 +1,197 @@
+#include "SpatialHashGrid.h"
+#include "../threading/ThreadPool.h"
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <glm/glm.hpp>
+
+// Bodies hashed or searched per job on the pool, below this many bodies everything runs on the calling thread
+static constexpr size_t CHUNK_SIZE = 4096;
+
+// Half of the neighbouring cells, a pair of bodies in neighbouring cells is only tested from the cell that comes first
+static const glm::ivec3 FORWARD_NEIGHBOURS[] = {
+    { 1, 0, 0 },
+    { -1, 1, 0 }, { 0, 1, 0 }, { 1, 1, 0 },
+    { -1, -1, 1 }, { 0, -1, 1 }, { 1, -1, 1 },
+    { -1, 0, 1 }, { 0, 0, 1 }, { 1, 0, 1 },
+    { -1, 1, 1 }, { 0, 1, 1 }, { 1, 1, 1 },
+};
+
+static bool overlaps(const glm::vec3& min_a, const glm::vec3& max_a, const glm::vec3& min_b, const glm::vec3& max_b)
+{
+    return min_a.x <= max_b.x && max_a.x >= min_b.x &&
+        min_a.y <= max_b.y && max_a.y >= min_b.y &&
+        min_a.z <= max_b.z && max_a.z >= min_b.z;
+}
+
+void SpatialHashGrid::update(Entity entity, const glm::vec3& min, const glm::vec3& max)
+{
+    auto index = entity.get_index();
+    if (index >= proxies.size())
+        proxies.resize(index + 1, NULL_BODY);
+
+    auto slot = proxies[index];
+    if (slot != NULL_BODY && bodies[slot].entity != entity)
+    {
+        // The index was reused by a new entity while the old one was never removed
+        remove(bodies[slot].entity);
+        slot = NULL_BODY;
+    }
+    if (slot == NULL_BODY)
+    {
+        slot = static_cast<unsigned>(bodies.size());
+        bodies.push_back(Body());
+        proxies[index] = slot;
+    }
+    bodies[slot] = { min, max, entity };
+}
+
+void SpatialHashGrid::remove(Entity entity)
+{
+    auto index = entity.get_index();
+    if (index >= proxies.size())
+        return;
+    auto slot = proxies[index];
+    if (slot == NULL_BODY || bodies[slot].entity != entity)
+        return;
+    auto last = static_cast<unsigned>(bodies.size()) - 1;
+    if (slot != last)
+    {
+        bodies[slot] = bodies[last];
+        proxies[bodies[slot].entity.get_index()] = slot;
+    }
+    bodies.pop_back();
+    proxies[index] = NULL_BODY;
+}
+
+unsigned SpatialHashGrid::get_bucket(const glm::ivec3& cell) const
+{
+    auto hash = static_cast<unsigned>(cell.x) * 73856093u ^ static_cast<unsigned>(cell.y) * 19349663u ^ static_cast<unsigned>(cell.z) * 83492791u;
+    return hash & bucket_mask;
+}
+
+void SpatialHashGrid::build()
+{
+    auto count = bodies.size();
+    auto largest = 0.0f;
+    for (auto& body : bodies)
+    {
+        auto size = body.max - body.min;
+        largest = std::max(largest, std::max(size.x, std::max(size.y, size.z)));
+    }
+    // Two bodies no larger than a cell that overlap have their centers at most one cell apart on every axis
+    cell_size = std::max(largest, 1e-4f);
+    auto bucket_count = std::bit_ceil(std::max<size_t>(count, 1));
+    bucket_mask = static_cast<unsigned>(bucket_count) - 1;
+
+    size_t chunk_count = 1;
+    if (pool != nullptr && count >= 2 * CHUNK_SIZE)
+        chunk_count = std::min<size_t>(pool->get_concurrency(), count / CHUNK_SIZE);
+    auto chunk_size = (count + chunk_count - 1) / chunk_count;
+    auto run_chunks = [&](const std::function<void(size_t, size_t, size_t)>& func)
+    {
+        if (chunk_count == 1)
+        {
+            func(0, 0, count);
+            return;
+        }
+        pool->parallel_for(0, static_cast<int>(chunk_count), 1, [&](int begin, int end)
+            {
+                for (int chunk = begin; chunk < end; chunk++)
+                    func(chunk, chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size));
+            });
+    };
+
+    body_buckets.resize(count);
+    body_cells.resize(count);
+    offsets.assign(chunk_count * bucket_count, 0);
+    auto inverse_cell_size = 1.0f / cell_size;
+    run_chunks([&](size_t chunk, size_t begin, size_t end)
+        {
+            auto histogram = &offsets[chunk * bucket_count];
+            for (size_t i = begin; i < end; i++)
+            {
+                auto center = (bodies[i].min + bodies[i].max) * 0.5f;
+                body_cells[i] = glm::ivec3(glm::floor(center * inverse_cell_size));
+                body_buckets[i] = get_bucket(body_cells[i]);
+                histogram[body_buckets[i]]++;
+            }
+        });
+
+    // Bucket major prefix sum so every chunk scatters to its own slice of each bucket and the order does not depend on the threads
+    bucket_starts.resize(bucket_count + 1);
+    unsigned total = 0;
+    for (size_t bucket = 0; bucket < bucket_count; bucket++)
+    {
+        bucket_starts[bucket] = total;
+        for (size_t chunk = 0; chunk < chunk_count; chunk++)
+        {
+            auto bodies_in_bucket = offsets[chunk * bucket_count + bucket];
+            offsets[chunk * bucket_count + bucket] = total;
+            total += bodies_in_bucket;
+        }
+    }
+    bucket_starts[bucket_count] = total;
+
+    sorted.resize(count);
+    run_chunks([&](size_t chunk, size_t begin, size_t end)
+        {
+            auto offset = &offsets[chunk * bucket_count];
+            for (size_t i = begin; i < end; i++)
+                sorted[offset[body_buckets[i]]++] = { bodies[i].min, bodies[i].max, body_cells[i], static_cast<unsigned>(i) };
+        });
+}
+
+void SpatialHashGrid::find_pairs(size_t begin, size_t end, std::vector<BroadphasePair>& pairs) const
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        auto& cell = sorted[i];
+        auto bucket = get_bucket(cell.coordinates);
+        // Bodies of the same cell later in the bucket, other cells that hash to the same bucket are skipped
+        for (auto j = i + 1; j < bucket_starts[bucket + 1]; j++)
+        {
+            auto& other = sorted[j];
+            if (other.coordinates == cell.coordinates && overlaps(cell.min, cell.max, other.min, other.max))
+                pairs.push_back({ bodies[cell.body].entity, bodies[other.body].entity });
+        }
+        for (auto& offset : FORWARD_NEIGHBOURS)
+        {
+            auto coordinates = cell.coordinates + offset;
+            auto neighbour = get_bucket(coordinates);
+            for (auto j = bucket_starts[neighbour]; j < bucket_starts[neighbour + 1]; j++)
+            {
+                auto& other = sorted[j];
+                if (other.coordinates == coordinates && overlaps(cell.min, cell.max, other.min, other.max))
+                    pairs.push_back({ bodies[cell.body].entity, bodies[other.body].entity });
+            }
+        }
+    }
+}
+
+void SpatialHashGrid::find_pairs(std::vector<BroadphasePair>& pairs)
+{
+    pairs.clear();
+    build();
+
+    auto chunk_count = (sorted.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (pool == nullptr || chunk_count < 2)
+    {
+        find_pairs(0, sorted.size(), pairs);
+        return;
+    }
+
+    // Every chunk writes its own list so the result is in the same order whichever thread ran the chunk
+    chunk_pairs.resize(chunk_count);
+    pool->parallel_for(0, static_cast<int>(chunk_count), 1, [this](int begin, int end)
+        {
+            for (int chunk = begin; chunk < end; chunk++)
+            {
+                auto& found = chunk_pairs[chunk];
+                found.clear();
+                find_pairs(chunk * CHUNK_SIZE, std::min(sorted.size(), (chunk + 1) * CHUNK_SIZE), found);
+            }
+        });
+    for (size_t chunk = 0; chunk < chunk_count; chunk++)
+        pairs.insert(pairs.end(), chunk_pairs[chunk].begin(), chunk_pairs[chunk].end());
+}
\ No newline at end of file
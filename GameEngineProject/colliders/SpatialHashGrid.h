@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <glm/vec3.hpp>
+#include "Broadphase.h"
+
+/// @brief Uniform grid broadphase for bodies of about the same size, such as many spheres.
+/// The cell size is the size of the largest body so overlapping bodies always sit in the same or neighbouring cells.
+/// Cells are hashed into a table that is rebuilt every tick with a counting sort, so every cell is a contiguous run of
+/// a flat array and nothing is allocated per cell. Building and searching are both linear in the number of bodies.
+class SpatialHashGrid : public Broadphase
+{
+private:
+    struct Body
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+        Entity entity;
+    };
+
+    /// @brief A body copied into the order of its hash bucket
+    struct Cell
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+        glm::ivec3 coordinates;
+        unsigned body;
+    };
+
+    static constexpr unsigned NULL_BODY = 0xFFFFFFFFu;
+
+    // Dense, a removed body is replaced by the last one
+    std::vector<Body> bodies;
+    // Indexed by Entity::get_index, the index in bodies of every entity
+    std::vector<unsigned> proxies;
+
+    float cell_size = 1.0f;
+    unsigned bucket_mask = 0;
+    // Per body, the bucket it hashes to and its cell coordinates, filled before sorting
+    std::vector<unsigned> body_buckets;
+    std::vector<glm::ivec3> body_cells;
+    // Per chunk and bucket, the count and then the first slot of the chunk's bodies in the bucket
+    std::vector<unsigned> offsets;
+    // The bodies of bucket b are sorted[bucket_starts[b]] to sorted[bucket_starts[b + 1] - 1]
+    std::vector<unsigned> bucket_starts;
+    std::vector<Cell> sorted;
+    std::vector<std::vector<BroadphasePair>> chunk_pairs;
+
+    unsigned get_bucket(const glm::ivec3& cell) const;
+    void build();
+    void find_pairs(size_t begin, size_t end, std::vector<BroadphasePair>& pairs) const;
+
+public:
+    void update(Entity entity, const glm::vec3& min, const glm::vec3& max) override;
+    void remove(Entity entity) override;
+    void find_pairs(std::vector<BroadphasePair>& pairs) override;
+    size_t size() const override { return bodies.size(); }
+    const char* get_name() const override { return "Spatial hash grid"; }
+
+    /// @brief Gets the size of a cell on the last search, the size of the largest body
+    float get_cell_size() const { return cell_size; }
+    /// @brief Gets the number of buckets in the hash table
+    size_t get_bucket_count() const { return bucket_mask + 1; }
+};
\ No newline at end of file
@@ -11,6 +11,17 @@ void SphereCollider::update(GameObject* object)
 glm::vec3 SphereCollider::get_center() { return get_parent()->get_component<TransformComponent>()->position; }
 glm::vec3 SphereCollider::get_scale() { return get_parent()->get_component<TransformComponent>()->scale; }
 
+float SphereCollider::get_radius()
+{
+    auto scale = get_scale();
+    return radius * glm::max(scale.x, glm::max(scale.y, scale.z));
+}
+
+AABB SphereCollider::get_bounds()
+{
+    return AABB(get_center(), glm::vec3(get_radius()));
+}
+
 bool SphereCollider::is_on_frustum(Frustum* frustum)
 {
     return is_on_or_forward_plane(&frustum->left_face) &&
@@ -23,10 +34,10 @@ bool SphereCollider::is_on_frustum(Frustum* frustum)
 
 bool SphereCollider::is_on_or_forward_plane(Plane* plane)
 {
-    return plane->getSignedDistanceToPlane(get_parent()->get_component<TransformComponent>()->position) > -radius;
+    return plane->getSignedDistanceToPlane(get_parent()->get_component<TransformComponent>()->position) > -get_radius();
 }
 
 glm::vec3 SphereCollider::find_furthest_point(glm::vec3 direction)
 {
-    return get_center() + glm::normalize(direction) * radius;
+    return get_center() + glm::normalize(direction) * get_radius();
 }
\ No newline at end of file
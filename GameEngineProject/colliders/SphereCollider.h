@@ -8,6 +8,8 @@
 class SphereCollider : public Collider<SphereCollider>
 {
 public:
+    static constexpr ColliderShape SHAPE = SHAPE_SPHERE;
+
     float radius;
 
     SphereCollider() : radius(0.0f), Collider() {}
@@ -29,10 +31,9 @@ public:
     /// @brief Finds if a sphere collider intersects with a point
     /// @param point The point to check for intersection
     /// @return true if the sphere contains the point, false otherwise
-    template <>
-    bool contains<glm::vec3>(const glm::vec3& point) const
+    bool contains(const glm::vec3& point) const
     {
-        return glm::distance(const_cast<SphereCollider*>(this)->get_center(), point) <= radius;
+        return glm::distance(const_cast<SphereCollider*>(this)->get_center(), point) <= const_cast<SphereCollider*>(this)->get_radius();
     }
 
     /// @brief Finds if a sphere collider intersects with another sphere collider
@@ -53,27 +54,15 @@ public:
             return true;
         }
 
-        // Normalize direction to get unit vector
-        direction = direction / std::sqrt(distance2);
-
-        // Use full scale values for surface-to-surface collision
-        glm::vec3 radius1 = get_scale() / 2.0f;
-        glm::vec3 radius2 = other.get_scale() / 2.0f;
-
-        // Project radii onto collision direction
-        float r1 = glm::abs(glm::dot(radius1, direction));
-        float r2 = glm::abs(glm::dot(radius2, direction));
-
         // Compare squared distance with squared sum of radii
-        float sumRadii = r1 + r2;
+        float sumRadii = get_radius() + other.get_radius();
         return distance2 <= sumRadii * sumRadii;
     }
 
     /// @brief Finds if a sphere collider intersects with an AABB
     /// @param aabb The AABB to check for intersection
     /// @return true if the sphere intersects with the AABB, false otherwise
-    template <>
-    bool contains<AABB>(const AABB& aabb) const
+    bool contains(const AABB& aabb) const
     {
         auto distance = glm::distance(const_cast<SphereCollider*>(this)->get_center(), aabb.center);
         auto vec = const_cast<SphereCollider*>(this)->get_center() - aabb.center;
@@ -83,13 +72,15 @@ public:
         float closest = std::max(0.0f, x);
         closest = std::max(closest, y);
         closest = std::max(closest, z);
-        return closest <= radius;
+        return closest <= const_cast<SphereCollider*>(this)->get_radius();
     }
 
     void update(GameObject* object) override;
 
-    float get_radius() override { return radius; }
+    /// @brief Gets the radius in world space, the radius scaled by the largest axis of the parent's scale
+    float get_radius() override;
     glm::vec3 get_center() override;
+    AABB get_bounds() override;
     glm::vec3 get_scale();
     bool is_on_frustum(Frustum* frustum) override;
     bool is_on_or_forward_plane(Plane* plane);
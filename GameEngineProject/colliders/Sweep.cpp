@@ -0,0 +1,103 @@
+#include "Sweep.h"
+#include <limits>
+#include <glm/glm.hpp>
+
+static constexpr float EPSILON = 1e-8f;
+
+// Smallest root in [0, 1] of qa * t^2 + qb * t + qc, where qc < 0 means the sphere already touches at t = 0
+static float first_root(float qa, float qb, float qc)
+{
+    if (qc < 0.0f || qa < EPSILON)
+        return -1.0f;
+    auto discriminant = qb * qb - 4.0f * qa * qc;
+    if (discriminant < 0.0f)
+        return -1.0f;
+    auto t = (-qb - glm::sqrt(discriminant)) / (2.0f * qa);
+    return t >= 0.0f && t <= 1.0f ? t : -1.0f;
+}
+
+float Sweep::sphere_point(const glm::vec3& offset, const glm::vec3& motion, float radius)
+{
+    return first_root(glm::dot(motion, motion), 2.0f * glm::dot(offset, motion), glm::dot(offset, offset) - radius * radius);
+}
+
+float Sweep::sphere_sphere(const glm::vec3& start_a, const glm::vec3& motion_a, float radius_a,
+    const glm::vec3& start_b, const glm::vec3& motion_b, float radius_b)
+{
+    // Same as b standing still while a moves by the difference of the two motions
+    return sphere_point(start_a - start_b, motion_a - motion_b, radius_a + radius_b);
+}
+
+float Sweep::sphere_triangle(const glm::vec3& start, const glm::vec3& motion, float radius,
+    const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, glm::vec3& normal)
+{
+    auto face_normal = glm::cross(b - a, c - a);
+    auto area = glm::length(face_normal);
+    if (area < EPSILON)
+        return -1.0f;
+    face_normal /= area;
+    // The inside test needs the normal that matches the winding, the other one can be flipped to face the sphere
+    auto winding = face_normal;
+    auto distance = glm::dot(start - a, face_normal);
+    if (distance < 0.0f)
+    {
+        face_normal = -face_normal;
+        distance = -distance;
+    }
+
+    // The sphere lands on the face when the point under it at the moment it reaches the plane is inside the triangle
+    auto approach = glm::dot(motion, face_normal);
+    if (distance >= radius && approach < 0.0f)
+    {
+        auto t = (distance - radius) / -approach;
+        if (t > 1.0f)
+            return -1.0f;
+        auto point = start + motion * t - face_normal * radius;
+        auto inside = glm::dot(glm::cross(b - a, point - a), winding) >= 0.0f &&
+            glm::dot(glm::cross(c - b, point - b), winding) >= 0.0f &&
+            glm::dot(glm::cross(a - c, point - c), winding) >= 0.0f;
+        if (inside)
+        {
+            normal = face_normal;
+            return t;
+        }
+    }
+    else if (distance >= radius)
+    {
+        // Moving away from or along the plane without touching it
+        return -1.0f;
+    }
+
+    // Otherwise the first touch is on an edge or a corner
+    auto best = std::numeric_limits<float>::max();
+    const glm::vec3* corners[] = { &a, &b, &c };
+    for (int i = 0; i < 3; i++)
+    {
+        auto& p = *corners[i];
+        auto& q = *corners[(i + 1) % 3];
+
+        auto t = sphere_point(start - p, motion, radius);
+        if (t >= 0.0f && t < best)
+        {
+            best = t;
+            normal = glm::normalize(start + motion * t - p);
+        }
+
+        // Against the infinite line through the edge, then kept if the touched point is between its ends
+        auto edge = q - p;
+        auto length2 = glm::dot(edge, edge);
+        auto offset = start - p;
+        auto offset_across = offset - edge * (glm::dot(offset, edge) / length2);
+        auto motion_across = motion - edge * (glm::dot(motion, edge) / length2);
+        t = first_root(glm::dot(motion_across, motion_across), 2.0f * glm::dot(offset_across, motion_across),
+            glm::dot(offset_across, offset_across) - radius * radius);
+        if (t < 0.0f || t >= best)
+            continue;
+        auto along = glm::dot(offset + motion * t, edge) / length2;
+        if (along < 0.0f || along > 1.0f)
+            continue;
+        best = t;
+        normal = glm::normalize(offset_across + motion_across * t);
+    }
+    return best <= 1.0f ? best : -1.0f;
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+/// @brief Time of impact tests for a sphere moving along a straight line during a tick.
+/// Times are fractions of the motion in [0, 1], -1 means the sphere does not touch the target on the way.
+/// A sphere that already overlaps the target at the start reports no impact, that case is left to the discrete tests.
+namespace Sweep
+{
+    /// @brief Finds when a moving sphere first touches a fixed point
+    /// @param offset The center of the sphere at the start relative to the point
+    /// @param motion How far the sphere moves
+    float sphere_point(const glm::vec3& offset, const glm::vec3& motion, float radius);
+
+    /// @brief Finds when two moving spheres first touch
+    /// @param start_a The center of a at the start
+    /// @param motion_a How far a moves
+    float sphere_sphere(const glm::vec3& start_a, const glm::vec3& motion_a, float radius_a,
+        const glm::vec3& start_b, const glm::vec3& motion_b, float radius_b);
+
+    /// @brief Finds when a moving sphere first touches a triangle, the triangle is hit from either side
+    /// @param start The center of the sphere at the start
+    /// @param motion How far the sphere moves
+    /// @param normal Set to the direction from the touched point of the triangle to the center of the sphere on a hit
+    float sphere_triangle(const glm::vec3& start, const glm::vec3& motion, float radius,
+        const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, glm::vec3& normal);
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "SweepAndPrune.h"
+#include "../threading/ThreadPool.h"
+#include <algorithm>
+
+// Endpoints swept per job when pairs are searched on the pool
+static constexpr size_t SWEEP_CHUNK_SIZE = 1024;
+// The sweep axis only changes when another axis has this many times the spread of the current one, so bodies spread about
+// evenly do not make the order flip between axes every tick
+static constexpr float AXIS_SWITCH_RATIO = 1.5f;
+
+void SweepAndPrune::update(Entity entity, const glm::vec3& min, const glm::vec3& max)
+{
+    auto index = entity.get_index();
+    if (index >= proxies.size())
+        proxies.resize(index + 1, NULL_BODY);
+
+    auto slot = proxies[index];
+    if (slot != NULL_BODY && bodies[slot].entity != entity)
+    {
+        // The index was reused by a new entity while the old one was never removed
+        remove(bodies[slot].entity);
+        slot = NULL_BODY;
+    }
+
+    if (slot == NULL_BODY)
+    {
+        if (free_bodies.empty())
+        {
+            slot = static_cast<unsigned>(bodies.size());
+            bodies.push_back(Body());
+        }
+        else
+        {
+            slot = free_bodies.back();
+            free_bodies.pop_back();
+        }
+        proxies[index] = slot;
+        endpoints.push_back({ min, max, slot });
+        unsorted_count++;
+        body_count++;
+    }
+
+    bodies[slot] = { min, max, entity };
+}
+
+void SweepAndPrune::remove(Entity entity)
+{
+    auto index = entity.get_index();
+    if (index >= proxies.size())
+        return;
+    auto slot = proxies[index];
+    if (slot == NULL_BODY || bodies[slot].entity != entity)
+        return;
+    bodies[slot].entity = Entity::null();
+    removed_bodies.push_back(slot);
+    proxies[index] = NULL_BODY;
+    body_count--;
+}
+
+void SweepAndPrune::choose_axis()
+{
+    if (body_count < 2)
+        return;
+    glm::vec3 sum(0.0f);
+    glm::vec3 sum_squared(0.0f);
+    for (auto& body : bodies)
+    {
+        if (body.entity.is_null())
+            continue;
+        auto center = (body.min + body.max) * 0.5f;
+        sum += center;
+        sum_squared += center * center;
+    }
+    auto count = static_cast<float>(body_count);
+    auto variance = sum_squared / count - (sum / count) * (sum / count);
+
+    auto widest = 0;
+    if (variance.y > variance[widest])
+        widest = 1;
+    if (variance.z > variance[widest])
+        widest = 2;
+    if (widest != axis && variance[widest] > variance[axis] * AXIS_SWITCH_RATIO)
+    {
+        axis = widest;
+        // The old order says nothing about the new axis
+        unsorted_count = endpoints.size();
+    }
+}
+
+void SweepAndPrune::sort_endpoints()
+{
+    for (auto& endpoint : endpoints)
+    {
+        auto& body = bodies[endpoint.body];
+        endpoint.min = body.min;
+        endpoint.max = body.max;
+    }
+
+    auto by_min = [this](const Endpoint& a, const Endpoint& b)
+    { return a.min[axis] < b.min[axis]; };
+    if (unsorted_count * 8 > endpoints.size())
+    {
+        std::sort(endpoints.begin(), endpoints.end(), by_min);
+    }
+    else
+    {
+        // Bodies moved little since the last tick so almost every endpoint is already in place
+        for (size_t i = 1; i < endpoints.size(); i++)
+        {
+            auto endpoint = endpoints[i];
+            auto j = i;
+            while (j > 0 && endpoints[j - 1].min[axis] > endpoint.min[axis])
+            {
+                endpoints[j] = endpoints[j - 1];
+                j--;
+            }
+            endpoints[j] = endpoint;
+        }
+    }
+    unsorted_count = 0;
+}
+
+void SweepAndPrune::sweep(size_t begin, size_t end, std::vector<BroadphasePair>& pairs) const
+{
+    auto first_other = (axis + 1) % 3;
+    auto second_other = (axis + 2) % 3;
+    for (size_t i = begin; i < end; i++)
+    {
+        auto& body = endpoints[i];
+        auto end_along_axis = body.max[axis];
+        // Only bodies starting before this one ends can overlap it along the axis
+        for (size_t j = i + 1; j < endpoints.size() && endpoints[j].min[axis] <= end_along_axis; j++)
+        {
+            auto& other = endpoints[j];
+            if (body.min[first_other] <= other.max[first_other] && body.max[first_other] >= other.min[first_other] &&
+                body.min[second_other] <= other.max[second_other] && body.max[second_other] >= other.min[second_other])
+            {
+                pairs.push_back({ bodies[body.body].entity, bodies[other.body].entity });
+            }
+        }
+    }
+}
+
+void SweepAndPrune::find_pairs(std::vector<BroadphasePair>& pairs)
+{
+    pairs.clear();
+    if (!removed_bodies.empty())
+    {
+        std::erase_if(endpoints, [this](const Endpoint& endpoint)
+            { return bodies[endpoint.body].entity.is_null(); });
+        free_bodies.insert(free_bodies.end(), removed_bodies.begin(), removed_bodies.end());
+        removed_bodies.clear();
+    }
+
+    choose_axis();
+    sort_endpoints();
+
+    auto chunk_count = (endpoints.size() + SWEEP_CHUNK_SIZE - 1) / SWEEP_CHUNK_SIZE;
+    if (pool == nullptr || chunk_count < 2)
+    {
+        sweep(0, endpoints.size(), pairs);
+        return;
+    }
+
+    // Every chunk writes its own list so the result is in the same order whichever thread ran the chunk
+    chunk_pairs.resize(chunk_count);
+    pool->parallel_for(0, static_cast<int>(chunk_count), 1, [this](int begin, int end)
+        {
+            for (int chunk = begin; chunk < end; chunk++)
+            {
+                auto& found = chunk_pairs[chunk];
+                found.clear();
+                sweep(chunk * SWEEP_CHUNK_SIZE, std::min(endpoints.size(), (chunk + 1) * SWEEP_CHUNK_SIZE), found);
+            }
+        });
+    for (size_t chunk = 0; chunk < chunk_count; chunk++)
+        pairs.insert(pairs.end(), chunk_pairs[chunk].begin(), chunk_pairs[chunk].end());
+}
\ No newline at end of file
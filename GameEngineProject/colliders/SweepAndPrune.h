@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <glm/vec3.hpp>
+#include "Broadphase.h"
+
+/// @brief Sort and sweep broadphase.
+/// Bodies are kept sorted by where their bounds start along one axis, so a body only has to be tested against the bodies
+/// that start before it ends. The order is kept between ticks and repaired with an insertion sort, which is close to linear
+/// when bodies move a little every tick. The axis is the one along which the bodies are spread the most.
+class SweepAndPrune : public Broadphase
+{
+private:
+    struct Body
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+        Entity entity;
+    };
+
+    /// @brief Copy of a body's bounds stored in sweep order, so the sweep reads memory front to back instead of jumping between slots
+    struct Endpoint
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+        unsigned body;
+    };
+
+    static constexpr unsigned NULL_BODY = 0xFFFFFFFFu;
+
+    std::vector<Body> bodies;
+    std::vector<unsigned> free_bodies;
+    // Removed slots are only reused after their endpoints have been dropped from the sweep order
+    std::vector<unsigned> removed_bodies;
+    // Indexed by Entity::get_index, the body slot of every entity
+    std::vector<unsigned> proxies;
+    std::vector<Endpoint> endpoints;
+    size_t body_count = 0;
+    // Endpoints appended since the last sort, a large batch of new bodies is sorted from scratch instead
+    size_t unsorted_count = 0;
+    int axis = 0;
+    std::vector<std::vector<BroadphasePair>> chunk_pairs;
+
+    void choose_axis();
+    void sort_endpoints();
+    void sweep(size_t begin, size_t end, std::vector<BroadphasePair>& pairs) const;
+
+public:
+    void update(Entity entity, const glm::vec3& min, const glm::vec3& max) override;
+    void remove(Entity entity) override;
+    void find_pairs(std::vector<BroadphasePair>& pairs) override;
+    size_t size() const override { return body_count; }
+    const char* get_name() const override { return "Sweep and prune"; }
+
+    /// @brief Gets the axis bodies are currently sorted along, 0 for x, 1 for y and 2 for z
+    int get_axis() const { return axis; }
+};
\ No newline at end of file
@@ -1,6 +1,6 @@
 #pragma once
 
+/// @brief Marker base for components, components are stored by value so this carries no virtual table
 struct BaseComponent
 {
-    virtual ~BaseComponent() = default;
 };
\ No newline at end of file
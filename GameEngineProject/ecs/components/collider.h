@@ -0,0 +1,13 @@
+#pragma once
+
+#include "base.h"
+#include "../ecs_map.h"
+
+class ColliderBase;
+
+/// @brief Links an entity to the collider of its game object so collision systems can find every collider through the ECS.
+/// The game object owns the collider.
+struct ColliderComponent : public BaseComponent
+{
+    ColliderBase* collider = nullptr;
+};
\ No newline at end of file
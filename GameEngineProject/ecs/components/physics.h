@@ -1,66 +1,218 @@
 #pragma once
 
+#include <array>
+#include <utility>
+#include <vector>
 #include <glm/vec3.hpp>
 #include <glm/geometric.hpp>
 #include "base.h"
 #include "../ecs_map.h"
 
+/// @brief The state a body starts with, copied into the PhysicsStore when the component is inserted.
+/// The store owns the body from then on, read and change it through ECSGlobalMap::get<PhysicsComponent>().
 struct PhysicsComponent : public BaseComponent
 {
     glm::vec3 velocity = glm::vec3(0);
     glm::vec3 acceleration = glm::vec3(0);
     float mass = 1.0f;
     float dragCoefficient = 0.1f;
+    // How long the body has been slower than the sleep velocity of the contact solver
+    float rest_time = 0.0f;
+    // Sleeping bodies are skipped by the integrator, the broadphase and the contact solver until a contact or a force wakes them
+    bool sleeping = false;
+};
+
+/// @brief Sparse set of bodies with every field in its own float array, the store ECSGlobalMap keeps PhysicsComponent in.
+/// The integrator runs over the arrays with SIMD, the collision system and the contact solver read and write the bodies by slot.
+/// Awake bodies come first, the slots [0, get_awake_count()) are the only ones the integrator and the broadphase walk.
+/// A slot is only valid until the next insert, remove or change of sleep state, all of which can move bodies between slots.
+class PhysicsStore : public ECSMapBase
+{
+private:
+    std::vector<Entity> entities;
+    std::vector<unsigned> sparse;
+    unsigned awake_count = 0;
 
-    void update(float delta_time)
+    std::array<std::vector<float>*, 9> get_arrays()
     {
-        apply_drag(dragCoefficient);
-        velocity += acceleration * delta_time;
+        return { &velocity_x, &velocity_y, &velocity_z, &acceleration_x, &acceleration_y, &acceleration_z, &mass, &drag, &rest_time };
     }
 
-    void apply_force(glm::vec3 force)
+    void swap(unsigned a, unsigned b)
     {
-        acceleration += force / mass;
+        if (a == b)
+            return;
+        std::swap(entities[a], entities[b]);
+        sparse[entities[a].get_index()] = a;
+        sparse[entities[b].get_index()] = b;
+        for (auto array : get_arrays())
+            std::swap((*array)[a], (*array)[b]);
     }
 
-    void apply_impulse(glm::vec3 impulse)
+public:
+    static constexpr unsigned INVALID = 0xFFFFFFFFu;
+
+    std::vector<float> velocity_x, velocity_y, velocity_z;
+    // Only holds the forces applied since the last tick, the integrator clears it so a force lasts one tick
+    std::vector<float> acceleration_x, acceleration_y, acceleration_z;
+    std::vector<float> mass, drag;
+    std::vector<float> rest_time;
+
+    /// @brief Inserts a body for the entity, replacing the existing one if the entity already has one
+    /// @return The slot of the body
+    unsigned insert(Entity entity, const PhysicsComponent& value)
     {
-        velocity += impulse / mass;
+        auto slot = find(entity);
+        if (slot == INVALID)
+        {
+            auto index = entity.get_index();
+            if (index >= sparse.size())
+                sparse.resize(index + 1, INVALID);
+            // New bodies start at the end with the sleeping ones
+            slot = static_cast<unsigned>(entities.size());
+            sparse[index] = slot;
+            entities.push_back(entity);
+            for (auto array : get_arrays())
+                array->push_back(0.0f);
+            version++;
+        }
+        slot = set_sleeping(slot, value.sleeping);
+        set_velocity(slot, value.velocity);
+        acceleration_x[slot] = value.acceleration.x;
+        acceleration_y[slot] = value.acceleration.y;
+        acceleration_z[slot] = value.acceleration.z;
+        mass[slot] = value.mass;
+        drag[slot] = value.dragCoefficient;
+        rest_time[slot] = value.rest_time;
+        return slot;
     }
 
-    void apply_friction(float friction)
+    /// @brief Gets the slot of the body of an entity, INVALID when the entity has none
+    unsigned find(Entity entity) const
     {
-        auto friction_force = velocity * friction;
-        apply_force(-friction_force);
+        auto index = entity.get_index();
+        if (index >= sparse.size())
+            return INVALID;
+        auto slot = sparse[index];
+        if (slot == INVALID || entities[slot] != entity)
+            return INVALID;
+        return slot;
     }
 
-    void apply_gravity(glm::vec3 gravity)
+    /// @brief Removes the body of an entity, the last awake body and the last body fill the gaps it leaves
+    void remove(Entity entity) override
     {
-        apply_force(gravity);
+        auto slot = find(entity);
+        if (slot == INVALID)
+            return;
+        slot = set_sleeping(slot, true);
+        swap(slot, static_cast<unsigned>(entities.size()) - 1);
+        entities.pop_back();
+        for (auto array : get_arrays())
+            array->pop_back();
+        sparse[entity.get_index()] = INVALID;
+        version++;
     }
 
-    void apply_gravity(float gravity)
+    bool contains(Entity entity) const override
     {
-        apply_force(glm::vec3(0, -gravity * mass, 0));
+        return find(entity) != INVALID;
     }
 
-    void apply_drag(glm::vec3 drag)
+    int get_size() const override
     {
-        auto drag_force = velocity * drag;
-        apply_force(-drag_force);
+        return static_cast<int>(entities.size());
     }
 
-    void apply_drag(float drag)
+    Entity get_entity(unsigned slot) const { return entities[slot]; }
+    unsigned get_awake_count() const { return awake_count; }
+
+    glm::vec3 get_velocity(unsigned slot) const
     {
-        auto drag_force = velocity * drag;
-        if (isnan(drag_force.x) || isnan(drag_force.y) || isnan(drag_force.z))
+        return glm::vec3(velocity_x[slot], velocity_y[slot], velocity_z[slot]);
+    }
+
+    void set_velocity(unsigned slot, const glm::vec3& velocity)
+    {
+        velocity_x[slot] = velocity.x;
+        velocity_y[slot] = velocity.y;
+        velocity_z[slot] = velocity.z;
+    }
+
+    glm::vec3 get_acceleration(unsigned slot) const
+    {
+        return glm::vec3(acceleration_x[slot], acceleration_y[slot], acceleration_z[slot]);
+    }
+
+    bool is_sleeping(unsigned slot) const { return slot >= awake_count; }
+
+    /// @brief Moves a body across the border between the awake and the sleeping bodies, the rest time is kept
+    /// @return The new slot of the body
+    unsigned set_sleeping(unsigned slot, bool sleeping)
+    {
+        if (sleeping == is_sleeping(slot))
+            return slot;
+        auto target = sleeping ? --awake_count : awake_count++;
+        swap(slot, target);
+        return target;
+    }
+
+    /// @brief Makes the integrator and the contact solver pick the body up again on the next tick
+    /// @return The new slot of the body
+    unsigned wake(unsigned slot)
+    {
+        rest_time[slot] = 0.0f;
+        return set_sleeping(slot, false);
+    }
+
+    /// @brief Adds a force for the next tick, a sleeping body is woken and moves to another slot
+    void apply_force(unsigned slot, glm::vec3 force)
+    {
+        if (is_sleeping(slot) && force != glm::vec3(0))
+            slot = wake(slot);
+        acceleration_x[slot] += force.x / mass[slot];
+        acceleration_y[slot] += force.y / mass[slot];
+        acceleration_z[slot] += force.z / mass[slot];
+    }
+
+    /// @brief Changes the velocity by an impulse, a sleeping body is woken and moves to another slot
+    void apply_impulse(unsigned slot, glm::vec3 impulse)
+    {
+        if (is_sleeping(slot) && impulse != glm::vec3(0))
+            slot = wake(slot);
+        set_velocity(slot, get_velocity(slot) + impulse / mass[slot]);
+    }
+
+    /// @brief Exchanges the impulse that stops two bodies approaching along a normal
+    /// @param normal Points from body a to body b
+    /// @param restitution How much of the approaching speed the bodies keep
+    void apply_collision(unsigned a, unsigned b, glm::vec3 normal, float restitution)
+    {
+        auto approach = glm::dot(get_velocity(b) - get_velocity(a), normal);
+        if (approach >= 0.0f)
             return;
-        apply_force(-drag_force);
+        auto impulse = normal * (-(1.0f + restitution) * approach / (1.0f / mass[a] + 1.0f / mass[b]));
+        // Waking a can move b
+        auto entity_b = entities[b];
+        apply_impulse(a, -impulse);
+        apply_impulse(find(entity_b), impulse);
     }
 
-    void apply_collision(PhysicsComponent* other);
-    void apply_collision(glm::vec3 normal);
+    /// @brief Stops a body approaching a surface that does not move
+    /// @param normal The normal of the surface, pointing towards the body
+    /// @param restitution How much of the approaching speed the body keeps
+    void apply_collision(unsigned slot, glm::vec3 normal, float restitution)
+    {
+        auto velocity = get_velocity(slot);
+        auto approach = glm::dot(velocity, normal);
+        if (approach < 0.0f)
+            set_velocity(slot, velocity - normal * ((1.0f + restitution) * approach));
+    }
 };
 
+/// @brief Puts PhysicsComponent in a PhysicsStore instead of an array of components, so ECSGlobalMap::get<PhysicsComponent>()
+/// gives the arrays. Views and get by entity are not available for PhysicsComponent, use find and the slot instead.
 template <>
-void ECSGlobalMap::insert<PhysicsComponent>(UUID id, PhysicsComponent* value);
\ No newline at end of file
+struct ECSMap<PhysicsComponent> : public PhysicsStore
+{
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/vec3.hpp>
+#include <glm/common.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include "base.h"
@@ -11,6 +12,9 @@ struct TransformComponent : public BaseComponent
     glm::vec3 position = glm::vec3(0.0f);
     glm::quat rotation = glm::quat(1, 0, 0, 0);
     glm::vec3 scale = glm::vec3(1.0f);
+    // The position and rotation before the last fixed step, rendering blends from them to the current ones
+    glm::vec3 previous_position = glm::vec3(0.0f);
+    glm::quat previous_rotation = glm::quat(1, 0, 0, 0);
 
     glm::mat4x4 get_model_matrix() const
     {
@@ -26,11 +30,29 @@ struct TransformComponent : public BaseComponent
         return parent * get_model_matrix();
     }
 
+    /// @brief Gets the model matrix between the state before the last fixed step and the current state
+    /// @param alpha 0 for the previous state, 1 for the current one
+    glm::mat4x4 get_interpolated_model_matrix(float alpha) const
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::mix(previous_position, position, alpha));
+        model = model * glm::mat4_cast(glm::slerp(previous_rotation, rotation, alpha));
+        model = glm::scale(model, scale);
+        return model;
+    }
+
+    /// @brief Remembers the current position and rotation as the state before the next fixed step
+    void store_previous()
+    {
+        previous_position = position;
+        previous_rotation = rotation;
+    }
+
     /// @brief Constructs a new TransformComponent object
     /// @param position The position of the object
     /// @param rotation The rotation of the object
     /// @param scale The scale of the object
-    TransformComponent(glm::vec3 position, glm::quat rotation, glm::vec3 scale) : position(position), rotation(rotation), scale(scale) {}
+    TransformComponent(glm::vec3 position, glm::quat rotation, glm::vec3 scale) : position(position), rotation(rotation), scale(scale), previous_position(position), previous_rotation(rotation) {}
 
     /// @brief Sets the position of the object
     /// @param position The position of the object
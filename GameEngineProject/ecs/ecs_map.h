@@ -1,313 +1,368 @@
 #pragma once
 
-#include "../uuid.h"
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <type_traits>
+#include <tuple>
+#include "entity.h"
 #include "components/base.h"
 
-template <typename T>
-struct ECSValuePair
+/// @brief Hands out a small integer per component type so component stores can be found by index instead of comparing type names
+struct ECSTypeId
 {
-    UUID id;
-    T* value;
-    ECSValuePair() : id(UUID::empty()), value(nullptr) {}
-    ECSValuePair(UUID id, T* value) : id(id), value(value) {}
-    virtual bool operator==(const ECSValuePair<T>& other)
-    {
-        return id == other.id && value == other.value;
-    }
-    virtual bool operator==(const type_info& other)
-    {
-        return typeid(T) == other;
-    }
-    virtual bool operator!=(const ECSValuePair<T>& other)
-    {
-        return !(*this == other);
-    }
-    virtual bool operator!=(const type_info& other)
+private:
+    // Systems can ask for the id of a type for the first time from pool threads
+    static inline std::atomic<unsigned> next_id{ 0 };
+
+public:
+    template <typename T>
+    static unsigned get()
     {
-        return !(*this == other);
+        static const unsigned id = next_id.fetch_add(1);
+        return id;
     }
 };
 
+/// @brief Type erased interface so the global map can remove an entity from every store without knowing the component types
+struct ECSMapBase
+{
+protected:
+    unsigned version = 0;
+
+public:
+    virtual ~ECSMapBase() = default;
+    virtual void remove(Entity entity) = 0;
+    virtual bool contains(Entity entity) const = 0;
+    virtual int get_size() const = 0;
+    /// @brief Changes whenever an entity gets or loses a component in this store, lets a system skip rescanning a store that is unchanged
+    unsigned get_version() const { return version; }
+};
+
+/// @brief Sparse set of components of a single type.
+/// Components are stored by value in a densely packed array, the sparse array maps an entity index to its slot in that array.
+/// Pointers returned by get are only valid until the next insert or remove on this map.
 template <typename T>
-struct ECSMap
+struct ECSMap : public ECSMapBase
 {
 private:
-    ECSValuePair<T>* data;
-    int size;
-    int capacity;
+    static constexpr unsigned INVALID = 0xFFFFFFFFu;
+
+    std::vector<T> values;
+    std::vector<Entity> entities;
+    std::vector<unsigned> sparse;
 
-    void expand()
+    unsigned find(Entity entity) const
     {
-        capacity *= 2;
-        ECSValuePair<T>* new_data = new ECSValuePair<T>[capacity];
-        for (int i = 0; i < size; i++)
-        {
-            new_data[i] = data[i];
-        }
-        delete[] data;
-        data = new_data;
+        auto index = entity.get_index();
+        if (index >= sparse.size())
+            return INVALID;
+        auto slot = sparse[index];
+        if (slot == INVALID || entities[slot] != entity)
+            return INVALID;
+        return slot;
     }
 
 public:
-    ECSMap() : ECSMap(1) {}
+    ECSMap() = default;
 
-    ECSMap(int capacity)
+    explicit ECSMap(int capacity)
     {
-        this->capacity = capacity;
-        this->size = 0;
-        this->data = new ECSValuePair<T>[capacity];
+        values.reserve(capacity);
+        entities.reserve(capacity);
     }
 
-    ~ECSMap()
+    /// @brief Inserts a component for the entity, replacing the existing one if the entity already has one
+    /// @param entity The entity to attach the component to
+    /// @param value The component
+    /// @return The stored component
+    T* insert(Entity entity, T value)
     {
-        delete[] data;
-    }
-
-    void insert(UUID id, T* value)
-    {
-        if (size >= capacity)
+        auto slot = find(entity);
+        if (slot != INVALID)
         {
-            expand();
+            values[slot] = std::move(value);
+            return &values[slot];
         }
-        data[size++] = ECSValuePair{ id, value };
+        auto index = entity.get_index();
+        if (index >= sparse.size())
+            sparse.resize(index + 1, INVALID);
+        sparse[index] = static_cast<unsigned>(values.size());
+        entities.push_back(entity);
+        values.push_back(std::move(value));
+        version++;
+        return &values.back();
     }
 
-    T* get(UUID id)
+    T* get(Entity entity)
     {
-        for (int i = 0; i < size; i++)
-        {
-            if (data[i].id == id)
-            {
-                return data[i].value;
-            }
-        }
-        return nullptr;
+        auto slot = find(entity);
+        if (slot == INVALID)
+            return nullptr;
+        return &values[slot];
     }
 
     T* get(int index)
     {
-        if (index < 0 || index >= size)
+        if (index < 0 || index >= get_size())
         {
             return nullptr;
         }
-        return data[index].value;
+        return &values[index];
     }
 
-    template <typename U>
-    U* get(UUID id)
+    /// @brief Gets the entity owning the component stored at a dense index
+    /// @param index The dense index, 0 to get_size() - 1
+    Entity get_id(int index) const
     {
-        for (int i = 0; i < size; i++)
+        if (index < 0 || index >= get_size())
         {
-            if (data[i].id == id && dynamic_cast<U*>(&data[i].value) != nullptr)
-            {
-                return dynamic_cast<U*>(data[i].value);
-            }
+            return Entity::null();
         }
-        return nullptr;
+        return entities[index];
     }
 
-    template <typename U>
-    ECSValuePair<U>* get_value_pair(UUID id)
+    /// @brief Removes the component of an entity by moving the last component into its slot
+    /// @param entity The entity to remove the component of
+    void remove(Entity entity) override
     {
-        for (int i = 0; i < size; i++)
+        auto slot = find(entity);
+        if (slot == INVALID)
+            return;
+        unsigned last = static_cast<unsigned>(values.size()) - 1;
+        if (slot != last)
         {
-            if (data[i].id == id && dynamic_cast<U*>(&data[i].value) != nullptr)
-            {
-                return dynamic_cast<ECSValuePair<U> *>(&data[i]);
-            }
+            values[slot] = std::move(values[last]);
+            entities[slot] = entities[last];
+            sparse[entities[slot].get_index()] = slot;
         }
-        return nullptr;
+        values.pop_back();
+        entities.pop_back();
+        sparse[entity.get_index()] = INVALID;
+        version++;
     }
 
-    template <typename U>
-    ECSValuePair<U>* get_value_pair(int i)
+    bool contains(Entity entity) const override
     {
-        if (i < 0 || i >= size)
-        {
-            return nullptr;
-        }
-        if (dynamic_cast<U*>(data[i].value) != nullptr)
-        {
-            return new ECSValuePair<U>(data[i].id, dynamic_cast<U*>(data[i].value));
-        }
-        return nullptr;
+        return find(entity) != INVALID;
     }
 
-    void remove(UUID id)
+    int get_size() const override
     {
-        for (int i = 0; i < size; i++)
-        {
-            if (data[i].id == id)
-            {
-                delete data[i].value;
-                for (int j = i; j < size - 1; j++)
-                {
-                    data[j] = data[j + 1];
-                }
-                size--;
-                return;
-            }
-        }
+        return static_cast<int>(values.size());
     }
 
-    int get_size()
+    T* data() { return values.data(); }
+
+    T* operator[](Entity entity)
     {
-        return size;
+        return get(entity);
     }
+};
+
+/// @brief Iterates every entity that has all of the given components.
+/// The first component type drives the iteration, so entities come out in the dense order of that store
+/// and the remaining stores are probed through their sparse arrays. Nothing is allocated while iterating.
+template <typename First, typename... Rest>
+struct ECSView
+{
+private:
+    ECSMap<First>* lead;
+    std::tuple<ECSMap<Rest>*...> others;
 
-    T* operator[](UUID id)
+    bool has_all_stores() const
     {
-        return get(id);
+        return lead != nullptr && std::apply([](auto*... maps) { return ((maps != nullptr) && ...); }, others);
     }
 
-    ECSMap<T>& operator=(const ECSMap<T>& other)
+public:
+    ECSView(ECSMap<First>* lead, ECSMap<Rest>*... others) : lead(lead), others(others...)
     {
-        if (this == &other)
+        if (!has_all_stores())
+            this->lead = nullptr;
+    }
+
+    struct iterator
+    {
+        ECSView* view;
+        int index;
+
+        void skip_missing()
         {
-            return *this;
+            while (index < view->lead->get_size() && !view->matches(index))
+                index++;
         }
-        delete[] data;
-        size = other.size;
-        capacity = other.capacity;
-        data = new ECSValuePair<T>[capacity];
-        for (int i = 0; i < size; i++)
+
+        std::tuple<Entity, First&, Rest&...> operator*() const
         {
-            data[i] = other.data[i];
+            auto entity = view->lead->get_id(index);
+            return std::tuple<Entity, First&, Rest&...>(entity, *view->lead->get(index), *std::get<ECSMap<Rest>*>(view->others)->get(entity)...);
         }
-        return *this;
-    }
 
-    bool operator==(const ECSMap<T>& other)
-    {
-        if (size != other.size)
+        iterator& operator++()
         {
-            return false;
+            index++;
+            skip_missing();
+            return *this;
         }
-        for (int i = 0; i < size; i++)
+
+        bool operator!=(const iterator& other) const { return index != other.index; }
+        bool operator==(const iterator& other) const { return index == other.index; }
+    };
+
+    /// @brief Checks if the entity at a dense index of the leading store has every other component
+    bool matches(int index) const
+    {
+        auto entity = lead->get_id(index);
+        return std::apply([entity](auto*... maps) { return (maps->contains(entity) && ...); }, others);
+    }
+
+    iterator begin()
+    {
+        if (lead == nullptr)
+            return iterator{ this, 0 };
+        iterator it{ this, 0 };
+        it.skip_missing();
+        return it;
+    }
+
+    iterator end() { return iterator{ this, lead == nullptr ? 0 : lead->get_size() }; }
+
+    /// @brief Gets the number of entities in the leading store, an upper bound on the number of matches
+    int size() const { return lead == nullptr ? 0 : lead->get_size(); }
+
+    /// @brief Calls func(entity, first, rest...) for every matching entity
+    template <typename F>
+    void each(F&& func)
+    {
+        each(0, size(), func);
+    }
+
+    /// @brief Calls func(entity, first, rest...) for the matching entities among the dense indices [begin, end) of the leading store,
+    /// disjoint ranges touch disjoint entities so they can be processed on different threads
+    template <typename F>
+    void each(int begin, int end, F&& func)
+    {
+        for (int i = begin; i < end && i < size(); i++)
         {
-            if (data[i].id != other.data[i].id || data[i].value != other.data[i].value)
-            {
-                return false;
-            }
+            auto entity = lead->get_id(i);
+            invoke(i, entity, func);
         }
-        return true;
     }
 
-    bool operator==(const type_info& other)
+private:
+    template <typename F>
+    void invoke(int index, Entity entity, F& func)
     {
-        return typeid(T) == other;
+        auto components = std::apply([entity](auto*... maps) { return std::make_tuple(maps->get(entity)...); }, others);
+        bool found = std::apply([](auto*... components) { return ((components != nullptr) && ...); }, components);
+        if (!found)
+            return;
+        std::apply([&](auto*... components) { func(entity, *lead->get(index), *components...); }, components);
     }
 };
 
 struct ECSGlobalMap
 {
 private:
-    ECSMap<BaseComponent>* data;
-    std::string* types;
-    int size;
-    int capacity;
+    // Indexed by ECSTypeId, entries are null for component types this map has never seen
+    std::vector<std::unique_ptr<ECSMapBase>> data;
+    EntityRegistry entities;
 
-    void expand()
+    template <typename T>
+    ECSMap<T>* get_or_create()
     {
-        capacity *= 2;
-        ECSMap<BaseComponent>* new_data = new ECSMap<BaseComponent>[capacity];
-        std::string* new_types = new std::string[capacity];
-        for (int i = 0; i < size; i++)
+        auto type = ECSTypeId::get<T>();
+        if (type >= data.size())
         {
-            new_data[i] = data[i];
-            new_types[i] = types[i];
+            data.resize(type + 1);
         }
-        delete[] data;
-        data = new_data;
-        delete[] types;
-        types = new_types;
+        if (data[type] == nullptr)
+        {
+            data[type] = std::make_unique<ECSMap<T>>();
+        }
+        return static_cast<ECSMap<T>*>(data[type].get());
     }
 
 public:
-    ECSGlobalMap() : ECSGlobalMap(1) {}
+    ECSGlobalMap() = default;
+    ECSGlobalMap(const ECSGlobalMap&) = delete;
+    ECSGlobalMap& operator=(const ECSGlobalMap&) = delete;
 
-    ECSGlobalMap(int capacity)
-    {
-        this->capacity = capacity;
-        this->size = 0;
-        this->data = new ECSMap<BaseComponent>[capacity];
-        this->types = new std::string[capacity];
-    }
+    /// @brief Creates a new entity without any components
+    Entity create_entity() { return entities.create(); }
 
-    ~ECSGlobalMap()
+    /// @brief Removes every component of the entity and frees its handle for reuse
+    void destroy_entity(Entity entity)
     {
-        delete[] data;
-        delete[] types;
+        remove_all(entity);
+        entities.destroy(entity);
     }
 
+    bool is_alive(Entity entity) const { return entities.is_alive(entity); }
+
+    unsigned get_entity_count() const { return entities.get_size(); }
+
+    /// @brief Inserts a component for the entity, replacing the existing one if the entity already has one
+    /// @return What the store of T returns, the stored component or its slot for stores that do not keep components by value
     template <typename T>
-    void insert(UUID id, T* value)
+    auto insert(Entity entity, T value)
     {
-        for (int i = 0; i < size; i++)
-        {
-            if (types[i] == typeid(T).name())
-            {
-                data[i].insert(id, value);
-                return;
-            }
-        }
-        if (size >= capacity)
-        {
-            expand();
-        }
-        types[size] = typeid(T).name();
-        data[size++].insert(id, value);
+        static_assert(std::is_base_of_v<BaseComponent, T>, "Components must derive from BaseComponent");
+        return get_or_create<T>()->insert(entity, std::move(value));
     }
 
     template <typename T>
-    T* get(UUID id)
+    T* get(Entity entity)
     {
-        for (int i = 0; i < size; i++)
-        {
-            if (types[i] != typeid(T).name())
-                continue;
-
-            return dynamic_cast<T*>(data[i].get(id));
-        }
-        return nullptr;
+        auto map = get<T>();
+        if (map == nullptr)
+            return nullptr;
+        return map->get(entity);
     }
 
     template <typename T>
-    void remove(UUID id)
+    void remove(Entity entity)
     {
-        for (int i = 0; i < size; i++)
-        {
-            if (types[i] == typeid(T).name())
-            {
-                data[i].remove(id);
-                return;
-            }
-        }
+        auto map = get<T>();
+        if (map != nullptr)
+            map->remove(entity);
     }
 
-    void remove_all(UUID id)
+    void remove_all(Entity entity)
     {
-        for (int i = 0; i < size; i++)
+        for (auto& map : data)
         {
-            data[i].remove(id);
+            if (map != nullptr)
+                map->remove(entity);
         }
     }
 
     template <typename T>
-    ECSMap<BaseComponent>* get()
+    ECSMap<T>* get()
     {
-        for (int i = 0; i < size; i++)
-        {
-            if (types[i] == typeid(T).name())
-            {
-                return &data[i];
-            }
-        }
-        return nullptr;
+        auto type = ECSTypeId::get<T>();
+        if (type >= data.size())
+            return nullptr;
+        return static_cast<ECSMap<T>*>(data[type].get());
+    }
+
+    /// @brief Gets a view over every entity that has all of the given components
+    /// @tparam First The component type whose store drives the iteration order
+    template <typename First, typename... Rest>
+    ECSView<First, Rest...> view()
+    {
+        return ECSView<First, Rest...>(get<First>(), get<Rest>()...);
     }
 
     int get_size()
     {
+        int size = 0;
+        for (auto& map : data)
+        {
+            if (map != nullptr)
+                size++;
+        }
         return size;
     }
-};
\ No newline at end of file
+};
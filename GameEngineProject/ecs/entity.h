@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+
+/// @brief 32 bit handle to an entity, the low bits index into component stores and the high bits hold a generation
+/// so a handle to a destroyed entity never matches the entity that later reuses its index
+struct Entity
+{
+    static constexpr unsigned INDEX_BITS = 24;
+    static constexpr unsigned INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static constexpr unsigned GENERATION_MASK = 0xFFu;
+    static constexpr unsigned NULL_ID = 0xFFFFFFFFu;
+
+    unsigned id = NULL_ID;
+
+    static Entity null() { return Entity{ NULL_ID }; }
+    static Entity create(unsigned index, unsigned generation) { return Entity{ (generation & GENERATION_MASK) << INDEX_BITS | (index & INDEX_MASK) }; }
+
+    unsigned get_index() const { return id & INDEX_MASK; }
+    unsigned get_generation() const { return id >> INDEX_BITS; }
+    bool is_null() const { return id == NULL_ID; }
+
+    bool operator==(const Entity& other) const { return id == other.id; }
+    bool operator!=(const Entity& other) const { return id != other.id; }
+};
+
+/// @brief Creates and recycles entity handles, destroyed indices are reused with a bumped generation
+class EntityRegistry
+{
+private:
+    std::vector<unsigned char> generations;
+    std::vector<unsigned> free_indices;
+
+public:
+    Entity create()
+    {
+        if (!free_indices.empty())
+        {
+            auto index = free_indices.back();
+            free_indices.pop_back();
+            return Entity::create(index, generations[index]);
+        }
+        generations.push_back(0);
+        return Entity::create(static_cast<unsigned>(generations.size() - 1), 0);
+    }
+
+    void destroy(Entity entity)
+    {
+        if (!is_alive(entity))
+            return;
+        auto index = entity.get_index();
+        generations[index]++;
+        // The all ones handle is reserved for Entity::null
+        if (index == Entity::INDEX_MASK && generations[index] == Entity::GENERATION_MASK)
+            generations[index] = 0;
+        free_indices.push_back(index);
+    }
+
+    bool is_alive(Entity entity) const
+    {
+        if (entity.is_null())
+            return false;
+        auto index = entity.get_index();
+        return index < generations.size() && generations[index] == entity.get_generation();
+    }
+
+    /// @brief Gets the number of live entities
+    unsigned get_size() const { return static_cast<unsigned>(generations.size() - free_indices.size()); }
+};
@@ -0,0 +1,29 @@
+#include "base.h"
+#include "../../threading/ThreadPool.h"
+#include <algorithm>
+
+static bool overlaps(const std::vector<unsigned>& a, const std::vector<unsigned>& b)
+{
+    for (auto type : a)
+    {
+        if (std::find(b.begin(), b.end(), type) != b.end())
+            return true;
+    }
+    return false;
+}
+
+bool BaseSystem::conflicts_with(const BaseSystem& other) const
+{
+    return overlaps(writes, other.writes) || overlaps(writes, other.reads) || overlaps(reads, other.writes);
+}
+
+void BaseSystem::parallel_for(int count, int grain_size, const std::function<void(int, int)>& func)
+{
+    if (pool == nullptr)
+    {
+        if (count > 0)
+            func(0, count);
+        return;
+    }
+    pool->parallel_for(0, count, grain_size, func);
+}
\ No newline at end of file
@@ -1,18 +1,52 @@
 #pragma once
+#include <vector>
+#include <functional>
 #include "../ecs_map.h"
 
 class World;
+class ThreadPool;
+
+/// @brief A number a system reports for the debug panels
+struct SystemStat
+{
+    const char* name;
+    double value;
+    int decimals = 0;
+};
 
 class BaseSystem
 {
 private:
     ECSGlobalMap* ecs;
     World* world;
+    ThreadPool* pool = nullptr;
+    std::vector<unsigned> reads;
+    std::vector<unsigned> writes;
+
+protected:
+    /// @brief Declares that update reads components of type T, systems that only read a type can run at the same time
+    template <typename T>
+    void reads_component() { reads.push_back(ECSTypeId::get<T>()); }
+    /// @brief Declares that update writes components of type T, the system is ordered against every other system touching T
+    template <typename T>
+    void writes_component() { writes.push_back(ECSTypeId::get<T>()); }
+
+    /// @brief Runs func(begin, end) over [0, count) in chunks on the scheduler's pool, or in one call when the scheduler runs sequentially
+    void parallel_for(int count, int grain_size, const std::function<void(int, int)>& func);
 
 public:
     BaseSystem(ECSGlobalMap* ecs, World* world) : ecs(ecs), world(world) {};
     virtual ~BaseSystem() { ecs = nullptr; };
     virtual void update(float delta_time) = 0;
+    /// @brief Gets the name shown next to the system's timings
+    virtual const char* get_name() const { return "System"; }
+    /// @brief Appends the numbers the system wants shown, called on the simulation thread after a step
+    virtual void get_stats(std::vector<SystemStat>& stats) {}
     ECSGlobalMap* get_ecs() { return ecs; };
 	World* get_world() { return world; };
+    ThreadPool* get_pool() { return pool; }
+    void set_pool(ThreadPool* pool) { this->pool = pool; }
+
+    /// @brief Checks if the two systems touch a component type where at least one of them writes it
+    bool conflicts_with(const BaseSystem& other) const;
 };
\ No newline at end of file
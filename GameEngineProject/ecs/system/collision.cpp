@@ -1,40 +1,528 @@
 #include "collision.h"
+#include "../components/collider.h"
 #include "../components/physics.h"
 #include "../components/transform.h"
 #include "../../World.h"
+#include "../../colliders/AABB.h"
+#include "../../colliders/ColliderHandler.h"
+#include "../../colliders/SpatialHashGrid.h"
+#include "../../colliders/SweepAndPrune.h"
 #include "../../objects/base/GameObject.h"
-#include "../../colliders/SphereCollider.h"
 #include "../../objects/curves/BSplineSurface.h"
+#include <algorithm>
+
+// How far a swept body is kept from the terrain after touching it
+static constexpr float SWEEP_SKIN = 0.001f;
+// Bodies per job when the terrain heights are looked up on the thread pool
+static constexpr int TERRAIN_CHUNK_SIZE = 1024;
+
+CollisionSystem::CollisionSystem(ECSGlobalMap* ecs, World* world) : BaseSystem(ecs, world), broadphase(std::make_unique<DynamicAABBTree>()), sleeping_bodies(0.0f)
+{
+    writes_component<PhysicsComponent>();
+    writes_component<TransformComponent>();
+    reads_component<ColliderComponent>();
+}
+
+void CollisionSystem::set_broadphase_type(BroadphaseType type)
+{
+    if (type == broadphase_type)
+        return;
+    broadphase_type = type;
+    if (type == SWEEP_AND_PRUNE)
+        broadphase = std::make_unique<SweepAndPrune>();
+    else if (type == SPATIAL_HASH)
+        broadphase = std::make_unique<SpatialHashGrid>();
+    else
+        broadphase = std::make_unique<DynamicAABBTree>();
+    tracked.clear();
+    pairs.clear();
+    rescan = true;
+}
 
 void CollisionSystem::update(float delta_time)
 {
-    auto ecs = get_ecs();
-    auto physics = ecs->get<PhysicsComponent>();
-    if (physics == nullptr)
+    find_swept_bodies(delta_time);
+    sweep_terrain(delta_time);
+    update_broadphase();
+
+    broadphase->set_pool(get_pool());
+    broadphase->find_pairs(pairs);
+    find_sleeping_pairs();
+    sort_pairs();
+    sweep_pairs(delta_time);
+
+    gjk_cache.next_frame();
+    auto colliders = get_ecs()->get<ColliderComponent>();
+    collider_pairs.clear();
+    for (auto& pair : pairs)
+    {
+        auto a = colliders->get(pair.a)->collider;
+        auto b = colliders->get(pair.b)->collider;
+        // Only pairs that go through GJK keep a simplex, the cache forgets a pair on the tick after it stops being queried
+        auto cache = ColliderHandler::uses_gjk(a->get_shape(), b->get_shape()) ? gjk_cache.get(pair.a.id, pair.b.id) : nullptr;
+        collider_pairs.push_back({ a, b, cache });
+    }
+    ColliderHandler::get_contacts(collider_pairs, manifolds);
+
+    gather_bodies();
+    for (auto& manifold : manifolds)
+    {
+        auto& pair = pairs[manifold.pair];
+        solver.add_contact(get_body(pair.a), get_body(pair.b), manifold.contact.normal, manifold.contact.depth, (uint64_t(pair.a.id) << 32) | pair.b.id);
+    }
+    collide_terrain();
+    contact_count = solver.get_contact_count();
+    solver.solve(delta_time, get_pool());
+    scatter_bodies();
+}
+
+void CollisionSystem::get_stats(std::vector<SystemStat>& stats)
+{
+    auto gjk = GJK::get_stats();
+    stats.push_back({ "Collision bodies", double(broadphase->size()) });
+    stats.push_back({ "Broadphase pairs", double(pairs.size()) });
+    stats.push_back({ "Contacts", double(contact_count) });
+    stats.push_back({ "Swept bodies", double(swept.size()) });
+    stats.push_back({ "Islands", double(solver.get_island_count()) });
+    stats.push_back({ "Bodies awake", double(awake_count) });
+    stats.push_back({ "Bodies asleep", double(sleeping_count) });
+    stats.push_back({ "GJK iterations per query", gjk.queries == 0 ? 0.0 : double(gjk.iterations) / gjk.queries, 2 });
+}
+
+// Every awake body gets a slot in the solver, colliders without a physics component are static.
+// Sleeping bodies are left out and only get a slot when an awake body touches them.
+void CollisionSystem::gather_bodies()
+{
+    auto bodies = get_ecs()->get<PhysicsComponent>();
+    auto transforms = get_ecs()->get<TransformComponent>();
+    solver.clear(bodies);
+    solver_entities.clear();
+    awake_count = 0;
+    sleeping_count = 0;
+    if (bodies == nullptr || transforms == nullptr)
         return;
+    for (unsigned slot = 0; slot < bodies->get_awake_count(); slot++)
+    {
+        if (!transforms->contains(bodies->get_entity(slot)))
+            continue;
+        awake_count++;
+        add_body(*bodies, slot);
+    }
+    sleeping_count = bodies->get_size() - bodies->get_awake_count();
+}
+
+unsigned CollisionSystem::add_body(PhysicsStore& bodies, unsigned slot)
+{
+    auto entity = bodies.get_entity(slot);
+    auto index = entity.get_index();
+    if (index >= body_index.size())
+        body_index.resize(index + 1, ContactSolver::STATIC_BODY);
+    body_index[index] = solver.add_body(slot, bodies.is_sleeping(slot));
+    solver_entities.push_back(entity);
+    return body_index[index];
+}
+
+// The solver already wrote the velocities into the store. It decides which islands sleep, a body that changed state moves
+// between the broadphase and the sleeping bodies, and to the other end of the store. That moves other bodies in the store
+// as well, so the bodies are found by entity instead of by the slot they had in the solver.
+void CollisionSystem::scatter_bodies()
+{
+    auto ecs = get_ecs();
+    auto bodies = ecs->get<PhysicsComponent>();
+    for (auto entity : solver_entities)
+    {
+        auto& transform = *ecs->get<TransformComponent>(entity);
+        auto& index = body_index[entity.get_index()];
+        auto& body = solver.get_body(index);
+        auto slot = bodies->find(entity);
+        auto was_sleeping = bodies->is_sleeping(slot);
+        bodies->set_sleeping(slot, body.sleeping);
+        transform.position += body.correction;
+        // A destroyed body must not leave its slot behind for a later entity with the same index
+        index = ContactSolver::STATIC_BODY;
+        if (body.sleeping && !was_sleeping)
+            put_to_sleep(entity);
+        else if (!body.sleeping && was_sleeping)
+            wake(entity);
+    }
+}
+
+unsigned CollisionSystem::get_body(Entity entity)
+{
+    auto index = entity.get_index();
+    if (index < body_index.size() && body_index[index] != ContactSolver::STATIC_BODY)
+        return body_index[index];
+    auto bodies = get_ecs()->get<PhysicsComponent>();
+    auto slot = bodies != nullptr ? bodies->find(entity) : PhysicsStore::INVALID;
+    return slot != PhysicsStore::INVALID ? add_body(*bodies, slot) : ContactSolver::STATIC_BODY;
+}
+
+// Takes a body out of the broadphase, it is only found again by the awake bodies that reach its bounds
+void CollisionSystem::put_to_sleep(Entity entity)
+{
+    if (auto collider = get_ecs()->get<ColliderComponent>(entity))
+    {
+        collider->collider->update(collider->collider->get_parent());
+        auto bounds = collider->collider->get_bounds();
+        broadphase->remove(entity);
+        sleeping_bodies.update(entity, bounds.min, bounds.max);
+    }
+    if (auto object = get_world()->get_object(entity))
+        object->set_active(false);
+}
+
+// Wakes a body together with every sleeping body touching it, and the ones touching those, so a pile wakes at once
+// instead of one layer per tick. The woken bodies go back into the broadphase straight away.
+void CollisionSystem::wake(Entity entity)
+{
+    auto ecs = get_ecs();
+    auto bodies = ecs->get<PhysicsComponent>();
+    std::vector<Entity> waking{ entity };
+    sleeping_bodies.remove(entity);
+    while (!waking.empty())
+    {
+        auto next = waking.back();
+        waking.pop_back();
+        // The rest time is kept, a pile that is still at rest falls asleep again together with what woke it
+        auto slot = bodies != nullptr ? bodies->find(next) : PhysicsStore::INVALID;
+        if (slot != PhysicsStore::INVALID)
+            bodies->set_sleeping(slot, false);
+        if (auto object = get_world()->get_object(next))
+            object->set_active(true);
+        auto collider = ecs->get<ColliderComponent>(next);
+        if (collider == nullptr)
+            continue;
+        collider->collider->update(collider->collider->get_parent());
+        auto bounds = collider->collider->get_bounds();
+        broadphase->update(next, bounds.min, bounds.max);
+        auto first = waking.size();
+        sleeping_bodies.query(bounds.min, bounds.max, waking);
+        for (auto i = first; i < waking.size(); i++)
+            sleeping_bodies.remove(waking[i]);
+    }
+}
+
+BSplineSurface* CollisionSystem::get_surface()
+{
     auto world = get_world();
-    auto surface = dynamic_cast<BSplineSurface*>(world->get_object(world->get_surface_id()));
-    if (surface == nullptr)
+    return dynamic_cast<BSplineSurface*>(world->get_object(world->get_surface_id()));
+}
+
+const SweptBody* CollisionSystem::get_swept(Entity entity) const
+{
+    auto index = entity.get_index();
+    if (index >= swept_index.size() || swept_index[index] < 0)
+        return nullptr;
+    return &swept[swept_index[index]];
+}
+
+// Only spheres that moved further than their radius can pass through something between two ticks, every other body
+// is left to the discrete tests. The integrator moved every body by its velocity times the time step, which gives the start.
+void CollisionSystem::find_swept_bodies(float delta_time)
+{
+    for (auto& body : swept)
+        swept_index[body.entity.get_index()] = -1;
+    swept.clear();
+    auto bodies = get_ecs()->get<PhysicsComponent>();
+    auto transforms = get_ecs()->get<TransformComponent>();
+    auto colliders = get_ecs()->get<ColliderComponent>();
+    if (bodies == nullptr || transforms == nullptr || colliders == nullptr)
         return;
-    for (int i = 0; i < physics->get_size(); i++)
+    for (unsigned slot = 0; slot < bodies->get_awake_count(); slot++)
     {
-        auto component = physics->get_value_pair<PhysicsComponent>(i);
-        if (component == nullptr)
+        auto entity = bodies->get_entity(slot);
+        auto collider = colliders->get(entity);
+        if (collider == nullptr || collider->collider->get_shape() != SHAPE_SPHERE)
             continue;
-        auto object = world->get_object(component->id);
-        if (object == nullptr)
+        auto radius = collider->collider->get_radius();
+        auto displacement = bodies->get_velocity(slot) * delta_time;
+        if (glm::dot(displacement, displacement) <= radius * radius)
             continue;
-        auto transform = object->get_component<TransformComponent>();
+        auto transform = transforms->get(entity);
         if (transform == nullptr)
             continue;
-        auto collider = dynamic_cast<SphereCollider*>(object->get_collider());
-        auto y = surface->get_y_at(transform->position);
-        auto scale = transform->scale;
-        if (std::get<0>(y) + scale.y > transform->position.y)
+        auto index = entity.get_index();
+        if (index >= swept_index.size())
+            swept_index.resize(index + 1, -1);
+        swept_index[index] = static_cast<int>(swept.size());
+        swept.push_back({ entity, transform->position - displacement, radius });
+    }
+}
+
+// Moves every swept body again from the start of the tick in up to MAX_SUBSTEPS steps, each step ends where the body
+// touches the terrain mesh. The approaching velocity is removed at each touch so the rest of the tick slides along the
+// surface, the same as the discrete terrain response which does not bounce either.
+void CollisionSystem::sweep_terrain(float delta_time)
+{
+    auto surface = get_surface();
+    if (surface == nullptr)
+        return;
+    auto ecs = get_ecs();
+    auto bodies = ecs->get<PhysicsComponent>();
+    for (auto& body : swept)
+    {
+        auto slot = bodies->find(body.entity);
+        auto& transform = *ecs->get<TransformComponent>(body.entity);
+        auto from = body.start;
+        auto remaining = delta_time;
+        for (int step = 0; step < MAX_SUBSTEPS; step++)
+        {
+            auto to = from + bodies->get_velocity(slot) * remaining;
+            float time;
+            glm::vec3 normal;
+            if (!surface->sweep_sphere(from, to, body.radius, time, normal))
+            {
+                from = to;
+                break;
+            }
+            // Stop just short of the surface so the next step does not start touching it
+            from = glm::mix(from, to, time) + normal * SWEEP_SKIN;
+            remaining *= 1.0f - time;
+            bodies->apply_collision(slot, normal, 0.0f);
+            // The pairs are swept from the last touch, the terrain already changed the path before it
+            body.start = from;
+        }
+        transform.position = from;
+    }
+}
+
+// The terrain is a static body in the solver, the contact is under the body along the surface normal.
+// Only the bodies in the solver are tested, a sleeping body rests where the terrain stopped it.
+// The heights are looked up in chunks on the pool, the contacts are added on this thread.
+void CollisionSystem::collide_terrain()
+{
+    auto surface = get_surface();
+    if (surface == nullptr)
+        return;
+    auto transforms = get_ecs()->get<TransformComponent>();
+    auto count = solver_entities.size();
+    terrain_positions.resize(count);
+    terrain_heights.resize(count);
+    terrain_normals.resize(count);
+    for (size_t i = 0; i < count; i++)
+        terrain_positions[i] = transforms->get(solver_entities[i])->position;
+    parallel_for(static_cast<int>(count), TERRAIN_CHUNK_SIZE, [this, surface](int begin, int end)
+        {
+            auto size = static_cast<size_t>(end - begin);
+            auto positions = std::span<const glm::vec3>(terrain_positions).subspan(begin, size);
+            auto heights = std::span(terrain_heights).subspan(begin, size);
+            auto normals = std::span(terrain_normals).subspan(begin, size);
+            // A surface without a mesh has nothing else to query
+            if (terrain_query == TERRAIN_EXACT || surface->get_heightfield().empty())
+                surface->get_exact_y_at(positions, heights, normals);
+            else
+                surface->get_y_at(positions, heights, normals);
+        });
+
+    for (size_t i = 0; i < count; i++)
+    {
+        auto entity = solver_entities[i];
+        auto& transform = *transforms->get(entity);
+        auto depth = terrain_heights[i] + transform.scale.y - transform.position.y;
+        if (depth <= 0.0f)
+            continue;
+        auto normal = glm::normalize(terrain_normals[i]);
+        if (normal.y < 0.0f)
+            normal = -normal;
+        solver.add_contact(ContactSolver::STATIC_BODY, body_index[entity.get_index()], normal, depth * normal.y, (uint64_t(entity.id) << 32) | Entity::null().id);
+    }
+}
+
+// Only the awake bodies and the colliders without a body are updated, sleeping bodies are after the awake ones in the store
+// and are never visited. Their colliders do not move and they stay out of the broadphase.
+void CollisionSystem::update_broadphase()
+{
+    awake_bounds.clear();
+    auto colliders = get_ecs()->get<ColliderComponent>();
+    auto bodies = get_ecs()->get<PhysicsComponent>();
+    if (rescan || colliders == nullptr || colliders->get_version() != collider_version || (bodies != nullptr && bodies->get_version() != body_version))
+        rescan_colliders();
+    if (colliders == nullptr)
+        return;
+
+    for (auto entity : static_colliders)
+        update_bounds(entity, *colliders->get(entity), false);
+    if (bodies == nullptr)
+        return;
+    // Waking a pile appends it to the awake bodies, the loop picks those up as well
+    for (unsigned slot = 0; slot < bodies->get_awake_count(); slot++)
+    {
+        auto entity = bodies->get_entity(slot);
+        auto collider = colliders->get(entity);
+        if (collider == nullptr)
+            continue;
+        // Woken by a force since the last tick
+        if (sleeping_bodies.contains(entity))
+            wake(entity);
+        update_bounds(entity, *collider, true);
+    }
+}
+
+void CollisionSystem::update_bounds(Entity entity, ColliderComponent& collider, bool awake)
+{
+    collider.collider->update(collider.collider->get_parent());
+    auto bounds = collider.collider->get_bounds();
+    auto min = bounds.min;
+    auto max = bounds.max;
+    // A swept body covers its whole path so the broadphase pairs it with everything it could have passed through
+    if (auto body = get_swept(entity))
+    {
+        min = glm::min(min, body->start - body->radius);
+        max = glm::max(max, body->start + body->radius);
+    }
+    broadphase->update(entity, min, max);
+    if (awake)
+        awake_bounds.push_back({ entity, min, max });
+}
+
+// Walks every collider after colliders or bodies were added or removed. Destroyed colliders leave the broadphase and the
+// sleeping bodies, bodies that were added asleep join the sleeping bodies and colliders without a body are collected.
+void CollisionSystem::rescan_colliders()
+{
+    auto ecs = get_ecs();
+    auto colliders = ecs->get<ColliderComponent>();
+    auto bodies = ecs->get<PhysicsComponent>();
+    auto transforms = ecs->get<TransformComponent>();
+    current.clear();
+    static_colliders.clear();
+    for (int i = 0; colliders != nullptr && transforms != nullptr && i < colliders->get_size(); i++)
+    {
+        auto entity = colliders->get_id(i);
+        if (!transforms->contains(entity))
+            continue;
+        current.push_back(entity);
+        auto slot = bodies != nullptr ? bodies->find(entity) : PhysicsStore::INVALID;
+        if (slot == PhysicsStore::INVALID)
+            static_colliders.push_back(entity);
+        else if (bodies->is_sleeping(slot) && !sleeping_bodies.contains(entity))
+            put_to_sleep(entity);
+    }
+
+    for (auto entity : tracked)
+    {
+        if (colliders == nullptr || !colliders->contains(entity))
         {
-            component->value->acceleration.y = 0;
-            component->value->apply_force(std::get<1>(y) + glm::normalize(std::get<1>(y)) * scale);
-            transform->position.y = std::get<0>(y) + scale.y;
+            broadphase->remove(entity);
+            sleeping_bodies.remove(entity);
+        }
+        else if (bodies == nullptr || !bodies->contains(entity))
+        {
+            // A body that lost its physics component is static from now on
+            sleeping_bodies.remove(entity);
         }
     }
+    tracked.swap(current);
+    collider_version = colliders != nullptr ? colliders->get_version() : 0;
+    body_version = bodies != nullptr ? bodies->get_version() : 0;
+    rescan = colliders == nullptr;
+}
+
+// Pairs every awake body with the sleeping bodies its bounds reach, sleeping bodies are never paired with each other
+void CollisionSystem::find_sleeping_pairs()
+{
+    if (sleeping_bodies.size() == 0)
+        return;
+    for (auto& [entity, min, max] : awake_bounds)
+    {
+        found.clear();
+        sleeping_bodies.query(min, max, found);
+        for (auto other : found)
+            pairs.push_back({ entity, other });
+    }
+}
+
+// The broadphases report pairs in an order that depends on how the search was split across the pool. Contacts are solved
+// in pair order, so the pairs are put in entity order to give the same result on any number of threads.
+void CollisionSystem::sort_pairs()
+{
+    for (auto& pair : pairs)
+    {
+        if (pair.b.id < pair.a.id)
+            std::swap(pair.a, pair.b);
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const BroadphasePair& x, const BroadphasePair& y)
+        { return x.a.id != y.a.id ? x.a.id < y.a.id : x.b.id < y.b.id; });
+}
+
+// Finds the pairs with a swept sphere that touched during the tick and handles them in the order they touched. Both bodies
+// are put back where they touched, the contact is resolved there and the bodies move on with their new velocities for the
+// rest of the tick. A body is handled once per tick, later touches are left to the discrete tests.
+void CollisionSystem::sweep_pairs(float delta_time)
+{
+    if (swept.empty())
+        return;
+    auto ecs = get_ecs();
+    auto colliders = ecs->get<ColliderComponent>();
+    auto bodies = ecs->get<PhysicsComponent>();
+    auto get_motion = [&](Entity entity)
+    {
+        if (auto body = get_swept(entity))
+            return ecs->get<TransformComponent>(entity)->position - body->start;
+        auto slot = bodies->find(entity);
+        return slot != PhysicsStore::INVALID ? bodies->get_velocity(slot) * delta_time : glm::vec3(0.0f);
+    };
+
+    impacts.clear();
+    for (unsigned i = 0; i < pairs.size(); i++)
+    {
+        auto& pair = pairs[i];
+        if (get_swept(pair.a) == nullptr && get_swept(pair.b) == nullptr)
+            continue;
+        auto collider_a = colliders->get(pair.a)->collider;
+        auto collider_b = colliders->get(pair.b)->collider;
+        auto time = collider_a->collision_delta(collider_b, get_motion(pair.b) - get_motion(pair.a));
+        if (time >= 0.0f)
+            impacts.push_back({ time, i });
+    }
+    std::sort(impacts.begin(), impacts.end());
+
+    // Stamping the bodies instead of clearing a flag per body keeps this linear in the number of impacts
+    if (++impact_stamp == 0)
+    {
+        std::fill(impact_stamps.begin(), impact_stamps.end(), 0);
+        impact_stamp = 1;
+    }
+    for (auto [time, i] : impacts)
+    {
+        auto a = pairs[i].a;
+        auto b = pairs[i].b;
+        auto largest = std::max(a.get_index(), b.get_index());
+        if (largest >= impact_stamps.size())
+            impact_stamps.resize(largest + 1, 0);
+        if (impact_stamps[a.get_index()] == impact_stamp || impact_stamps[b.get_index()] == impact_stamp)
+            continue;
+        impact_stamps[a.get_index()] = impact_stamp;
+        impact_stamps[b.get_index()] = impact_stamp;
+
+        auto remaining = (1.0f - time) * delta_time;
+        auto& transform_a = *ecs->get<TransformComponent>(a);
+        auto& transform_b = *ecs->get<TransformComponent>(b);
+        transform_a.position -= get_motion(a) * (1.0f - time);
+        transform_b.position -= get_motion(b) * (1.0f - time);
+        auto normal = transform_b.position - transform_a.position;
+        auto length = glm::length(normal);
+        normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        resolve(a, b, { colliders->get(a)->collider, colliders->get(b)->collider, normal, 0.0f });
+
+        for (auto [entity, transform] : { std::pair{ a, &transform_a }, std::pair{ b, &transform_b } })
+        {
+            auto slot = bodies->find(entity);
+            if (slot != PhysicsStore::INVALID)
+                transform->position += bodies->get_velocity(slot) * remaining;
+        }
+    }
+}
+
+// Removes the approaching velocity of two bodies at a contact, bodies without a physics component do not move
+void CollisionSystem::resolve(Entity a, Entity b, const Contact& contact)
+{
+    auto bodies = get_ecs()->get<PhysicsComponent>();
+    auto slot_a = bodies->find(a);
+    auto slot_b = bodies->find(b);
+    if (slot_a != PhysicsStore::INVALID && slot_b != PhysicsStore::INVALID)
+        bodies->apply_collision(slot_a, slot_b, contact.normal, ContactSolver::RESTITUTION);
+    else if (slot_a != PhysicsStore::INVALID)
+        bodies->apply_collision(slot_a, -contact.normal, ContactSolver::RESTITUTION);
+    else if (slot_b != PhysicsStore::INVALID)
+        bodies->apply_collision(slot_b, contact.normal, ContactSolver::RESTITUTION);
 }
\ No newline at end of file
@@ -1,10 +1,125 @@
 #pragma once
 
+#include <memory>
+#include <tuple>
 #include "base.h"
+#include "../../colliders/Broadphase.h"
+#include "../../colliders/ColliderHandler.h"
+#include "../../colliders/DynamicAABBTree.h"
+#include "contact_solver.h"
+
+enum BroadphaseType
+{
+    AABB_TREE,
+    SWEEP_AND_PRUNE,
+    SPATIAL_HASH
+};
+
+/// @brief What the terrain contacts are tested against
+enum TerrainQuery
+{
+    // The triangle mesh the terrain is drawn with, through its heightfield
+    TERRAIN_MESH,
+    // The B-spline surface evaluated from its control points, independent of the tessellation
+    TERRAIN_EXACT
+};
+
+class BSplineSurface;
+class PhysicsStore;
+struct ColliderComponent;
+
+/// @brief A sphere that moved further than its radius this tick, swept from where it started the tick to where it is now
+struct SweptBody
+{
+    Entity entity;
+    glm::vec3 start;
+    float radius;
+};
 
 class CollisionSystem : public BaseSystem
 {
+private:
+    std::unique_ptr<Broadphase> broadphase;
+    BroadphaseType broadphase_type = AABB_TREE;
+    TerrainQuery terrain_query = TERRAIN_MESH;
+    std::vector<BroadphasePair> pairs;
+    // Sleeping bodies are kept out of the broadphase, only the awake bodies look for them in here
+    DynamicAABBTree sleeping_bodies;
+    std::vector<Entity> found;
+    // The bounds every awake body was given in the broadphase this tick
+    std::vector<std::tuple<Entity, glm::vec3, glm::vec3>> awake_bounds;
+    GJK::Cache gjk_cache;
+    std::vector<ColliderPair> collider_pairs;
+    std::vector<ContactManifold> manifolds;
+    ContactSolver solver;
+    // Solver body of every entity index, bodies without a physics component are the static body
+    std::vector<unsigned> body_index;
+    // The entity of every solver body after the static body
+    std::vector<Entity> solver_entities;
+    // Every collider seen by the last rescan, used to find the ones that were destroyed since
+    std::vector<Entity> tracked;
+    std::vector<Entity> current;
+    // Colliders without a physics component, updated every tick together with the awake bodies
+    std::vector<Entity> static_colliders;
+    // The versions of the collider and body stores at the last rescan, every collider is only walked when they change
+    unsigned collider_version = 0;
+    unsigned body_version = 0;
+    bool rescan = true;
+    std::vector<SweptBody> swept;
+    // Index into swept for every entity index, -1 for the bodies that are not swept this tick
+    std::vector<int> swept_index;
+    // Pairs with a swept body that touched during the tick, as the time of impact and the index of the pair
+    std::vector<std::pair<float, unsigned>> impacts;
+    // For every entity index the last sweep_pairs call that resolved an impact of the body, so a body is resolved once per tick
+    std::vector<unsigned> impact_stamps;
+    unsigned impact_stamp = 0;
+    // Position of every solver body and the terrain under it, in the order of solver_entities
+    std::vector<glm::vec3> terrain_positions;
+    std::vector<float> terrain_heights;
+    std::vector<glm::vec3> terrain_normals;
+    size_t contact_count = 0;
+    size_t awake_count = 0;
+    size_t sleeping_count = 0;
+
+    BSplineSurface* get_surface();
+    const SweptBody* get_swept(Entity entity) const;
+    void find_swept_bodies(float delta_time);
+    void sweep_terrain(float delta_time);
+    void sweep_pairs(float delta_time);
+    void gather_bodies();
+    void scatter_bodies();
+    unsigned add_body(PhysicsStore& bodies, unsigned slot);
+    unsigned get_body(Entity entity);
+    void collide_terrain();
+    void update_broadphase();
+    void rescan_colliders();
+    void update_bounds(Entity entity, ColliderComponent& collider, bool awake);
+    void find_sleeping_pairs();
+    void sort_pairs();
+    void put_to_sleep(Entity entity);
+    void wake(Entity entity);
+    void resolve(Entity a, Entity b, const Contact& contact);
+
 public:
-    CollisionSystem(ECSGlobalMap* ecs, World* world) : BaseSystem(ecs, world) {}
+    /// @brief How many times a swept body can hit the terrain in one tick before it stops at the last hit
+    static constexpr int MAX_SUBSTEPS = 4;
+
+    CollisionSystem(ECSGlobalMap* ecs, World* world);
     void update(float delta_time) override;
+    const char* get_name() const override { return "Collision"; }
+    void get_stats(std::vector<SystemStat>& stats) override;
+
+    Broadphase* get_broadphase() { return broadphase.get(); }
+    BroadphaseType get_broadphase_type() const { return broadphase_type; }
+    /// @brief Replaces the broadphase, every body is added to the new one on the next update
+    void set_broadphase_type(BroadphaseType type);
+    TerrainQuery get_terrain_query() const { return terrain_query; }
+    /// @brief Chooses what the terrain contacts are tested against, swept bodies use the mesh when the surface has one
+    void set_terrain_query(TerrainQuery query) { terrain_query = query; }
+    size_t get_pair_count() const { return pairs.size(); }
+    size_t get_contact_count() const { return contact_count; }
+    size_t get_swept_count() const { return swept.size(); }
+    const ContactSolver& get_solver() const { return solver; }
+    size_t get_awake_count() const { return awake_count; }
+    size_t get_sleeping_count() const { return sleeping_count; }
 };
\ No newline at end of file
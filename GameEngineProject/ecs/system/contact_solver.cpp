@@ -0,0 +1,264 @@
+#include "contact_solver.h"
+#include "../components/physics.h"
+#include "../../threading/ThreadPool.h"
+#include <algorithm>
+#include <glm/glm.hpp>
+
+// Islands per job when the islands are spread across the thread pool
+static constexpr int ISLAND_GRAIN_SIZE = 16;
+
+void ContactSolver::clear(PhysicsStore* store)
+{
+    this->store = store;
+    bodies.clear();
+    contacts.clear();
+    bodies.push_back({ PhysicsStore::INVALID, 0.0f, glm::vec3(0.0f), false });
+}
+
+unsigned ContactSolver::add_body(unsigned slot, bool sleeping)
+{
+    bodies.push_back({ slot, 1.0f / store->mass[slot], glm::vec3(0.0f), sleeping });
+    return static_cast<unsigned>(bodies.size()) - 1;
+}
+
+glm::vec3 ContactSolver::get_velocity(const SolverBody& body) const
+{
+    return body.slot == PhysicsStore::INVALID ? glm::vec3(0.0f) : store->get_velocity(body.slot);
+}
+
+void ContactSolver::add_velocity(const SolverBody& body, const glm::vec3& change)
+{
+    store->velocity_x[body.slot] += change.x;
+    store->velocity_y[body.slot] += change.y;
+    store->velocity_z[body.slot] += change.z;
+}
+
+void ContactSolver::add_contact(unsigned a, unsigned b, const glm::vec3& normal, float depth, uint64_t key)
+{
+    auto inverse_mass = bodies[a].inverse_mass + bodies[b].inverse_mass;
+    if (inverse_mass <= 0.0f)
+        return;
+    SolverContact contact{ a, b, normal, depth, key, 1.0f / inverse_mass, 0.0f, 0.0f, glm::vec3(0.0f) };
+    auto cached = cache.find(key);
+    if (cached != cache.end())
+    {
+        contact.normal_impulse = cached->second.normal_impulse;
+        // The normal may have turned since, only the part in the new tangent plane is still friction
+        auto friction = cached->second.friction_impulse;
+        contact.friction_impulse = friction - normal * glm::dot(friction, normal);
+    }
+    contacts.push_back(contact);
+}
+
+unsigned ContactSolver::find(unsigned body)
+{
+    while (parent[body] != body)
+    {
+        parent[body] = parent[parent[body]];
+        body = parent[body];
+    }
+    return body;
+}
+
+// Joins the bodies of every contact between two moving bodies, static bodies are shared by every island and join nothing.
+// An island with an awake body wakes all of its bodies, so a body woken by a contact wakes the rest of its pile.
+void ContactSolver::build_islands()
+{
+    auto body_count = static_cast<unsigned>(bodies.size());
+    parent.resize(body_count);
+    for (unsigned i = 0; i < body_count; i++)
+        parent[i] = i;
+    for (auto& contact : contacts)
+    {
+        if (bodies[contact.a].inverse_mass > 0.0f && bodies[contact.b].inverse_mass > 0.0f)
+            parent[find(contact.a)] = find(contact.b);
+    }
+
+    islands.clear();
+    island_of.assign(body_count, ~0u);
+    for (unsigned i = 0; i < body_count; i++)
+    {
+        if (bodies[i].inverse_mass <= 0.0f)
+            continue;
+        auto root = find(i);
+        if (island_of[root] == ~0u)
+        {
+            island_of[root] = static_cast<unsigned>(islands.size());
+            islands.push_back({ 0, 0, 0, 0, true });
+        }
+        auto& island = islands[island_of[root]];
+        island_of[i] = island_of[root];
+        island.body_count++;
+        island.sleeping = island.sleeping && bodies[i].sleeping;
+    }
+
+    // Counting sort of the bodies and contacts by island
+    unsigned body_offset = 0;
+    unsigned contact_offset = 0;
+    for (auto& island : islands)
+    {
+        island.first_body = body_offset;
+        body_offset += island.body_count;
+    }
+    for (auto& contact : contacts)
+    {
+        auto body = bodies[contact.a].inverse_mass > 0.0f ? contact.a : contact.b;
+        islands[island_of[body]].contact_count++;
+    }
+    for (auto& island : islands)
+    {
+        island.first_contact = contact_offset;
+        contact_offset += island.contact_count;
+        island.body_count = 0;
+        island.contact_count = 0;
+    }
+    island_bodies.resize(body_offset);
+    island_contacts.resize(contact_offset);
+    for (unsigned i = 0; i < body_count; i++)
+    {
+        if (island_of[i] == ~0u)
+            continue;
+        auto& island = islands[island_of[i]];
+        island_bodies[island.first_body + island.body_count++] = i;
+    }
+    for (unsigned i = 0; i < contacts.size(); i++)
+    {
+        auto body = bodies[contacts[i].a].inverse_mass > 0.0f ? contacts[i].a : contacts[i].b;
+        auto& island = islands[island_of[body]];
+        island_contacts[island.first_contact + island.contact_count++] = i;
+    }
+}
+
+// Only touches the bodies and contacts of the island, and the static body is never written, so islands can run at the same time
+void ContactSolver::solve_island(const SolverIsland& island, float delta_time)
+{
+    auto begin = island_contacts.begin() + island.first_contact;
+    auto end = begin + island.contact_count;
+
+    auto apply = [this](const SolverContact& contact, const glm::vec3& impulse)
+    {
+        auto& a = bodies[contact.a];
+        auto& b = bodies[contact.b];
+        if (a.inverse_mass > 0.0f)
+            add_velocity(a, -impulse * a.inverse_mass);
+        if (b.inverse_mass > 0.0f)
+            add_velocity(b, impulse * b.inverse_mass);
+    };
+
+    // Restitution works from the approaching speeds before any impulse, so they are all read before the warm start
+    for (auto it = begin; it != end; ++it)
+    {
+        auto& contact = contacts[*it];
+        auto approach = glm::dot(get_velocity(bodies[contact.b]) - get_velocity(bodies[contact.a]), contact.normal);
+        contact.target_velocity = approach < -RESTITUTION_THRESHOLD ? -RESTITUTION * approach : 0.0f;
+    }
+    for (auto it = begin; it != end; ++it)
+    {
+        auto& contact = contacts[*it];
+        apply(contact, contact.normal * contact.normal_impulse + contact.friction_impulse);
+    }
+
+    for (int iteration = 0; iteration < ITERATIONS; iteration++)
+    {
+        for (auto it = begin; it != end; ++it)
+        {
+            auto& contact = contacts[*it];
+            auto relative = get_velocity(bodies[contact.b]) - get_velocity(bodies[contact.a]);
+            auto normal_velocity = glm::dot(relative, contact.normal);
+            auto impulse = std::max(contact.normal_impulse + contact.normal_mass * (contact.target_velocity - normal_velocity), 0.0f);
+            apply(contact, contact.normal * (impulse - contact.normal_impulse));
+            contact.normal_impulse = impulse;
+
+            // Friction stops the sliding velocity, up to FRICTION times the normal impulse
+            relative = get_velocity(bodies[contact.b]) - get_velocity(bodies[contact.a]);
+            auto sliding = relative - contact.normal * glm::dot(relative, contact.normal);
+            auto friction = contact.friction_impulse - sliding * contact.normal_mass;
+            auto limit = FRICTION * contact.normal_impulse;
+            auto length2 = glm::dot(friction, friction);
+            if (length2 > limit * limit)
+                friction *= limit / glm::sqrt(length2);
+            apply(contact, friction - contact.friction_impulse);
+            contact.friction_impulse = friction;
+        }
+    }
+
+    // The overlap is removed by moving the bodies directly, one contact at a time against the corrections made so far so a
+    // push at the bottom of a stack reaches the top. Moving positions instead of velocities adds no energy.
+    for (int iteration = 0; iteration < POSITION_ITERATIONS; iteration++)
+    {
+        for (auto it = begin; it != end; ++it)
+        {
+            auto& contact = contacts[*it];
+            auto& a = bodies[contact.a];
+            auto& b = bodies[contact.b];
+            auto depth = contact.depth - glm::dot(b.correction - a.correction, contact.normal);
+            auto push = std::min((depth - SLOP) * CORRECTION, MAX_CORRECTION);
+            if (push <= 0.0f)
+                continue;
+            auto correction = contact.normal * (push * contact.normal_mass);
+            if (a.inverse_mass > 0.0f)
+                a.correction -= correction * a.inverse_mass;
+            if (b.inverse_mass > 0.0f)
+                b.correction += correction * b.inverse_mass;
+        }
+    }
+
+    auto min_rest_time = TIME_TO_SLEEP * 2.0f;
+    for (unsigned i = island.first_body; i < island.first_body + island.body_count; i++)
+    {
+        auto& body = bodies[island_bodies[i]];
+        auto velocity = get_velocity(body);
+        auto& rest_time = store->rest_time[body.slot];
+        body.sleeping = false;
+        if (glm::dot(velocity, velocity) > SLEEP_VELOCITY * SLEEP_VELOCITY)
+            rest_time = 0.0f;
+        else
+            rest_time += delta_time;
+        min_rest_time = std::min(min_rest_time, rest_time);
+    }
+    if (min_rest_time < TIME_TO_SLEEP)
+        return;
+    for (unsigned i = island.first_body; i < island.first_body + island.body_count; i++)
+    {
+        auto& body = bodies[island_bodies[i]];
+        body.sleeping = true;
+        store->set_velocity(body.slot, glm::vec3(0.0f));
+    }
+}
+
+void ContactSolver::solve(float delta_time, ThreadPool* pool)
+{
+    build_islands();
+    if (pool == nullptr)
+    {
+        for (auto& island : islands)
+        {
+            if (!island.sleeping)
+                solve_island(island, delta_time);
+        }
+    }
+    else
+    {
+        pool->parallel_for(0, static_cast<int>(islands.size()), ISLAND_GRAIN_SIZE, [this, delta_time](int begin, int end)
+            {
+                for (int i = begin; i < end; i++)
+                {
+                    if (!islands[i].sleeping)
+                        solve_island(islands[i], delta_time);
+                }
+            });
+    }
+
+    // Pairs that were not touching on the last tick are dropped, which includes the contacts of sleeping bodies as they
+    // leave the solver. A pile that wakes rebuilds its impulses in a few ticks.
+    frame++;
+    for (auto& contact : contacts)
+        cache[contact.key] = { contact.normal_impulse, contact.friction_impulse, frame };
+    for (auto it = cache.begin(); it != cache.end();)
+    {
+        if (it->second.last_used + 1 < frame)
+            it = cache.erase(it);
+        else
+            ++it;
+    }
+}
\ No newline at end of file
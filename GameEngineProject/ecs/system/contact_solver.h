@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/vec3.hpp>
+
+class ThreadPool;
+class PhysicsStore;
+
+/// @brief A body as the contact solver sees it, a body without inverse mass never moves.
+/// The velocity and the rest time are read and written in the store at the slot of the body.
+struct SolverBody
+{
+    // Slot in the store, PhysicsStore::INVALID for the static body
+    unsigned slot;
+    float inverse_mass;
+    // How far the contacts push the body out of what it overlaps, applied to the position by the caller
+    glm::vec3 correction;
+    bool sleeping;
+};
+
+/// @brief A contact point between two bodies together with the impulses the solver has applied to it
+struct SolverContact
+{
+    unsigned a;
+    unsigned b;
+    /// @brief Points from body a to body b
+    glm::vec3 normal;
+    float depth;
+    // Identifies the pair in the impulse cache
+    uint64_t key;
+    float normal_mass;
+    // Separating speed along the normal that restitution asks for
+    float target_velocity;
+    float normal_impulse;
+    // Friction impulse in the tangent plane, kept as a vector so it needs no tangent basis
+    glm::vec3 friction_impulse;
+};
+
+/// @brief Bodies connected by contacts, solved on its own so islands can run on different threads
+struct SolverIsland
+{
+    unsigned first_body;
+    unsigned body_count;
+    unsigned first_contact;
+    unsigned contact_count;
+    bool sleeping;
+};
+
+/// @brief Sequential impulse contact solver with restitution, friction and warm starting.
+/// Contacts are solved one at a time for a number of iterations, each one clamps the total impulse it has applied so far,
+/// which converges to the impulses that stop every contact from approaching at once. The impulses of the last tick are
+/// applied first so stacks that rest keep their impulses instead of rebuilding them from zero.
+/// Bodies touching each other form islands that do not share bodies, islands are solved in parallel and fall asleep together.
+class ContactSolver
+{
+public:
+    static constexpr int ITERATIONS = 10;
+    static constexpr int POSITION_ITERATIONS = 4;
+    /// @brief How much of the approaching speed two colliding bodies keep
+    static constexpr float RESTITUTION = 0.5f;
+    /// @brief Bodies approaching slower than this do not bounce, keeps resting bodies from jittering
+    static constexpr float RESTITUTION_THRESHOLD = 1.0f;
+    static constexpr float FRICTION = 0.4f;
+    /// @brief Overlap left alone so resting contacts stay touching between ticks
+    static constexpr float SLOP = 0.01f;
+    /// @brief Fraction of the overlap past SLOP removed by every position iteration
+    static constexpr float CORRECTION = 0.8f;
+    /// @brief Largest push one position iteration gives a contact, keeps deep overlaps from throwing bodies apart
+    static constexpr float MAX_CORRECTION = 0.2f;
+    static constexpr float SLEEP_VELOCITY = 0.1f;
+    /// @brief How long every body of an island has to move slower than SLEEP_VELOCITY before the island sleeps
+    static constexpr float TIME_TO_SLEEP = 0.5f;
+
+private:
+    struct CachedImpulse
+    {
+        float normal_impulse;
+        glm::vec3 friction_impulse;
+        unsigned last_used;
+    };
+
+    PhysicsStore* store = nullptr;
+    std::vector<SolverBody> bodies;
+    std::vector<SolverContact> contacts;
+    std::vector<SolverIsland> islands;
+    // Bodies and contacts grouped by island, each island owns a contiguous run of both
+    std::vector<unsigned> island_bodies;
+    std::vector<unsigned> island_contacts;
+    std::vector<unsigned> parent;
+    std::vector<unsigned> island_of;
+    std::unordered_map<uint64_t, CachedImpulse> cache;
+    unsigned frame = 0;
+
+    glm::vec3 get_velocity(const SolverBody& body) const;
+    void add_velocity(const SolverBody& body, const glm::vec3& change);
+    unsigned find(unsigned body);
+    void build_islands();
+    void solve_island(const SolverIsland& island, float delta_time);
+
+public:
+    /// @brief Index of the body every static collider is added as
+    static constexpr unsigned STATIC_BODY = 0;
+
+    /// @brief Removes every body and contact, the cached impulses are kept for the next tick
+    /// @param store Holds the bodies added until the next clear, it must not change shape until solve returns
+    void clear(PhysicsStore* store);
+    /// @brief Adds the body in a slot of the store, its velocity and rest time are solved in place
+    unsigned add_body(unsigned slot, bool sleeping);
+    /// @brief Adds a contact and starts it from the impulse the pair ended with on the last tick
+    /// @param key Identifies the pair, has to be the same on every tick
+    void add_contact(unsigned a, unsigned b, const glm::vec3& normal, float depth, uint64_t key);
+    /// @brief Solves every awake island, on the pool when one is given, and stores the impulses for the next tick
+    void solve(float delta_time, ThreadPool* pool);
+
+    const SolverBody& get_body(unsigned body) const { return bodies[body]; }
+    size_t get_contact_count() const { return contacts.size(); }
+    size_t get_island_count() const { return islands.size(); }
+};
\ No newline at end of file
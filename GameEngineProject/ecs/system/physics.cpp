@@ -1,26 +1,152 @@
 #include "physics.h"
 #include "../components/physics.h"
 #include "../components/transform.h"
+#include <cmath>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PHYSICS_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PHYSICS_SSE
+#endif
 
+// Bodies per job when the integration is split across the thread pool
+constexpr int PHYSICS_CHUNK_SIZE = 2048;
+
+PhysicsSystem::PhysicsSystem(ECSGlobalMap* ecs, World* world) : BaseSystem(ecs, world)
+{
+    writes_component<PhysicsComponent>();
+    writes_component<TransformComponent>();
+}
+
+// The velocities are integrated in the arrays of the store, the positions are then moved in the transforms, which are the
+// only part of a body that is not in the store. Sleeping bodies are after the awake ones and are never visited.
 void PhysicsSystem::update(float delta_time)
 {
-    auto ecs = get_ecs();
-    auto physics = ecs->get<PhysicsComponent>();
-    if (physics == nullptr)
+    auto bodies = get_ecs()->get<PhysicsComponent>();
+    auto transforms = get_ecs()->get<TransformComponent>();
+    if (bodies == nullptr || transforms == nullptr)
         return;
-    for (int i = 0; i < physics->get_size(); i++)
+    parallel_for(static_cast<int>(bodies->get_awake_count()), PHYSICS_CHUNK_SIZE, [bodies, transforms, delta_time](int begin, int end)
+        {
+            integrate(*bodies, begin, end, delta_time, GRAVITY);
+            for (int i = begin; i < end; i++)
+            {
+                if (auto transform = transforms->get(bodies->get_entity(i)))
+                    transform->position += bodies->get_velocity(i) * delta_time;
+            }
+        });
+}
+
+void PhysicsSystem::integrate_scalar(PhysicsStore& bodies, size_t begin, size_t end, float delta_time, float gravity)
+{
+    for (size_t i = begin; i < end; i++)
     {
-        auto component = physics->get_value_pair<PhysicsComponent>(i);
-        if (component == nullptr)
-            continue;
-        component->value->update(delta_time);
-        component->value->apply_gravity(9.8f);
-        auto position = ecs->get<TransformComponent>(component->id);
-        if (position != nullptr)
+        float m = bodies.mass[i];
+        bodies.acceleration_y[i] += -gravity * m / m;
+        // The drag is skipped as a whole when any component of it is nan
+        float fx = bodies.velocity_x[i] * bodies.drag[i];
+        float fy = bodies.velocity_y[i] * bodies.drag[i];
+        float fz = bodies.velocity_z[i] * bodies.drag[i];
+        if (!std::isnan(fx) && !std::isnan(fy) && !std::isnan(fz))
         {
-            position->position += component->value->velocity * delta_time;
+            bodies.acceleration_x[i] += -fx / m;
+            bodies.acceleration_y[i] += -fy / m;
+            bodies.acceleration_z[i] += -fz / m;
         }
-        delete component;
+        bodies.velocity_x[i] += bodies.acceleration_x[i] * delta_time;
+        bodies.velocity_y[i] += bodies.acceleration_y[i] * delta_time;
+        bodies.velocity_z[i] += bodies.acceleration_z[i] * delta_time;
+        bodies.acceleration_x[i] = 0.0f;
+        bodies.acceleration_y[i] = 0.0f;
+        bodies.acceleration_z[i] = 0.0f;
+    }
+}
+
+#if defined(PHYSICS_AVX)
+
+void PhysicsSystem::integrate(PhysicsStore& bodies, size_t begin, size_t end, float delta_time, float gravity)
+{
+    const __m256 dt = _mm256_set1_ps(delta_time);
+    const __m256 g = _mm256_set1_ps(-gravity);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 m = _mm256_loadu_ps(&bodies.mass[i]);
+        __m256 d = _mm256_loadu_ps(&bodies.drag[i]);
+        __m256 vx = _mm256_loadu_ps(&bodies.velocity_x[i]);
+        __m256 vy = _mm256_loadu_ps(&bodies.velocity_y[i]);
+        __m256 vz = _mm256_loadu_ps(&bodies.velocity_z[i]);
+        __m256 ax = _mm256_loadu_ps(&bodies.acceleration_x[i]);
+        __m256 ay = _mm256_loadu_ps(&bodies.acceleration_y[i]);
+        __m256 az = _mm256_loadu_ps(&bodies.acceleration_z[i]);
+        ay = _mm256_add_ps(ay, _mm256_div_ps(_mm256_mul_ps(g, m), m));
+
+        __m256 fx = _mm256_mul_ps(vx, d);
+        __m256 fy = _mm256_mul_ps(vy, d);
+        __m256 fz = _mm256_mul_ps(vz, d);
+        __m256 valid = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(fx, fx, _CMP_ORD_Q), _mm256_cmp_ps(fy, fy, _CMP_ORD_Q)), _mm256_cmp_ps(fz, fz, _CMP_ORD_Q));
+        ax = _mm256_add_ps(ax, _mm256_and_ps(valid, _mm256_div_ps(_mm256_xor_ps(fx, sign), m)));
+        ay = _mm256_add_ps(ay, _mm256_and_ps(valid, _mm256_div_ps(_mm256_xor_ps(fy, sign), m)));
+        az = _mm256_add_ps(az, _mm256_and_ps(valid, _mm256_div_ps(_mm256_xor_ps(fz, sign), m)));
+
+        _mm256_storeu_ps(&bodies.velocity_x[i], _mm256_add_ps(vx, _mm256_mul_ps(ax, dt)));
+        _mm256_storeu_ps(&bodies.velocity_y[i], _mm256_add_ps(vy, _mm256_mul_ps(ay, dt)));
+        _mm256_storeu_ps(&bodies.velocity_z[i], _mm256_add_ps(vz, _mm256_mul_ps(az, dt)));
+        _mm256_storeu_ps(&bodies.acceleration_x[i], zero);
+        _mm256_storeu_ps(&bodies.acceleration_y[i], zero);
+        _mm256_storeu_ps(&bodies.acceleration_z[i], zero);
+    }
+    integrate_scalar(bodies, i, end, delta_time, gravity);
+}
+
+#elif defined(PHYSICS_SSE)
+
+void PhysicsSystem::integrate(PhysicsStore& bodies, size_t begin, size_t end, float delta_time, float gravity)
+{
+    const __m128 dt = _mm_set1_ps(delta_time);
+    const __m128 g = _mm_set1_ps(-gravity);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 m = _mm_loadu_ps(&bodies.mass[i]);
+        __m128 d = _mm_loadu_ps(&bodies.drag[i]);
+        __m128 vx = _mm_loadu_ps(&bodies.velocity_x[i]);
+        __m128 vy = _mm_loadu_ps(&bodies.velocity_y[i]);
+        __m128 vz = _mm_loadu_ps(&bodies.velocity_z[i]);
+        __m128 ax = _mm_loadu_ps(&bodies.acceleration_x[i]);
+        __m128 ay = _mm_loadu_ps(&bodies.acceleration_y[i]);
+        __m128 az = _mm_loadu_ps(&bodies.acceleration_z[i]);
+        ay = _mm_add_ps(ay, _mm_div_ps(_mm_mul_ps(g, m), m));
+
+        __m128 fx = _mm_mul_ps(vx, d);
+        __m128 fy = _mm_mul_ps(vy, d);
+        __m128 fz = _mm_mul_ps(vz, d);
+        __m128 valid = _mm_and_ps(_mm_and_ps(_mm_cmpord_ps(fx, fx), _mm_cmpord_ps(fy, fy)), _mm_cmpord_ps(fz, fz));
+        ax = _mm_add_ps(ax, _mm_and_ps(valid, _mm_div_ps(_mm_xor_ps(fx, sign), m)));
+        ay = _mm_add_ps(ay, _mm_and_ps(valid, _mm_div_ps(_mm_xor_ps(fy, sign), m)));
+        az = _mm_add_ps(az, _mm_and_ps(valid, _mm_div_ps(_mm_xor_ps(fz, sign), m)));
+
+        _mm_storeu_ps(&bodies.velocity_x[i], _mm_add_ps(vx, _mm_mul_ps(ax, dt)));
+        _mm_storeu_ps(&bodies.velocity_y[i], _mm_add_ps(vy, _mm_mul_ps(ay, dt)));
+        _mm_storeu_ps(&bodies.velocity_z[i], _mm_add_ps(vz, _mm_mul_ps(az, dt)));
+        _mm_storeu_ps(&bodies.acceleration_x[i], zero);
+        _mm_storeu_ps(&bodies.acceleration_y[i], zero);
+        _mm_storeu_ps(&bodies.acceleration_z[i], zero);
     }
-}
\ No newline at end of file
+    integrate_scalar(bodies, i, end, delta_time, gravity);
+}
+
+#else
+
+void PhysicsSystem::integrate(PhysicsStore& bodies, size_t begin, size_t end, float delta_time, float gravity)
+{
+    integrate_scalar(bodies, begin, end, delta_time, gravity);
+}
+
+#endif
\ No newline at end of file
@@ -1,11 +1,27 @@
 #pragma once
 
+#include <cstddef>
 #include <glm/vec3.hpp>
 #include "base.h"
 
+struct PhysicsComponent;
+struct TransformComponent;
+class PhysicsStore;
+
 class PhysicsSystem : public BaseSystem
 {
 public:
-    PhysicsSystem(ECSGlobalMap* ecs, World* world) : BaseSystem(ecs, world) {}
+    static constexpr float GRAVITY = 9.8f;
+
+    PhysicsSystem(ECSGlobalMap* ecs, World* world);
     void update(float delta_time) override;
+    const char* get_name() const override { return "Physics"; }
+
+    /// @brief Integrates gravity and drag into the velocity of the slots [begin, end), then clears the acceleration.
+    /// Runs 8 (AVX) or 4 (SSE) bodies per instruction, whichever the build targets, and integrate_scalar for the rest.
+    /// Sleeping bodies are not skipped, the caller passes awake slots.
+    /// @param gravity The gravity along -y
+    static void integrate(PhysicsStore& bodies, size_t begin, size_t end, float delta_time, float gravity);
+    /// @brief The same as integrate one body at a time, gives the same results as the SIMD paths
+    static void integrate_scalar(PhysicsStore& bodies, size_t begin, size_t end, float delta_time, float gravity);
 };
\ No newline at end of file
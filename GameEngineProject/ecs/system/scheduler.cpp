@@ -0,0 +1,113 @@
+#include "scheduler.h"
+#include "../../threading/ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+SystemScheduler::SystemScheduler(ThreadPool* pool) : pool(pool)
+{
+}
+
+SystemScheduler::~SystemScheduler()
+{
+    for (auto system : systems)
+    {
+        delete system;
+    }
+}
+
+void SystemScheduler::add(BaseSystem* system)
+{
+    systems.push_back(system);
+    timings.push_back({ system->get_name(), 0.0f });
+    system->set_pool(parallel ? pool : nullptr);
+    graph_dirty = true;
+}
+
+void SystemScheduler::set_pool(ThreadPool* pool)
+{
+    this->pool = pool;
+    set_parallel(parallel);
+}
+
+void SystemScheduler::set_parallel(bool parallel)
+{
+    this->parallel = parallel;
+    for (auto system : systems)
+    {
+        system->set_pool(parallel ? pool : nullptr);
+    }
+}
+
+void SystemScheduler::get_stats(std::vector<SystemStat>& stats) const
+{
+    for (auto system : systems)
+        system->get_stats(stats);
+}
+
+void SystemScheduler::build_graph()
+{
+    dependents.assign(systems.size(), {});
+    dependency_counts.assign(systems.size(), 0);
+    for (unsigned later = 0; later < systems.size(); later++)
+    {
+        for (unsigned earlier = 0; earlier < later; earlier++)
+        {
+            if (systems[earlier]->conflicts_with(*systems[later]))
+            {
+                dependents[earlier].push_back(later);
+                dependency_counts[later]++;
+            }
+        }
+    }
+    graph_dirty = false;
+}
+
+void SystemScheduler::run_system(unsigned index, float delta_time)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    systems[index]->update(delta_time);
+    auto end = std::chrono::high_resolution_clock::now();
+    timings[index].milliseconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0f;
+}
+
+void SystemScheduler::run(float delta_time)
+{
+    if (!parallel || pool == nullptr || systems.size() < 2)
+    {
+        for (unsigned i = 0; i < systems.size(); i++)
+        {
+            run_system(i, delta_time);
+        }
+        return;
+    }
+
+    if (graph_dirty)
+        build_graph();
+
+    auto remaining = std::make_unique<std::atomic<int>[]>(systems.size());
+    for (unsigned i = 0; i < systems.size(); i++)
+    {
+        remaining[i] = dependency_counts[i];
+    }
+
+    JobCounter counter;
+    std::function<void(unsigned)> schedule = [&](unsigned index)
+    {
+        pool->submit([&, index]()
+            {
+                run_system(index, delta_time);
+                for (auto dependent : dependents[index])
+                {
+                    if (--remaining[dependent] == 0)
+                        schedule(dependent);
+                } },
+            counter);
+    };
+    for (unsigned i = 0; i < systems.size(); i++)
+    {
+        if (dependency_counts[i] == 0)
+            schedule(i);
+    }
+    pool->wait(counter);
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include "base.h"
+
+class ThreadPool;
+
+struct SystemTiming
+{
+    const char* name;
+    float milliseconds;
+};
+
+/// @brief Runs the registered systems every tick.
+/// Systems are ordered by registration, a system only waits on earlier systems it conflicts with through its declared
+/// component reads and writes, so the result is the same as running them one after another.
+class SystemScheduler
+{
+private:
+    std::vector<BaseSystem*> systems;
+    // For every system the later systems that must wait for it
+    std::vector<std::vector<unsigned>> dependents;
+    std::vector<int> dependency_counts;
+    std::vector<SystemTiming> timings;
+    ThreadPool* pool;
+    bool parallel = true;
+    bool graph_dirty = false;
+
+    void build_graph();
+    void run_system(unsigned index, float delta_time);
+
+public:
+    explicit SystemScheduler(ThreadPool* pool);
+    ~SystemScheduler();
+
+    /// @brief Registers a system, the scheduler takes ownership of it
+    void add(BaseSystem* system);
+    void run(float delta_time);
+
+    /// @brief Replaces the pool the systems run on, the pool has to outlive the scheduler
+    void set_pool(ThreadPool* pool);
+    /// @brief Switches between running systems on the pool and running them in order on the calling thread
+    void set_parallel(bool parallel);
+    bool get_parallel() const { return parallel; }
+    /// @brief Gets how long each system took during the last run, in registration order
+    const std::vector<SystemTiming>& get_timings() const { return timings; }
+    /// @brief Collects the stats of every system in registration order
+    void get_stats(std::vector<SystemStat>& stats) const;
+};
\ No newline at end of file
@@ -4,8 +4,8 @@
 #include <fstream>
 #include <cstring>
 #include <algorithm>
-#include <intrin.h>
 #include <iomanip>
+#include <stdexcept>
 
 void load_las_file(const char* filename, std::vector<char>& data)
 {
@@ -25,6 +25,9 @@ void load_las_file(const char* filename, std::vector<char>& data)
 
 void parse_las_file(const char* data, size_t size, LASFile* las_file)
 {
+    // 0xE3 is the size of the smallest header, LAS 1.0
+    if (size < 0xE3 || std::memcmp(data, "LASF", 4) != 0)
+        throw std::runtime_error("Not a LAS file");
     parse_las_header(data, &las_file->header);
     size_t offset = las_file->header.header_size;
     las_file->variable_length_records = nullptr;
@@ -38,7 +41,9 @@ void parse_las_file(const char* data, size_t size, LASFile* las_file)
             offset += 0x36; // Variable length record header size
         }
     }
-    size_t point_size = las_file->header.number_of_point_records * las_file->header.point_data_record_length;
+    size_t point_size = size_t(las_file->header.number_of_point_records) * las_file->header.point_data_record_length;
+    if (las_file->header.offset_to_point_data + point_size > size)
+        throw std::runtime_error("LAS file is truncated");
     las_file->point_data = new char[point_size];
     std::memcpy(las_file->point_data, data + las_file->header.offset_to_point_data, point_size);
 }
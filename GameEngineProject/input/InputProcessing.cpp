@@ -1,6 +1,6 @@
 #include "InputProcessing.h"
 
-#include "glfw/glfw3.h"
+#include "GLFW/glfw3.h"
 #include "glm/gtc/type_ptr.hpp"
 
 InputProcessing::InputProcessing()
@@ -5,7 +5,7 @@
 
 #include "Camera.h"
 #include "../Shader.h"
-#include "glfw/glfw3.h"
+#include "GLFW/glfw3.h"
 #include "glm/ext/matrix_clip_space.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
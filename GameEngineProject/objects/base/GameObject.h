@@ -1,10 +1,12 @@
 #pragma once
 
 #include "GameObjectBase.h"
+#include <cassert>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "../../colliders/Collider.h"
+#include "../../colliders/AABB.h"
 #include "../../input/Camera.h"
 
 class GameObject : public GameObjectBase
@@ -15,6 +17,9 @@ private:
     ColliderBase* collider;
     bool is_active;
     bool has_updated;
+    // Set by the render thread before drawing, the transform belongs to the simulation thread
+    glm::mat4x4 render_matrix = glm::mat4x4(1.0f);
+    bool has_render_matrix = false;
 
 public:
     GameObject(std::vector<Vertex> vertices, std::vector<unsigned> indices, World* world) : GameObjectBase(vertices, indices, world), collider(nullptr), is_active(true), has_updated(false), parent(nullptr) {}
@@ -48,11 +53,22 @@ public:
     /// @brief Gets the collider of the object
     /// @return The collider of the object
     virtual ColliderBase* get_collider() { return collider; }
+    /// @brief Gets the bounds the renderer culls the object with
+    /// @return false if the object has no bounds and is always drawn
+    virtual bool get_render_bounds(AABB& bounds)
+    {
+        if (collider == nullptr)
+            return false;
+        bounds = collider->get_bounds();
+        return true;
+    }
+    /// @brief Called by the render thread before every draw with the position of the camera, lets an object pick what it draws
+    virtual void set_view_position(const glm::vec3& eye) {}
 
     void pre_render() const override
     {
         GameObjectBase::pre_render();
-        get_shader()->set_mat4("model", get_model_matrix());
+        get_shader()->set_mat4("model", get_render_matrix());
     }
 
     void render() const override
@@ -76,6 +92,21 @@ public:
         return get_component<TransformComponent>()->get_model_matrix();
     }
 
+    /// @brief Sets the model matrix the object is drawn with, the world sets it from its snapshot before every draw
+    void set_render_matrix(const glm::mat4x4& matrix)
+    {
+        render_matrix = matrix;
+        has_render_matrix = true;
+    }
+
+    /// @brief Gets the model matrix the object is drawn with. The transform belongs to the simulation thread and is never
+    /// read here, an object has to be given a render matrix before it is drawn
+    glm::mat4x4 get_render_matrix() const
+    {
+        assert(has_render_matrix && "Drawn without a render matrix, set one from the snapshot first");
+        return render_matrix;
+    }
+
     glm::mat4x4 get_world_matrix(glm::mat4x4 world) const
     {
         if (parent != nullptr)
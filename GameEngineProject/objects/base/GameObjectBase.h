@@ -13,7 +13,9 @@
 class GameObjectBase
 {
 private:
-    UUID uuid;
+    Entity entity = Entity::null();
+    // Persistent identity for serialization, only generated when first asked for
+    mutable UUID uuid = UUID::empty();
     std::vector<Vertex> vertices;
     std::vector<unsigned> indices;
     // Shaders can be shared between objects
@@ -21,28 +23,33 @@ private:
     // Materials are per object currently, TODO make a shared library for materials to be shared between objects
     Material* material = nullptr;
     GLenum mode = GL_TRIANGLES;
+    bool visible = true;
     Vertex bounding_box[2];
     World* world;
 
 public:
-    GameObjectBase(std::vector<Vertex> vertices, std::vector<unsigned> indices, World* world) : vertices(vertices), indices(indices), world(world), uuid(UUID::generate_v4()) {};
+    GameObjectBase(std::vector<Vertex> vertices, std::vector<unsigned> indices, World* world) : vertices(vertices), indices(indices), world(world) {};
     GameObjectBase() : vertices({}), indices({}), world(nullptr) {};
     ~GameObjectBase()
     {
         vertices.clear();
         indices.clear();
         if (world != nullptr)
-            world->get_ecs()->remove_all(uuid);
+            world->get_ecs()->destroy_entity(entity);
         delete material;
     };
 
-    void update_vertices(std::vector<Vertex> vertices) { this->vertices = vertices; }
-    void update_indices(std::vector<unsigned> indices) { this->indices = indices; }
+    void update_vertices(std::vector<Vertex> vertices) { this->vertices = std::move(vertices); }
+    void update_indices(std::vector<unsigned> indices) { this->indices = std::move(indices); }
     std::vector<Vertex> get_vertices() const { return vertices; }
     std::vector<Vertex>* get_vertices_ptr() const { return const_cast<std::vector<Vertex> *>(&vertices); }
     std::vector<unsigned> get_indices() const { return indices; }
     void set_shader(Shader* shader) { this->shader = shader; }
     void set_mode(GLenum mode) { this->mode = mode; }
+    GLenum get_mode() const { return mode; }
+    /// @brief Hides the object from the renderer, it still takes part in the simulation
+    void set_visible(bool visible) { this->visible = visible; }
+    bool get_visible() const { return visible; }
     void set_material(Material* material) { this->material = material; }
     Material* get_material() const { return material; }
     Shader* get_shader() const { return shader; }
@@ -63,15 +70,23 @@ public:
     Vertex get_min_vertex() const;
     Vertex get_max_vertex() const;
     void attatch_to_world(World* world) { this->world = world; }
-    bool should_render() const { return vertices.size() > 0; }
+    World* get_world() const { return world; }
+    virtual bool should_render() const { return visible && vertices.size() > 0; }
     virtual void register_ecs(ECSGlobalMap* ecs)
     {
-        ecs->insert<TransformComponent>(uuid, new TransformComponent{ glm::vec3(0), glm::quat(1, 0, 0, 0), glm::vec3(1) });
+        entity = ecs->create_entity();
+        ecs->insert<TransformComponent>(entity, TransformComponent{ glm::vec3(0), glm::quat(1, 0, 0, 0), glm::vec3(1) });
     };
     template <typename T>
     T* get_component() const
     {
-        return world->get_ecs()->get<T>(uuid);
+        return world->get_ecs()->get<T>(entity);
+    }
+    Entity get_entity() const { return entity; }
+    UUID get_uuid() const
+    {
+        if (uuid == UUID::empty())
+            uuid = UUID::generate_v4();
+        return uuid;
     }
-    UUID get_uuid() const { return uuid; }
 };
\ No newline at end of file
@@ -1,12 +1,17 @@
 #pragma once
 
 #include "../base/GameObject.h"
-#include "../../Window.h"
+#include "../../Progress.h"
 #include "BSpline.h"
-#include <map>
-#include <array>
-#include <optional>
-#include <format>
+#include "../../colliders/Sweep.h"
+#include "../../colliders/Heightfield.h"
+#include "../../threading/ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <span>
+#include <tuple>
 #include <glm/gtx/exterior_product.hpp>
 
 
@@ -20,66 +25,70 @@ private:
     std::vector<glm::vec3> points;
     std::vector<float> knot_vector_u;
     std::vector<float> knot_vector_v;
-
-    std::pair<glm::vec3, glm::vec3> b2(float tu, float tv, int iu, int iv)
+    // Heights of the triangle mesh for the terrain queries, rebuilt with the mesh
+    Heightfield heightfield;
+    // Corners of the surface in the xz plane at the start and end of the knot vectors
+    glm::vec2 surface_min = glm::vec2(0);
+    glm::vec2 surface_max = glm::vec2(0);
+    float min_control_height = 0.0f;
+    float max_control_height = 0.0f;
+    // Parameter step between the rows and columns of the mesh
+    float spacing = 0.1f;
+
+    static constexpr int MAX_NEWTON_ITERATIONS = 8;
+    // Rows per job and per progress report when tessellating
+    static constexpr int ROW_GRAIN_SIZE = 4;
+    static constexpr int ROWS_PER_PROGRESS_REPORT = 128;
+    // How far the point found for a world x and z may be from it, in world units
+    static constexpr float NEWTON_TOLERANCE = 1e-4f;
+    // A sweep without the mesh samples the exact surface at most this many radii apart and halves the step that touches it this many times
+    static constexpr float EXACT_SWEEP_STEP = 0.5f;
+    static constexpr int EXACT_SWEEP_MAX_SAMPLES = 64;
+    static constexpr int EXACT_SWEEP_BISECTIONS = 10;
+
+    /// @brief Finds the knot span holding t in constant time on a uniform knot vector, the guess is corrected on any other
+    static int find_span(float t, int degree, int num_points, const std::vector<float>& knot_vector)
     {
-        glm::vec3 bv;
-        glm::vec3 bu;
-
-        auto w12 = (tu - knot_vector_u[iu - 1]) / (knot_vector_u[iu + 1] - knot_vector_u[iu - 1]);
-        auto w22 = (tu - knot_vector_u[iu]) / (knot_vector_u[iu + 2] - knot_vector_u[iu]);
-        auto w11 = (tu - knot_vector_u[iu]) / (knot_vector_u[iu + 1] - knot_vector_u[iu]);
-
-        bu.x = (1 - w11) * (1 - w12);
-        bu.z = w11 * w22;
-        bu.y = 1 - bu.x - bu.z;
-
-        w12 = (tv - knot_vector_v[iv - 1]) / (knot_vector_v[iv + 1] - knot_vector_v[iv - 1]);
-        w22 = (tv - knot_vector_v[iv]) / (knot_vector_v[iv + 2] - knot_vector_v[iv]);
-        w11 = (tv - knot_vector_v[iv]) / (knot_vector_v[iv + 1] - knot_vector_v[iv]);
-
-        bv.x = (1 - w11) * (1 - w12);
-        bv.z = w11 * w22;
-        bv.y = 1 - bv.x - bv.z;
-
-        return std::make_pair(bu, bv);
+        auto step = knot_vector[degree + 1] - knot_vector[degree];
+        int span = degree;
+        if (step > 0.0f)
+            span = std::clamp(degree + static_cast<int>((t - knot_vector[degree]) / step), degree, num_points - 1);
+        while (span > degree && t < knot_vector[span])
+            span--;
+        while (span < num_points - 1 && t >= knot_vector[span + 1])
+            span++;
+        return span;
     }
 
-    glm::vec3 evaluateBiquadratic(int iu, int iv, glm::vec3 bu, glm::vec3 bv)
+    /// @brief Gets the three quadratic basis functions that are not zero in knot span i and their derivatives, used by the tessellation and evaluate
+    static void quadratic_basis(float t, int i, const std::vector<float>& knot_vector, glm::vec3& basis, glm::vec3& derivative)
     {
-
-        glm::vec3 r(0);
-        glm::mat3x3 m(0);
-        glm::vec3 tmp_points[3][3];
-
-        auto du = iu - degree_u;
-        auto dv = iv - degree_v;
-
-        for (int j = 0; j < 3; ++j)
-        {
-            for (int i = 0; i < 3; ++i)
-            {
-                auto u = du + i;
-                auto v = dv + j;
-                m[j][i] = bu[i] * bv[j];
-                tmp_points[j][i] = points[u + v * num_points_u];
-                r += bu[i] * bv[j] * points[u + v * num_points_u];
-            }
-        }
-
-        return r;
+        auto w11 = (t - knot_vector[i]) / (knot_vector[i + 1] - knot_vector[i]);
+        auto w12 = (t - knot_vector[i - 1]) / (knot_vector[i + 1] - knot_vector[i - 1]);
+        auto w22 = (t - knot_vector[i]) / (knot_vector[i + 2] - knot_vector[i]);
+        basis.x = (1 - w11) * (1 - w12);
+        basis.z = w11 * w22;
+        basis.y = 1 - basis.x - basis.z;
+        derivative.x = -2 * (1 - w11) / (knot_vector[i + 1] - knot_vector[i - 1]);
+        derivative.z = 2 * w11 / (knot_vector[i + 2] - knot_vector[i]);
+        derivative.y = -derivative.x - derivative.z;
     }
 
-    int find_knot_interval(float t, int degree, int num_points, std::vector<float> knot_vector)
+    /// @brief Runs func over the rows [0, count) on the global pool, a block of rows at a time so progress is reported
+    /// from the calling thread between blocks
+    static void run_rows(int count, const char* stage, const std::function<void(int, int)>& func)
     {
-        int n = num_points - 1;
-        while (t < knot_vector[n] && n > degree)
-            n--;
-        return n;
+        auto& pool = ThreadPool::get_global();
+        for (int block = 0; block < count; block += ROWS_PER_PROGRESS_REPORT)
+        {
+            auto block_end = std::min(block + ROWS_PER_PROGRESS_REPORT, count);
+            pool.parallel_for(block, block_end, ROW_GRAIN_SIZE, func);
+            Progress::report(stage, float(block_end) / count * 100);
+        }
     }
 
 public:
-    BSplineSurface(int degree_u, int degree_v, int num_points_u, int num_points_v, std::vector<float> knot_vector_u, std::vector<float> knot_vector_v, std::vector<glm::vec3> points, float spacing = 0.1f) : GameObject()
+    BSplineSurface(int degree_u, int degree_v, int num_points_u, int num_points_v, std::vector<float> knot_vector_u, std::vector<float> knot_vector_v, std::vector<glm::vec3> points, float spacing = 0.1f, bool tessellate = true) : GameObject()
     {
         this->degree_u = degree_u;
         this->degree_v = degree_v;
@@ -89,415 +98,380 @@ public:
         this->knot_vector_v = knot_vector_v;
         this->points = points;
 
-        computeSurface(spacing);
+        // Clamped ends put the corners of the surface near the corner control points, the exact corners come from evaluate
+        auto first = evaluate(get_min_u(), get_min_v());
+        auto last = evaluate(get_max_u(), get_max_v());
+        surface_min = glm::vec2(first.x, first.z);
+        surface_max = glm::vec2(last.x, last.z);
+        // The surface stays inside the convex hull of its control points
+        min_control_height = FLT_MAX;
+        max_control_height = -FLT_MAX;
+        for (auto& point : points)
+        {
+            min_control_height = std::min(min_control_height, point.y);
+            max_control_height = std::max(max_control_height, point.y);
+        }
+
+        this->spacing = spacing;
+        // Without the mesh the terrain queries and the sweeps use the exact surface
+        if (tessellate)
+            computeSurface(spacing);
     }
 
-    void computeSurface(float spacing = 0.1f)
+    float get_min_u() const { return knot_vector_u[degree_u]; }
+    float get_max_u() const { return knot_vector_u[num_points_u]; }
+    float get_min_v() const { return knot_vector_v[degree_v]; }
+    float get_max_v() const { return knot_vector_v[num_points_v]; }
+    float get_spacing() const { return spacing; }
+
+    /// @brief Gets how many rows (along u) and columns (along v) of vertices the mesh has when tessellated every spacing
+    void get_grid_size(float spacing, int& rows, int& columns) const
     {
-        std::vector<Vertex> vertices;
-        std::vector<unsigned> indices;
-        int num_u = 1 + (knot_vector_u[num_points_u] - knot_vector_u[degree_u]) / spacing;
-        int num_v = 1 + (knot_vector_v[num_points_v] - knot_vector_v[degree_v]) / spacing;
+        rows = 1 + (get_max_u() - get_min_u()) / spacing;
+        columns = 1 + (get_max_v() - get_min_v()) / spacing;
+    }
 
-        for (int i = 0; i < num_u; i++)
+    /// @brief Gets bounds holding the part of the surface over [min_u, max_u] x [min_v, max_v] without evaluating it,
+    /// from the control points that shape that part. The surface stays inside the convex hull of those control points.
+    void get_control_bounds(float min_u, float max_u, float min_v, float max_v, glm::vec3& min, glm::vec3& max) const
+    {
+        auto first_u = find_span(std::clamp(min_u, get_min_u(), get_max_u()), degree_u, num_points_u, knot_vector_u) - degree_u;
+        auto last_u = find_span(std::clamp(max_u, get_min_u(), get_max_u()), degree_u, num_points_u, knot_vector_u);
+        auto first_v = find_span(std::clamp(min_v, get_min_v(), get_max_v()), degree_v, num_points_v, knot_vector_v) - degree_v;
+        auto last_v = find_span(std::clamp(max_v, get_min_v(), get_max_v()), degree_v, num_points_v, knot_vector_v);
+        min = glm::vec3(FLT_MAX);
+        max = glm::vec3(-FLT_MAX);
+        for (int j = first_v; j <= last_v; j++)
         {
-            for (int j = 0; j < num_v; j++)
+            for (int i = first_u; i <= last_u; i++)
             {
-                float u = i * spacing;
-                float v = j * spacing;
-
-                auto iu = find_knot_interval(u, degree_u, num_points_u, knot_vector_u);
-                auto iv = find_knot_interval(v, degree_v, num_points_v, knot_vector_v);
-
-                auto coeff_pair = b2(u, v, iu, iv);
-
-                glm::vec3 p = evaluateBiquadratic(iu, iv, coeff_pair.first, coeff_pair.second);
-
-                vertices.push_back(Vertex{ p, glm::vec3(0, 1, 0), glm::vec2(0, 0) });
+                min = glm::min(min, points[i + j * num_points_u]);
+                max = glm::max(max, points[i + j * num_points_u]);
             }
-            glfwSetWindowTitle(Window::glfWindow, std::format("Processing BSplineSurface vertexes: {:.2f}%", (float)(i * num_v) / (num_v * num_v) * 100).c_str());
         }
+    }
 
-        for (int i = 0; i < num_u - 1; i++)
+    /// @brief Evaluates the surface and its partial derivatives at (u, v) straight from the control points.
+    /// u and v are clamped to the domain of the knot vectors.
+    void evaluate(float u, float v, glm::vec3& point, glm::vec3& d_du, glm::vec3& d_dv) const
+    {
+        u = std::clamp(u, get_min_u(), get_max_u());
+        v = std::clamp(v, get_min_v(), get_max_v());
+        auto iu = find_span(u, degree_u, num_points_u, knot_vector_u);
+        auto iv = find_span(v, degree_v, num_points_v, knot_vector_v);
+        glm::vec3 bu, bv, dbu, dbv;
+        quadratic_basis(u, iu, knot_vector_u, bu, dbu);
+        quadratic_basis(v, iv, knot_vector_v, bv, dbv);
+
+        point = d_du = d_dv = glm::vec3(0);
+        auto du = iu - degree_u;
+        auto dv = iv - degree_v;
+        for (int j = 0; j < 3; ++j)
         {
-            for (int j = 0; j < num_v - 1; j++)
+            for (int i = 0; i < 3; ++i)
             {
-                auto p0 = i * num_v + j;
-                auto p1 = i * num_v + j + 1;
-                auto p2 = (i + 1) * num_v + j + 1;
-                auto p3 = (i + 1) * num_v + j;
-                auto n1 = glm::normalize(glm::cross(vertices[p1].position - vertices[p0].position, vertices[p2].position - vertices[p0].position));
-                auto n2 = glm::normalize(glm::cross(vertices[p2].position - vertices[p0].position, vertices[p3].position - vertices[p0].position));
-                indices.push_back(p0);
-                indices.push_back(p1);
-                indices.push_back(p2);
-                vertices[p0].normal = n1;
-                vertices[p1].normal = n1;
-                vertices[p2].normal = n1;
-
-                indices.push_back(p0);
-                indices.push_back(p2);
-                indices.push_back(p3);
-                vertices[p0].normal = glm::normalize(n2 + vertices[p0].normal);
-                vertices[p2].normal = glm::normalize(n2 + vertices[p2].normal);
-                vertices[p3].normal = n2;
+                const auto& control = points[du + i + (dv + j) * num_points_u];
+                point += bu[i] * bv[j] * control;
+                d_du += dbu[i] * bv[j] * control;
+                d_dv += bu[i] * dbv[j] * control;
             }
-            glfwSetWindowTitle(Window::glfWindow, std::format("Processing BSplineSurface indices: {:.2f}%", (float)(i * num_v) / (num_v * num_v) * 100).c_str());
         }
-
-        update_vertices(vertices);
-        update_indices(indices);
     }
 
-private:
-    // Spatial cell for quick lookups
-    struct SpatialCell
+    glm::vec3 evaluate(float u, float v) const
     {
-        std::vector<int> vertex_indices;
-        glm::vec2 min_bounds;
-        glm::vec2 max_bounds;
-    };
+        glm::vec3 point, d_du, d_dv;
+        evaluate(u, v, point, d_du, d_dv);
+        return point;
+    }
 
-    // Cache for recent results
-    struct CacheEntry
-    {
-        glm::vec3 position;
-        int vertex_index;
-        float y;
-        glm::vec3 normal;
-        bool valid;
-    };
-
-    // Spatial acceleration grid
-    mutable std::vector<SpatialCell> spatial_grid;
-    mutable int spatial_grid_size = 0;
-    mutable glm::vec2 cell_size;
-    mutable glm::vec2 terrain_min;
-    mutable glm::vec2 terrain_max;
-    mutable bool spatial_grid_initialized = false;
-
-    // LRU cache for multiple positions
-    static constexpr size_t CACHE_SIZE = 16;
-    mutable std::array<CacheEntry, CACHE_SIZE> position_cache;
-    mutable size_t cache_index = 0;
-
-    void init_spatial_grid() const
+    /// @brief Finds the (u, v) whose point lies over world x and z with Newton's method on the partial derivatives.
+    /// The first guess spreads u and v linearly over the xz bounds of the surface, which is close on a uniform knot vector.
+    /// @return false if x and z are outside the surface, u and v are then on the edge closest to them
+    bool find_parameters(float x, float z, float& u, float& v) const
     {
-        if (spatial_grid_initialized)
-            return;
-
-        auto vertices = get_vertices_ptr();
-        auto grid_resolution = static_cast<int>(sqrt(vertices->size())) / 4; // Adjust divisor based on terrain size
-        spatial_grid_size = grid_resolution * grid_resolution;
-
-        // Find terrain bounds
-        terrain_min = glm::vec2(FLT_MAX);
-        terrain_max = glm::vec2(-FLT_MAX);
-
-        for (const auto& vertex : *vertices)
+        auto size = surface_max - surface_min;
+        if (size.x == 0.0f || size.y == 0.0f)
+            return false;
+        u = get_min_u() + (x - surface_min.x) / size.x * (get_max_u() - get_min_u());
+        v = get_min_v() + (z - surface_min.y) / size.y * (get_max_v() - get_min_v());
+        glm::vec2 residual(0.0f);
+        for (int iteration = 0; iteration < MAX_NEWTON_ITERATIONS; iteration++)
         {
-            terrain_min.x = std::min(terrain_min.x, vertex.position.x);
-            terrain_min.y = std::min(terrain_min.y, vertex.position.z);
-            terrain_max.x = std::max(terrain_max.x, vertex.position.x);
-            terrain_max.y = std::max(terrain_max.y, vertex.position.z);
+            u = std::clamp(u, get_min_u(), get_max_u());
+            v = std::clamp(v, get_min_v(), get_max_v());
+            glm::vec3 point, d_du, d_dv;
+            evaluate(u, v, point, d_du, d_dv);
+            residual = glm::vec2(x - point.x, z - point.z);
+            if (glm::dot(residual, residual) <= NEWTON_TOLERANCE * NEWTON_TOLERANCE)
+                return true;
+            auto determinant = d_du.x * d_dv.z - d_dv.x * d_du.z;
+            if (determinant == 0.0f)
+                return false;
+            u += (residual.x * d_dv.z - residual.y * d_dv.x) / determinant;
+            v += (residual.y * d_du.x - residual.x * d_du.z) / determinant;
         }
+        u = std::clamp(u, get_min_u(), get_max_u());
+        v = std::clamp(v, get_min_v(), get_max_v());
+        return glm::dot(residual, residual) <= NEWTON_TOLERANCE * NEWTON_TOLERANCE;
+    }
 
-        // Initialize spatial grid
-        cell_size = (terrain_max - terrain_min) / static_cast<float>(grid_resolution);
-        spatial_grid.resize(spatial_grid_size);
+    /// @brief Gets the height of the exact surface over a position and its normal, without the mesh.
+    /// Outside the surface the height is the lowest height of the control points and the normal is up.
+    std::tuple<float, glm::vec3> get_exact_y_at(const glm::vec3& position) const
+    {
+        float u, v;
+        if (!find_parameters(position.x, position.z, u, v))
+            return std::make_tuple(min_control_height, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::vec3 point, d_du, d_dv;
+        evaluate(u, v, point, d_du, d_dv);
+        auto normal = glm::normalize(glm::cross(d_dv, d_du));
+        return std::make_tuple(point.y, normal.y < 0.0f ? -normal : normal);
+    }
 
-        // Initialize cell bounds
-        for (int z = 0; z < grid_resolution; ++z)
-        {
-            for (int x = 0; x < grid_resolution; ++x)
-            {
-                int index = z * grid_resolution + x;
-                spatial_grid[index].min_bounds = terrain_min + glm::vec2(x, z) * cell_size;
-                spatial_grid[index].max_bounds = spatial_grid[index].min_bounds + cell_size;
-            }
-        }
+    /// @brief Gets the exact height and normal over every position, the spans must be the same size
+    void get_exact_y_at(std::span<const glm::vec3> positions, std::span<float> heights, std::span<glm::vec3> normals) const
+    {
+        for (size_t i = 0; i < positions.size(); i++)
+            std::tie(heights[i], normals[i]) = get_exact_y_at(positions[i]);
+    }
 
-        // Populate cells with vertex indices
-        for (size_t i = 0; i < vertices->size(); ++i)
+    /// @brief Tessellates the surface into a grid of vertices every spacing along u and v, the rows are spread over the global pool.
+    /// The knot span and basis of every row and column are found once. Each row blends the control points along u first,
+    /// so a vertex only blends three of those along v. Normals are gathered per vertex in a second pass and the indices
+    /// are written in a third, every pass fills buffers allocated up front.
+    void computeSurface(float spacing = 0.1f)
+    {
+        this->spacing = spacing;
+        int num_u, num_v;
+        get_grid_size(spacing, num_u, num_v);
+
+        std::vector<int> spans_u(num_u);
+        std::vector<int> spans_v(num_v);
+        std::vector<glm::vec3> basis_u(num_u);
+        std::vector<glm::vec3> basis_v(num_v);
+        glm::vec3 derivative;
+        for (int i = 0; i < num_u; i++)
         {
-            const auto& pos = vertices->at(i).position;
-            glm::vec2 pos2d(pos.x, pos.z);
-
-            // Get cell indices for vertex position
-            int cell_x = static_cast<int>((pos.x - terrain_min.x) / cell_size.x);
-            int cell_z = static_cast<int>((pos.z - terrain_min.y) / cell_size.y);
-
-            // Clamp to valid range
-            cell_x = std::clamp(cell_x, 0, grid_resolution - 1);
-            cell_z = std::clamp(cell_z, 0, grid_resolution - 1);
-
-            int cell_index = cell_z * grid_resolution + cell_x;
-            spatial_grid[cell_index].vertex_indices.push_back(static_cast<int>(i));
+            float u = get_min_u() + i * spacing;
+            spans_u[i] = find_span(u, degree_u, num_points_u, knot_vector_u);
+            quadratic_basis(u, spans_u[i], knot_vector_u, basis_u[i], derivative);
         }
-
-        spatial_grid_initialized = true;
-
-        // Initialize cache
-        for (auto& entry : position_cache)
+        for (int j = 0; j < num_v; j++)
         {
-            entry.valid = false;
+            float v = get_min_v() + j * spacing;
+            spans_v[j] = find_span(v, degree_v, num_points_v, knot_vector_v);
+            quadratic_basis(v, spans_v[j], knot_vector_v, basis_v[j], derivative);
         }
-    }
-
-    std::vector<int> get_nearby_vertices(const glm::vec2& pos) const
-    {
-        init_spatial_grid();
-
-        // Get cell containing the position
-        int cell_x = static_cast<int>((pos.x - terrain_min.x) / cell_size.x);
-        int cell_z = static_cast<int>((pos.y - terrain_min.y) / cell_size.y);
 
-        // Clamp to valid range
-        int grid_resolution = static_cast<int>(sqrt(spatial_grid_size));
-        cell_x = std::clamp(cell_x, 0, grid_resolution - 1);
-        cell_z = std::clamp(cell_z, 0, grid_resolution - 1);
-
-        std::vector<int> nearby_vertices;
-
-        // Check neighboring cells
-        for (int dz = -1; dz <= 1; ++dz)
-        {
-            for (int dx = -1; dx <= 1; ++dx)
+        std::vector<Vertex> vertices(size_t(num_u) * num_v, Vertex{ glm::vec3(0), glm::vec3(0, 1, 0), glm::vec2(0, 0) });
+        run_rows(num_u, "Processing BSplineSurface vertexes", [&](int begin, int end)
             {
-                int check_x = cell_x + dx;
-                int check_z = cell_z + dz;
+                std::vector<glm::vec3> blended(num_points_v);
+                for (int i = begin; i < end; i++)
+                {
+                    auto du = spans_u[i] - degree_u;
+                    auto bu = basis_u[i];
+                    for (int c = 0; c < num_points_v; c++)
+                    {
+                        auto control = &points[du + c * num_points_u];
+                        blended[c] = bu.x * control[0] + bu.y * control[1] + bu.z * control[2];
+                    }
+                    for (int j = 0; j < num_v; j++)
+                    {
+                        auto dv = spans_v[j] - degree_v;
+                        auto bv = basis_v[j];
+                        vertices[size_t(i) * num_v + j].position = bv.x * blended[dv] + bv.y * blended[dv + 1] + bv.z * blended[dv + 2];
+                    }
+                }
+            });
 
-                if (check_x < 0 || check_x >= grid_resolution ||
-                    check_z < 0 || check_z >= grid_resolution)
+        // Quad (i, j) is split into the triangles (p0, p1, p2) and (p0, p2, p3), with p0 = (i, j), p1 = (i, j + 1),
+        // p2 = (i + 1, j + 1) and p3 = (i + 1, j). A vertex sums the normals of the up to six triangles around it.
+        auto position = [&vertices, num_v](int i, int j) { return vertices[size_t(i) * num_v + j].position; };
+        auto first_normal = [&position](int i, int j)
+            {
+                auto p0 = position(i, j);
+                return glm::normalize(glm::cross(position(i, j + 1) - p0, position(i + 1, j + 1) - p0));
+            };
+        auto second_normal = [&position](int i, int j)
+            {
+                auto p0 = position(i, j);
+                return glm::normalize(glm::cross(position(i + 1, j + 1) - p0, position(i + 1, j) - p0));
+            };
+        run_rows(num_u, "Processing BSplineSurface normals", [&](int begin, int end)
+            {
+                for (int i = begin; i < end; i++)
                 {
-                    continue;
+                    for (int j = 0; j < num_v; j++)
+                    {
+                        glm::vec3 normal(0);
+                        if (i < num_u - 1 && j < num_v - 1)
+                            normal += first_normal(i, j) + second_normal(i, j);
+                        if (i < num_u - 1 && j > 0)
+                            normal += first_normal(i, j - 1);
+                        if (i > 0 && j > 0)
+                            normal += first_normal(i - 1, j - 1) + second_normal(i - 1, j - 1);
+                        if (i > 0 && j < num_v - 1)
+                            normal += second_normal(i - 1, j);
+                        if (glm::dot(normal, normal) > 0.0f)
+                            vertices[size_t(i) * num_v + j].normal = glm::normalize(normal);
+                    }
                 }
+            });
 
-                int cell_index = check_z * grid_resolution + check_x;
-                nearby_vertices.insert(nearby_vertices.end(),
-                    spatial_grid[cell_index].vertex_indices.begin(),
-                    spatial_grid[cell_index].vertex_indices.end());
-            }
-        }
+        std::vector<unsigned> indices(size_t(std::max(num_u - 1, 0)) * std::max(num_v - 1, 0) * 6);
+        run_rows(num_u - 1, "Processing BSplineSurface indices", [&](int begin, int end)
+            {
+                for (int i = begin; i < end; i++)
+                {
+                    for (int j = 0; j < num_v - 1; j++)
+                    {
+                        unsigned p0 = i * num_v + j;
+                        unsigned p1 = i * num_v + j + 1;
+                        unsigned p2 = (i + 1) * num_v + j + 1;
+                        unsigned p3 = (i + 1) * num_v + j;
+                        auto quad = &indices[(size_t(i) * (num_v - 1) + j) * 6];
+                        quad[0] = p0;
+                        quad[1] = p1;
+                        quad[2] = p2;
+                        quad[3] = p0;
+                        quad[4] = p2;
+                        quad[5] = p3;
+                    }
+                }
+            });
 
-        return nearby_vertices;
+        heightfield.build(vertices, num_u, num_v);
+        update_vertices(std::move(vertices));
+        update_indices(std::move(indices));
     }
 
-public:
+    const Heightfield& get_heightfield() const { return heightfield; }
+
+    /// @brief Gets the height of the mesh under a position and the vertex normals blended across the triangle there.
+    /// Outside the surface the height is the lowest height of the mesh and the normal is up.
     std::tuple<float, glm::vec3> get_y_at(const glm::vec3& position) const
     {
-        const glm::vec2 pos_2d(position.x, position.z);
-
-        // Check cache first
-        const float cache_threshold_sq = 0.01f; // Smaller threshold for more precise cache hits
-        for (const auto& cache_entry : position_cache)
-        {
-            if (cache_entry.valid &&
-                glm::distance2(position, cache_entry.position) < cache_threshold_sq)
-            {
-                return std::make_tuple(cache_entry.y, cache_entry.normal);
-            }
-        }
-
-        // Get nearby vertices using spatial grid
-        const auto nearby_vertices = get_nearby_vertices(pos_2d);
-
-        // Find closest vertex among nearby vertices
-        auto vertices = get_vertices_ptr();
-        float min_dist = FLT_MAX;
-        int closest_idx = -1;
-
-        for (int idx : nearby_vertices)
-        {
-            const auto& vertex = vertices->at(idx).position;
-            float dist = glm::distance2(glm::vec2(vertex.x, vertex.z), pos_2d);
-            if (dist < min_dist)
-            {
-                min_dist = dist;
-                closest_idx = idx;
-            }
-        }
-
-        if (closest_idx == -1)
-        {
-            // Fallback if no nearby vertices found
-            auto min_bounds = get_min_vertex().position;
-            return std::make_tuple(min_bounds.y, glm::vec3(0.0f, 1.0f, 0.0f));
-        }
-
-        // Find quad containing the point
-        if (auto result = find_containing_quad(closest_idx, pos_2d))
-        {
-            // Update cache
-            position_cache[cache_index] = {
-                position,
-                closest_idx,
-                std::get<0>(*result),
-                std::get<1>(*result),
-                true };
-            cache_index = (cache_index + 1) % CACHE_SIZE;
-
-            return *result;
-        }
+        float height;
+        glm::vec3 normal;
+        heightfield.get_height(position.x, position.z, height, normal);
+        return std::make_tuple(height, normal);
+    }
 
-        // Fallback
-        auto min_bounds = get_min_vertex().position;
-        return std::make_tuple(min_bounds.y, glm::vec3(0.0f, 1.0f, 0.0f));
+    /// @brief Gets the height and normal under every position, the spans must be the same size
+    void get_y_at(std::span<const glm::vec3> positions, std::span<float> heights, std::span<glm::vec3> normals) const
+    {
+        heightfield.get_heights(positions, heights, normals);
     }
 
-private:
-    std::optional<std::tuple<float, glm::vec3>> find_containing_quad(int vertex_idx,
-        const glm::vec2& pos_2d) const
+    /// @brief Finds where a sphere moving in a straight line first touches the triangle mesh of the surface, or the exact surface
+    /// when it was built without a mesh
+    /// @param time Set to the fraction of the way from start to end at the first touch
+    /// @param normal Set to the direction from the touched point of the mesh to the center of the sphere
+    /// @return true if the sphere touches the mesh on the way
+    bool sweep_sphere(const glm::vec3& start, const glm::vec3& end, float radius, float& time, glm::vec3& normal) const
     {
-        auto vertices = get_vertices_ptr();
-        const int grid_size = static_cast<int>(sqrt(vertices->size()));
-
-        // Get vertex position in grid
-        int vertex_z = vertex_idx / grid_size;
-        int vertex_x = vertex_idx % grid_size;
-
-        // Check all potential quads this vertex could be part of
-        static const std::array<std::array<std::pair<int, int>, 4>, 4> quad_offsets = { {
-            {{{0, 0}, {-1, 0}, {0, -1}, {-1, -1}}}, // Upper-left
-            {{{0, 0}, {1, 0}, {0, -1}, {1, -1}}},   // Upper-right
-            {{{0, 0}, {-1, 0}, {0, 1}, {-1, 1}}},   // Lower-left
-            {{{0, 0}, {1, 0}, {0, 1}, {1, 1}}}      // Lower-right
-        } };
-
-        for (const auto& quad : quad_offsets)
+        if (heightfield.empty())
+            return sweep_sphere_exact(start, end, radius, time, normal);
+        auto sweep_min = glm::min(start, end) - radius;
+        auto sweep_max = glm::max(start, end) + radius;
+        unsigned min_i, min_j, max_i, max_j;
+        if (!heightfield.get_cell_range(sweep_min.x, sweep_min.z, sweep_max.x, sweep_max.z, min_i, min_j, max_i, max_j))
+            return false;
+
+        auto motion = end - start;
+        time = 2.0f;
+        for (unsigned i = min_i; i <= max_i; ++i)
         {
-            if (auto result = check_quad(vertex_x, vertex_z, grid_size, quad, pos_2d))
+            for (unsigned j = min_j; j <= max_j; ++j)
             {
-                return result;
+                // Same triangles as computeSurface
+                auto p0 = heightfield.get_point(i, j);
+                auto p1 = heightfield.get_point(i, j + 1);
+                auto p2 = heightfield.get_point(i + 1, j + 1);
+                auto p3 = heightfield.get_point(i + 1, j);
+                auto quad_min = glm::min(glm::min(p0, p1), glm::min(p2, p3));
+                auto quad_max = glm::max(glm::max(p0, p1), glm::max(p2, p3));
+                if (glm::any(glm::greaterThan(quad_min, sweep_max)) || glm::any(glm::lessThan(quad_max, sweep_min)))
+                    continue;
+
+                glm::vec3 hit_normal;
+                auto t = Sweep::sphere_triangle(start, motion, radius, p0, p1, p2, hit_normal);
+                if (t >= 0.0f && t < time)
+                {
+                    time = t;
+                    normal = hit_normal;
+                }
+                t = Sweep::sphere_triangle(start, motion, radius, p0, p2, p3, hit_normal);
+                if (t >= 0.0f && t < time)
+                {
+                    time = t;
+                    normal = hit_normal;
+                }
             }
         }
-
-        return std::nullopt;
+        return time <= 1.0f;
     }
 
-    std::optional<std::tuple<float, glm::vec3>> check_quad(int base_x, int base_z, int grid_size,
-        const std::array<std::pair<int, int>, 4>& offsets,
-        const glm::vec2& pos_2d) const
+    /// @brief Finds where a sphere moving in a straight line first comes within its radius of the exact surface.
+    /// The distance is measured to the tangent plane under the center, sampled at most EXACT_SWEEP_STEP radii apart
+    /// along the path, and the first step that reaches the surface is bisected. Like the mesh sweep, a sphere that
+    /// already touches the surface at the start or moves outside it reports no impact.
+    /// @param time Set to the fraction of the way from start to end just before the first touch
+    /// @param normal Set to the surface normal under the sphere at the touch
+    bool sweep_sphere_exact(const glm::vec3& start, const glm::vec3& end, float radius, float& time, glm::vec3& normal) const
     {
-        auto vertices = get_vertices_ptr();
+        // The surface stays inside the convex hull of its control points
+        if (std::min(start.y, end.y) - radius > max_control_height)
+            return false;
 
-        // Verify all vertices exist
-        for (const auto& [dx, dz] : offsets)
+        // Distance from the sphere to the tangent plane under its center at t, FLT_MAX outside the surface
+        auto clearance = [&](float t, glm::vec3& surface_normal)
+            {
+                auto center = glm::mix(start, end, t);
+                float u, v;
+                if (!find_parameters(center.x, center.z, u, v))
+                    return FLT_MAX;
+                glm::vec3 point, d_du, d_dv;
+                evaluate(u, v, point, d_du, d_dv);
+                surface_normal = glm::normalize(glm::cross(d_dv, d_du));
+                if (surface_normal.y < 0.0f)
+                    surface_normal = -surface_normal;
+                return glm::dot(center - point, surface_normal) - radius;
+            };
+
+        glm::vec3 sample_normal;
+        if (clearance(0.0f, sample_normal) <= 0.0f)
+            return false;
+        auto length = glm::length(end - start);
+        int samples = std::clamp(static_cast<int>(std::ceil(length / (EXACT_SWEEP_STEP * radius))), 1, EXACT_SWEEP_MAX_SAMPLES);
+        float before = 0.0f;
+        for (int k = 1; k <= samples; k++)
         {
-            int x = base_x + dx;
-            int z = base_z + dz;
-            if (x < 0 || x >= grid_size || z < 0 || z >= grid_size)
+            float after = float(k) / samples;
+            if (clearance(after, sample_normal) > 0.0f)
             {
-                return std::nullopt;
+                before = after;
+                continue;
             }
+            normal = sample_normal;
+            for (int bisection = 0; bisection < EXACT_SWEEP_BISECTIONS; bisection++)
+            {
+                float middle = 0.5f * (before + after);
+                if (clearance(middle, sample_normal) > 0.0f)
+                {
+                    before = middle;
+                }
+                else
+                {
+                    after = middle;
+                    normal = sample_normal;
+                }
+            }
+            time = before;
+            return true;
         }
-
-        // Get vertex positions
-        std::array<Vertex, 4> quad_vertices;
-        for (int i = 0; i < 4; ++i)
-        {
-            int x = base_x + offsets[i].first;
-            int z = base_z + offsets[i].second;
-            quad_vertices[i] = vertices->at(z * grid_size + x);
-        }
-
-        // Quick AABB test
-        glm::vec2 min_bounds(FLT_MAX), max_bounds(-FLT_MAX);
-        for (const auto& vertex : quad_vertices)
-        {
-            min_bounds.x = std::min(min_bounds.x, vertex.position.x);
-            min_bounds.y = std::min(min_bounds.y, vertex.position.z);
-            max_bounds.x = std::max(max_bounds.x, vertex.position.x);
-            max_bounds.y = std::max(max_bounds.y, vertex.position.z);
-        }
-
-        if (pos_2d.x < min_bounds.x || pos_2d.x > max_bounds.x ||
-            pos_2d.y < min_bounds.y || pos_2d.y > max_bounds.y)
-        {
-            return std::nullopt;
-        }
-
-        // Convert to 2D for triangle tests
-        const glm::vec2 points[4] = {
-            glm::vec2(quad_vertices[0].position.x, quad_vertices[0].position.z),
-            glm::vec2(quad_vertices[1].position.x, quad_vertices[1].position.z),
-            glm::vec2(quad_vertices[2].position.x, quad_vertices[2].position.z),
-            glm::vec2(quad_vertices[3].position.x, quad_vertices[3].position.z) };
-
-        // Check both triangles
-        bool in_lower = point_in_triangle(pos_2d, points[0], points[1], points[3]);
-        bool in_upper = !in_lower && point_in_triangle(pos_2d, points[0], points[3], points[2]);
-
-        if (!in_lower && !in_upper)
-        {
-            return std::nullopt;
-        }
-
-        // Calculate height and normal
-        float y;
-        glm::vec3 normal;
-
-        if (in_lower)
-        {
-            auto barycentric = calculate_barycentric(pos_2d, points[0], points[1], points[3]);
-            y = quad_vertices[0].position.y * barycentric.x +
-                quad_vertices[1].position.y * barycentric.y +
-                quad_vertices[3].position.y * barycentric.z;
-            normal = quad_vertices[0].normal * barycentric.x +
-                quad_vertices[1].normal * barycentric.y +
-                quad_vertices[3].normal * barycentric.z;
-        }
-        else
-        {
-            auto barycentric = calculate_barycentric(pos_2d, points[0], points[3], points[2]);
-            y = quad_vertices[0].position.y * barycentric.x +
-                quad_vertices[1].position.y * barycentric.y +
-                quad_vertices[3].position.y * barycentric.z;
-            normal = quad_vertices[0].normal * barycentric.x +
-                quad_vertices[1].normal * barycentric.y +
-                quad_vertices[3].normal * barycentric.z;
-        }
-
-        return std::make_tuple(y, normal);
-    }
-
-    // Edge function for point-in-triangle test
-    float edge_function(const glm::vec2& a, const glm::vec2& b, const glm::vec2& p) const
-    {
-        return (p.x - a.x) * (b.y - a.y) - (p.y - a.y) * (b.x - a.x);
-    }
-
-    bool point_in_triangle(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b,
-        const glm::vec2& c) const
-    {
-        float edge1 = edge_function(a, b, p);
-        float edge2 = edge_function(b, c, p);
-        float edge3 = edge_function(c, a, p);
-
-        // Check if point is on the same side of all edges
-        return (edge1 >= 0 && edge2 >= 0 && edge3 >= 0) ||
-            (edge1 <= 0 && edge2 <= 0 && edge3 <= 0);
-    }
-
-    // Barycentric and normal calculation functions remain the same
-    glm::vec3 calculate_barycentric(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b,
-        const glm::vec2& c) const
-    {
-        glm::vec2 v0 = b - a;
-        glm::vec2 v1 = c - a;
-        glm::vec2 v2 = p - a;
-
-        float d00 = glm::dot(v0, v0);
-        float d01 = glm::dot(v0, v1);
-        float d11 = glm::dot(v1, v1);
-        float d20 = glm::dot(v2, v0);
-        float d21 = glm::dot(v2, v1);
-
-        float denom = 1.0f / (d00 * d11 - d01 * d01);
-        float v = (d11 * d20 - d01 * d21) * denom;
-        float w = (d00 * d21 - d01 * d20) * denom;
-        float u = 1.0f - v - w;
-
-        return glm::vec3(u, v, w);
+        return false;
     }
 };
\ No newline at end of file
@@ -12,7 +12,8 @@ private:
 public:
     IcoSphere() : GameObject()
     {
-        set_collider(new SphereCollider(this));
+        // The mesh is a unit sphere, the collider scales with the transform
+        set_collider(new SphereCollider(this, 1.0f));
     };
     ~IcoSphere() {};
     void create(int subdivisions)
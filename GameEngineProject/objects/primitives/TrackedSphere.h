@@ -11,6 +11,7 @@ private:
 	BSpline<glm::vec3>* track;
 	float time = 0;
 	float trackTime = 0.1f;
+	bool started = false;
 
 public:
 	TrackedSphere() : IcoSphere()
@@ -21,16 +22,17 @@ public:
 		create(3);
 	}
 
+	// Runs on the simulation thread, the track is drawn by the render thread so its points are added there
 	virtual void update(float delta_time) override
 	{
-		if (!track->has_points())
-			track->add_point(get_component<TransformComponent>()->position);
 		time += delta_time;
-		if (time > trackTime)
-		{
-			time = 0;
-			track->add_point(get_component<TransformComponent>()->position);
-		}
+		if (started && time <= trackTime)
+			return;
+		started = true;
+		time = 0;
+		auto position = get_component<TransformComponent>()->position;
+		auto track = this->track;
+		get_world()->post_to_render([track, position]() { track->add_point(position); });
 	}
 
 	GameObject* get_track()
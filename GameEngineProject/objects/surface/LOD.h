@@ -2,45 +2,68 @@
 
 #include "../base/GameObject.h"
 
+/// @brief One tessellation of an LOD object
+struct LODLevel
+{
+    std::vector<Vertex> vertices;
+    std::vector<unsigned> indices;
+    // The level is drawn once the camera is at least this far from the bounds, until the next level takes over
+    float min_distance;
+};
+
+/// @brief Object with several tessellations, the one drawn is picked by the distance from the camera to its bounds.
+/// The levels go from the finest to the coarsest and their min_distance never decreases.
 class LOD : public GameObject
 {
 private:
-    LOD* parent;
-    LOD* child;
-    glm::vec3 lod_resolution;
-    bool is_visible = false;
+    std::vector<LODLevel> levels;
+    AABB bounds;
+    // Picked by the render thread before every draw
+    size_t current = 0;
 
 public:
-    LOD(std::vector<Vertex> vertices, std::vector<unsigned> indices) : GameObject(vertices, indices) {}
-    ~LOD()
+    LOD(std::vector<LODLevel> levels, const AABB& bounds, World* world = nullptr) : GameObject({}, {}, world), levels(std::move(levels)), bounds(bounds) {}
+
+    size_t get_level_count() const { return levels.size(); }
+    const LODLevel& get_level(size_t level) const { return levels[level]; }
+    size_t get_current_level() const { return current; }
+
+    /// @brief Gets the memory the vertices and indices of every level take
+    size_t get_memory() const
+    {
+        size_t memory = 0;
+        for (auto& level : levels)
+            memory += level.vertices.size() * sizeof(Vertex) + level.indices.size() * sizeof(unsigned);
+        return memory;
+    }
+
+    /// @brief Gets the level drawn from a distance to the bounds
+    size_t get_level_at(float distance) const
+    {
+        size_t level = 0;
+        while (level + 1 < levels.size() && levels[level + 1].min_distance <= distance)
+            level++;
+        return level;
+    }
+
+    bool get_render_bounds(AABB& bounds) override
     {
-        if (child != nullptr)
-            delete child;
+        bounds = this->bounds;
+        return true;
     }
 
-    void set_parent(LOD* parent) { this->parent = parent; }
-    void set_child(LOD* child) { this->child = child; }
-    void set_lod_resolution(glm::vec3 lod_resolution) { this->lod_resolution = lod_resolution; }
-    void set_visible(bool is_visible) { this->is_visible = is_visible; }
-    glm::vec3 get_lod_resolution() { return lod_resolution; }
-    bool get_visible() { return is_visible; }
-    LOD* get_parent() { return parent; }
-    LOD* get_child() { return child; }
-    LOD* get_current(glm::vec3 pos)
+    void set_view_position(const glm::vec3& eye) override
     {
-        auto cur = this;
-        if (child == nullptr)
-            return this;
-        while (cur->child != nullptr)
-        {
-            if (glm::abs(pos - cur->get_position()) < lod_resolution)
-                cur = cur->child;
-            else
-                break;
-        }
-        return cur;
+        current = get_level_at(glm::distance(eye, glm::clamp(eye, bounds.min, bounds.max)));
     }
-    void draw(const Camera& camera) const override
+
+    bool should_render() const override { return get_visible() && !levels.empty(); }
+
+    void render() const override
     {
+        auto& level = levels[current];
+        glBufferData(GL_ARRAY_BUFFER, level.vertices.size() * sizeof(Vertex), level.vertices.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, level.indices.size() * sizeof(unsigned), level.indices.data(), GL_STATIC_DRAW);
+        glDrawElements(get_mode(), level.indices.size(), GL_UNSIGNED_INT, 0);
     }
 };
\ No newline at end of file
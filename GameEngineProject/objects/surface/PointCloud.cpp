@@ -1,13 +1,13 @@
 #include "PointCloud.h"
 #include "../curves/BSplineSurface.h"
 #include "../curves/BSpline.h"
-#include "../../Window.h"
+#include "../../Progress.h"
 #include <algorithm>
+#include <map>
 #include <ranges>
 #include <numeric>
-#include <format>
 
-GameObject* PointCloud::convert_to_surface()
+GameObject* PointCloud::convert_to_surface(bool tessellate)
 {
     std::vector<glm::vec3> points = {};
     std::map<float, std::vector<glm::vec3>> point_map = {};
@@ -84,12 +84,11 @@ GameObject* PointCloud::convert_to_surface()
             points.push_back(glm::vec3(prev_x + x_step / 2, y_avg, actual_map_index));
             prev_x += x_step;
         }
-        glfwSetWindowTitle(Window::glfWindow, std::format("Processing point cloud to surface: {:.2f}%", 
-            (float)(i * size) / (size * size) * 100).c_str());
+        Progress::report("Processing point cloud to surface", (float)(i * size) / (size * size) * 100);
     }
-    glfwSetWindowTitle(Window::glfWindow, "Generating knot vector for surface");
+    Progress::report("Generating knot vector for surface");
     std::vector<float> knot_vector = BSpline<glm::vec3>::get_knot_vector(size - 1);
-    glfwSetWindowTitle(Window::glfWindow, "Creating surface from point cloud");
-    auto surface = new BSplineSurface(2, 2, size, size, knot_vector, knot_vector, points, 0.5);
+    Progress::report("Creating surface from point cloud");
+    auto surface = new BSplineSurface(2, 2, size, size, knot_vector, knot_vector, points, 0.5, tessellate);
     return surface;
 }
\ No newline at end of file
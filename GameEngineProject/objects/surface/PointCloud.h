@@ -108,5 +108,7 @@ public:
     ~PointCloud() {}
     int get_points_x() { return points_x; }
     int get_points_z() { return points_z; }
-    GameObject* convert_to_surface();
+    /// @brief Fits a BSplineSurface to the points
+    /// @param tessellate Whether the surface builds its mesh, a surface without one is drawn in tiles and collides with the exact surface
+    GameObject* convert_to_surface(bool tessellate = true);
 };
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "SurfaceTiles.h"
+#include "../curves/BSplineSurface.h"
+#include "../../Progress.h"
+#include "../../threading/ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+
+// Local indices of the rows or columns a level keeps out of count, every step-th one and the last one
+static std::vector<int> get_samples(int count, int step)
+{
+    std::vector<int> samples;
+    for (int i = 0; i < count - 1; i += step)
+        samples.push_back(i);
+    samples.push_back(count - 1);
+    return samples;
+}
+
+// Heights along an edge when only the samples are kept, the edge is straight between two samples
+static std::vector<float> interpolate_edge(const std::vector<float>& heights, const std::vector<int>& samples)
+{
+    std::vector<float> interpolated(heights.size());
+    for (size_t s = 0; s + 1 < samples.size(); s++)
+    {
+        auto first = samples[s];
+        auto last = samples[s + 1];
+        for (int i = first; i <= last; i++)
+        {
+            auto t = float(i - first) / (last - first);
+            interpolated[i] = heights[first] + t * (heights[last] - heights[first]);
+        }
+    }
+    return interpolated;
+}
+
+SurfaceTiles::SurfaceTiles(const BSplineSurface* surface, float spacing) : surface(surface), spacing(spacing > 0.0f ? spacing : surface->get_spacing())
+{
+    surface->get_grid_size(this->spacing, rows, columns);
+    tile_rows = (std::max(rows - 1, 0) + TILE_SIZE - 1) / TILE_SIZE;
+    tile_columns = (std::max(columns - 1, 0) + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+void SurfaceTiles::get_tile_range(int tile_i, int tile_j, int& first_i, int& first_j, int& count_i, int& count_j) const
+{
+    first_i = tile_i * TILE_SIZE;
+    first_j = tile_j * TILE_SIZE;
+    count_i = std::min(TILE_SIZE, rows - 1 - first_i) + 1;
+    count_j = std::min(TILE_SIZE, columns - 1 - first_j) + 1;
+}
+
+void SurfaceTiles::get_tile_bounds(int tile_i, int tile_j, glm::vec3& min, glm::vec3& max) const
+{
+    int first_i, first_j, count_i, count_j;
+    get_tile_range(tile_i, tile_j, first_i, first_j, count_i, count_j);
+    auto min_u = surface->get_min_u() + first_i * spacing;
+    auto min_v = surface->get_min_v() + first_j * spacing;
+    surface->get_control_bounds(min_u, min_u + (count_i - 1) * spacing, min_v, min_v + (count_j - 1) * spacing, min, max);
+}
+
+size_t SurfaceTiles::get_max_tile_memory()
+{
+    size_t memory = 0;
+    for (int level = 0; level < LEVEL_COUNT; level++)
+    {
+        size_t count = (TILE_SIZE >> level) + 1;
+        // The grid and a skirt vertex under every edge vertex, two triangles per quad and four per skirt segment
+        memory += (count * count + 4 * count) * sizeof(Vertex);
+        memory += ((count - 1) * (count - 1) * 6 + 4 * (count - 1) * 12) * sizeof(unsigned);
+    }
+    return memory;
+}
+
+LOD* SurfaceTiles::create_tile(int tile_i, int tile_j) const
+{
+    int first_i, first_j, count_i, count_j;
+    get_tile_range(tile_i, tile_j, first_i, first_j, count_i, count_j);
+
+    // The finest level, the vertices of every other level are a subset of it
+    std::vector<Vertex> grid(size_t(count_i) * count_j);
+    glm::vec3 min(FLT_MAX);
+    glm::vec3 max(-FLT_MAX);
+    for (int i = 0; i < count_i; i++)
+    {
+        for (int j = 0; j < count_j; j++)
+        {
+            glm::vec3 point, d_du, d_dv;
+            surface->evaluate(surface->get_min_u() + (first_i + i) * spacing, surface->get_min_v() + (first_j + j) * spacing, point, d_du, d_dv);
+            auto normal = glm::cross(d_dv, d_du);
+            normal = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0, 1, 0);
+            grid[size_t(i) * count_j + j] = Vertex{ point, normal.y < 0.0f ? -normal : normal, glm::vec2(0, 0) };
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+    }
+    auto height = [&grid, count_j](int i, int j) { return grid[size_t(i) * count_j + j].position.y; };
+
+    std::vector<std::vector<int>> samples_i;
+    std::vector<std::vector<int>> samples_j;
+    for (int level = 0; level < LEVEL_COUNT; level++)
+    {
+        // A level of a single quad has nothing left to drop
+        if (level > 0 && samples_i.back().size() == 2 && samples_j.back().size() == 2)
+            break;
+        samples_i.push_back(get_samples(count_i, 1 << level));
+        samples_j.push_back(get_samples(count_j, 1 << level));
+    }
+    auto level_count = samples_i.size();
+
+    // Edges 0 and 1 are the first and last row, 2 and 3 the first and last column. A neighbour shares the edge,
+    // so the gap between the two is at most how far this level's edge is from the edge at any other level.
+    std::vector<std::array<float, 4>> skirt_depths(level_count);
+    float max_skirt_depth = 0.0f;
+    for (int edge = 0; edge < 4; edge++)
+    {
+        std::vector<float> heights;
+        glm::vec3 first, last;
+        if (edge < 2)
+        {
+            auto i = edge == 0 ? 0 : count_i - 1;
+            for (int j = 0; j < count_j; j++)
+                heights.push_back(height(i, j));
+            first = grid[size_t(i) * count_j].position;
+            last = grid[size_t(i) * count_j + count_j - 1].position;
+        }
+        else
+        {
+            auto j = edge == 2 ? 0 : count_j - 1;
+            for (int i = 0; i < count_i; i++)
+                heights.push_back(height(i, j));
+            first = grid[j].position;
+            last = grid[size_t(count_i - 1) * count_j + j].position;
+        }
+        auto& samples = edge < 2 ? samples_j : samples_i;
+        std::vector<std::vector<float>> edges(level_count);
+        for (size_t level = 0; level < level_count; level++)
+            edges[level] = interpolate_edge(heights, samples[level]);
+
+        auto cell_size = glm::distance(first, last) / (heights.size() - 1);
+        for (size_t level = 0; level < level_count; level++)
+        {
+            float gap = 0.0f;
+            for (size_t other = 0; other < level_count; other++)
+            {
+                for (size_t k = 0; k < heights.size(); k++)
+                    gap = std::max(gap, std::abs(edges[level][k] - edges[other][k]));
+            }
+            skirt_depths[level][edge] = gap + SKIRT_MARGIN * cell_size;
+            max_skirt_depth = std::max(max_skirt_depth, skirt_depths[level][edge]);
+        }
+    }
+    min.y -= max_skirt_depth;
+
+    std::vector<LODLevel> levels(level_count);
+    for (size_t level = 0; level < level_count; level++)
+    {
+        auto& si = samples_i[level];
+        auto& sj = samples_j[level];
+        int ni = si.size();
+        int nj = sj.size();
+        auto& vertices = levels[level].vertices;
+        auto& indices = levels[level].indices;
+        vertices.reserve(size_t(ni) * nj + 2 * (ni + nj));
+        indices.reserve(size_t(ni - 1) * (nj - 1) * 6 + 24 * (ni - 1 + nj - 1));
+        for (auto i : si)
+        {
+            for (auto j : sj)
+                vertices.push_back(grid[size_t(i) * count_j + j]);
+        }
+
+        // Same triangles as BSplineSurface::computeSurface, the error is measured at the fine vertices inside each quad
+        float error = 0.0f;
+        for (int a = 0; a < ni - 1; a++)
+        {
+            for (int b = 0; b < nj - 1; b++)
+            {
+                unsigned p0 = a * nj + b;
+                unsigned p1 = a * nj + b + 1;
+                unsigned p2 = (a + 1) * nj + b + 1;
+                unsigned p3 = (a + 1) * nj + b;
+                indices.insert(indices.end(), { p0, p1, p2, p0, p2, p3 });
+
+                auto i0 = si[a], i1 = si[a + 1], j0 = sj[b], j1 = sj[b + 1];
+                auto h0 = height(i0, j0), h1 = height(i0, j1), h2 = height(i1, j1), h3 = height(i1, j0);
+                for (int i = i0; i <= i1; i++)
+                {
+                    for (int j = j0; j <= j1; j++)
+                    {
+                        auto s = float(i - i0) / (i1 - i0);
+                        auto t = float(j - j0) / (j1 - j0);
+                        auto approximation = t >= s ? h0 + t * (h1 - h0) + s * (h2 - h1) : h0 + s * (h3 - h0) + t * (h2 - h3);
+                        error = std::max(error, std::abs(height(i, j) - approximation));
+                    }
+                }
+            }
+        }
+        levels[level].min_distance = level == 0 ? 0.0f : std::max(levels[level - 1].min_distance, error / MAX_ERROR_PER_DISTANCE);
+
+        for (int edge = 0; edge < 4; edge++)
+        {
+            auto count = edge < 2 ? nj : ni;
+            auto top = [&](int k) -> unsigned
+                {
+                    switch (edge)
+                    {
+                    case 0: return k;
+                    case 1: return (ni - 1) * nj + k;
+                    case 2: return k * nj;
+                    default: return k * nj + nj - 1;
+                    }
+                };
+            unsigned bottom = vertices.size();
+            for (int k = 0; k < count; k++)
+            {
+                auto vertex = vertices[top(k)];
+                vertex.position.y -= skirt_depths[level][edge];
+                vertices.push_back(vertex);
+            }
+            // Both windings, the skirt has to hide the gap from either side with face culling on
+            for (int k = 0; k < count - 1; k++)
+            {
+                unsigned t0 = top(k), t1 = top(k + 1), b0 = bottom + k, b1 = bottom + k + 1;
+                indices.insert(indices.end(), { t0, t1, b1, t0, b1, b0, t0, b1, t1, t0, b0, b1 });
+            }
+        }
+    }
+    return new LOD(std::move(levels), AABB((min + max) * 0.5f, (max - min) * 0.5f));
+}
+
+std::vector<LOD*> SurfaceTiles::create_tiles() const
+{
+    std::vector<LOD*> tiles(get_tile_count());
+    auto& pool = ThreadPool::get_global();
+    // A block of tiles at a time so progress is reported from the calling thread between blocks
+    for (int block = 0; block < get_tile_count(); block += TILES_PER_PROGRESS_REPORT)
+    {
+        auto block_end = std::min(block + TILES_PER_PROGRESS_REPORT, get_tile_count());
+        pool.parallel_for(block, block_end, 1, [&](int begin, int end)
+            {
+                for (int tile = begin; tile < end; tile++)
+                    tiles[tile] = create_tile(tile / tile_columns, tile % tile_columns);
+            });
+        Progress::report("Building terrain tiles", float(block_end) / get_tile_count() * 100);
+    }
+    return tiles;
+}
\ No newline at end of file
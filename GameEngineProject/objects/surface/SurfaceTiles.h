@@ -0,0 +1,53 @@
+#pragma once
+
+#include "LOD.h"
+
+class BSplineSurface;
+
+/// @brief Splits the mesh of a BSplineSurface into square tiles of TILE_SIZE quads, each tile is an LOD object.
+/// Level k of a tile keeps every 2^k-th row and column of the mesh, the last row and column of the tile are always kept
+/// so two tiles sample their shared edge the same way at the same level. Every level hangs a skirt below the edges
+/// of the tile, as deep as its edge can be from the same edge at any other level, which hides the cracks between
+/// tiles drawn at different levels. A tile only needs its own rows and columns of the surface to be built.
+class SurfaceTiles
+{
+public:
+    static constexpr int TILE_SIZE = 64;
+    static constexpr int LEVEL_COUNT = 4;
+    /// @brief The height error of a level, relative to the finest one, allowed per unit of distance from the camera
+    static constexpr float MAX_ERROR_PER_DISTANCE = 0.002f;
+
+private:
+    // How far the skirts reach past the largest gap, in cells of the mesh, covers seams at T-junctions
+    static constexpr float SKIRT_MARGIN = 0.5f;
+    static constexpr int TILES_PER_PROGRESS_REPORT = 16;
+
+    const BSplineSurface* surface;
+    float spacing;
+    int rows;
+    int columns;
+    int tile_rows;
+    int tile_columns;
+
+    /// @brief Gets the first row and column of the mesh in a tile and how many of each it has, shared edges included
+    void get_tile_range(int tile_i, int tile_j, int& first_i, int& first_j, int& count_i, int& count_j) const;
+
+public:
+    /// @param spacing The parameter step of the finest level, 0 uses the spacing of the mesh of the surface
+    SurfaceTiles(const BSplineSurface* surface, float spacing = 0.0f);
+
+    int get_tile_rows() const { return tile_rows; }
+    int get_tile_columns() const { return tile_columns; }
+    int get_tile_count() const { return tile_rows * tile_columns; }
+
+    /// @brief Gets bounds holding a tile from the control points of the surface, without tessellating it.
+    /// The skirts hang below them.
+    void get_tile_bounds(int tile_i, int tile_j, glm::vec3& min, glm::vec3& max) const;
+    /// @brief Gets the most memory the levels of a single tile can take
+    static size_t get_max_tile_memory();
+
+    /// @brief Tessellates every level of a tile, safe to call from several threads at once
+    LOD* create_tile(int tile_i, int tile_j) const;
+    /// @brief Tessellates every tile, spread over the global pool
+    std::vector<LOD*> create_tiles() const;
+};
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "TileCache.h"
+#include "../../Material.h"
+#include <algorithm>
+
+TileCache::TileCache(const BSplineSurface* surface, Shader* shader, glm::vec4 color, size_t memory_budget, unsigned thread_count)
+    : tiles(surface), shader(shader), color(color), memory_budget(memory_budget), thread_count(std::max(1u, thread_count)), pool(std::max(1u, thread_count))
+{
+    slots.resize(tiles.get_tile_count());
+    for (int index = 0; index < tiles.get_tile_count(); index++)
+    {
+        auto& slot = slots[index];
+        tiles.get_tile_bounds(index / tiles.get_tile_columns(), index % tiles.get_tile_columns(), slot.min, slot.max);
+        prefetch_distance = std::max({ prefetch_distance, slot.max.x - slot.min.x, slot.max.z - slot.min.z });
+    }
+}
+
+TileCache::~TileCache()
+{
+    pool.wait(jobs);
+    collect_finished();
+    for (auto& slot : slots)
+        delete slot.tile;
+}
+
+void TileCache::collect_finished()
+{
+    std::vector<std::pair<int, LOD*>> done;
+    {
+        std::lock_guard<std::mutex> lock(finished_mutex);
+        done.swap(finished);
+    }
+    for (auto [index, tile] : done)
+    {
+        tile->set_shader(shader);
+        tile->set_material(new ColorMaterial(color));
+        // Tiles are not in the world, they are drawn where they were tessellated
+        tile->set_render_matrix(glm::mat4(1.0f));
+        slots[index].tile = tile;
+        slots[index].queued = false;
+        memory += tile->get_memory();
+        queued--;
+        resident++;
+    }
+}
+
+bool TileCache::evict_oldest()
+{
+    TileSlot* oldest = nullptr;
+    for (auto& slot : slots)
+    {
+        if (slot.tile != nullptr && slot.last_visible < frame && (oldest == nullptr || slot.last_visible < oldest->last_visible))
+            oldest = &slot;
+    }
+    if (oldest == nullptr)
+        return false;
+    memory -= oldest->tile->get_memory();
+    delete oldest->tile;
+    oldest->tile = nullptr;
+    resident--;
+    return true;
+}
+
+bool TileCache::make_room(size_t size)
+{
+    while (memory + size > memory_budget)
+    {
+        if (!evict_oldest())
+            return false;
+    }
+    return true;
+}
+
+void TileCache::queue(int index)
+{
+    slots[index].queued = true;
+    queued++;
+    pool.submit([this, index]()
+        {
+            auto tile = tiles.create_tile(index / tiles.get_tile_columns(), index % tiles.get_tile_columns());
+            std::lock_guard<std::mutex> lock(finished_mutex);
+            finished.push_back({ index, tile });
+        }, jobs);
+}
+
+TileCounts TileCache::draw(Frustum* frustum, const glm::vec3& eye)
+{
+    collect_finished();
+    frame++;
+    TileCounts counts = { 0, 0, 0, 0, 0 };
+    missing.clear();
+    requests.clear();
+    for (int index = 0; index < static_cast<int>(slots.size()); index++)
+    {
+        auto& slot = slots[index];
+        AABB bounds;
+        if (slot.tile == nullptr || !slot.tile->get_render_bounds(bounds))
+            bounds = AABB((slot.min + slot.max) * 0.5f, (slot.max - slot.min) * 0.5f);
+        auto distance = glm::distance(eye, glm::clamp(eye, bounds.min, bounds.max));
+        if (!bounds.is_on_frustum(frustum))
+        {
+            if (slot.tile == nullptr && !slot.queued && distance <= prefetch_distance)
+                requests.push_back({ distance, index });
+            continue;
+        }
+        if (slot.tile == nullptr)
+        {
+            counts.missing++;
+            missing.push_back(bounds);
+            if (!slot.queued)
+                requests.push_back({ distance, index });
+            continue;
+        }
+        slot.last_visible = frame;
+        slot.tile->set_view_position(eye);
+        slot.tile->draw();
+        counts.drawn++;
+    }
+
+    // The budget may have been lowered
+    make_room(0);
+    // A queued tile is counted at the most a tile can take, so the budget still holds when it arrives
+    auto reserved = SurfaceTiles::get_max_tile_memory();
+    std::sort(requests.begin(), requests.end());
+    for (auto [distance, index] : requests)
+    {
+        if (queued >= thread_count * MAX_QUEUED_PER_THREAD || !make_room((queued + 1) * reserved))
+            break;
+        queue(index);
+    }
+
+    counts.queued = queued;
+    counts.resident = resident;
+    counts.memory = memory;
+    return counts;
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "SurfaceTiles.h"
+#include "../../threading/ThreadPool.h"
+#include <mutex>
+
+/// @brief Counts of the last TileCache::draw
+struct TileCounts
+{
+    unsigned drawn;
+    // Inside the frustum but not tessellated yet
+    unsigned missing;
+    unsigned queued;
+    unsigned resident;
+    size_t memory;
+};
+
+/// @brief Keeps the tiles of a BSplineSurface around the camera tessellated within a memory budget, so the surface never
+/// has to be tessellated whole. A tile is queued on the worker threads of the cache when it comes into view or within
+/// the prefetch distance of the camera, the closest tiles first. When a tile does not fit the budget the tiles that were
+/// visible the longest time ago are evicted, a tile visible in the current frame is never evicted.
+/// Everything but the tessellation runs on the thread that draws.
+class TileCache
+{
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = size_t(256) << 20;
+
+private:
+    // Tiles waiting for or being tessellated per worker thread, the queue is refilled every frame with the closest tiles
+    static constexpr unsigned MAX_QUEUED_PER_THREAD = 8;
+
+    struct TileSlot
+    {
+        LOD* tile = nullptr;
+        // Bounds from the control points, used until the tile is tessellated
+        glm::vec3 min;
+        glm::vec3 max;
+        unsigned long long last_visible = 0;
+        bool queued = false;
+    };
+
+    SurfaceTiles tiles;
+    Shader* shader;
+    glm::vec4 color;
+    std::vector<TileSlot> slots;
+    size_t memory_budget;
+    size_t memory = 0;
+    float prefetch_distance = 0.0f;
+    unsigned thread_count;
+    unsigned queued = 0;
+    unsigned resident = 0;
+    unsigned long long frame = 0;
+    std::vector<AABB> missing;
+    // Distance to the camera and index of the tiles to queue this frame
+    std::vector<std::pair<float, int>> requests;
+
+    ThreadPool pool;
+    JobCounter jobs;
+    std::mutex finished_mutex;
+    std::vector<std::pair<int, LOD*>> finished;
+
+    /// @brief Moves the tiles the workers finished into their slots
+    void collect_finished();
+    /// @brief Evicts the resident tile that was visible the longest time ago
+    /// @return false if every resident tile is visible in this frame
+    bool evict_oldest();
+    /// @brief Evicts tiles until size more bytes fit the budget
+    /// @return false if they do not fit without evicting a visible tile
+    bool make_room(size_t size);
+    void queue(int index);
+
+public:
+    /// @param shader The shader the tiles are drawn with
+    /// @param color The color of the material of every tile
+    /// @param thread_count The worker threads that tessellate, separate from the global pool so the simulation never waits on a tile
+    TileCache(const BSplineSurface* surface, Shader* shader, glm::vec4 color, size_t memory_budget = DEFAULT_MEMORY_BUDGET,
+        unsigned thread_count = std::max(1u, std::thread::hardware_concurrency() / 2));
+    ~TileCache();
+
+    TileCache(const TileCache&) = delete;
+    TileCache& operator=(const TileCache&) = delete;
+
+    void set_memory_budget(size_t memory_budget) { this->memory_budget = memory_budget; }
+    size_t get_memory_budget() const { return memory_budget; }
+    /// @brief Sets how close to the camera a tile outside the frustum is tessellated, it defaults to the size of a tile
+    void set_prefetch_distance(float distance) { prefetch_distance = distance; }
+    float get_prefetch_distance() const { return prefetch_distance; }
+
+    /// @brief Draws the resident tiles inside the frustum, queues the missing ones and evicts tiles over the budget
+    TileCounts draw(Frustum* frustum, const glm::vec3& eye);
+    /// @brief Gets the bounds of the tiles the last draw found missing
+    const std::vector<AABB>& get_missing() const { return missing; }
+};
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/// @brief Commands posted from any thread and run later by the thread that owns the state they change
+class CommandQueue
+{
+private:
+    std::mutex mutex;
+    std::vector<std::function<void()>> commands;
+    std::vector<std::function<void()>> running;
+
+public:
+    void post(std::function<void()> command)
+    {
+        std::lock_guard lock(mutex);
+        commands.push_back(std::move(command));
+    }
+
+    /// @brief Runs the commands posted so far in the order they were posted, commands posted meanwhile wait for the next call
+    /// @return The number of commands run
+    size_t run_all()
+    {
+        {
+            std::lock_guard lock(mutex);
+            running.swap(commands);
+        }
+        for (auto& command : running)
+            command();
+        auto count = running.size();
+        running.clear();
+        return count;
+    }
+};
\ No newline at end of file
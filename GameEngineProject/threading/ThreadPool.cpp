@@ -0,0 +1,150 @@
+#include "ThreadPool.h"
+
+namespace
+{
+    // Lets submit and run_one find the queue owned by the current worker
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local unsigned current_queue = 0;
+}
+
+ThreadPool::ThreadPool(unsigned thread_count)
+{
+    for (unsigned i = 0; i < thread_count + 1; i++)
+    {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (unsigned i = 0; i < thread_count; i++)
+    {
+        workers.emplace_back([this, i]()
+            { worker_loop(i + 1); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    sleep_condition.notify_all();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+unsigned ThreadPool::get_current_queue() const
+{
+    return current_pool == this ? current_queue : 0;
+}
+
+void ThreadPool::submit(std::function<void()> job, JobCounter& counter)
+{
+    counter.remaining++;
+    auto wrapped = [job = std::move(job), &counter]()
+    {
+        job();
+        counter.remaining--;
+    };
+    auto& queue = *queues[get_current_queue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(wrapped));
+    }
+    pending++;
+    {
+        // Taking the lock orders the notify after a worker that saw no work has started waiting
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    sleep_condition.notify_one();
+}
+
+bool ThreadPool::pop_local(unsigned index, std::function<void()>& job)
+{
+    auto& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty())
+        return false;
+    job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(unsigned thief, std::function<void()>& job)
+{
+    auto count = static_cast<unsigned>(queues.size());
+    for (unsigned offset = 1; offset < count; offset++)
+    {
+        auto& queue = *queues[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+            continue;
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::run_one()
+{
+    std::function<void()> job;
+    auto index = get_current_queue();
+    if (!pop_local(index, job) && !steal(index, job))
+        return false;
+    pending--;
+    job();
+    return true;
+}
+
+void ThreadPool::worker_loop(unsigned index)
+{
+    current_pool = this;
+    current_queue = index;
+    while (true)
+    {
+        if (run_one())
+            continue;
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleep_condition.wait(lock, [this]()
+            { return stopping || pending > 0; });
+        if (stopping)
+            return;
+    }
+}
+
+void ThreadPool::wait(JobCounter& counter)
+{
+    while (counter.remaining > 0)
+    {
+        if (!run_one())
+            std::this_thread::yield();
+    }
+}
+
+void ThreadPool::parallel_for(int begin, int end, int grain_size, const std::function<void(int, int)>& func)
+{
+    if (grain_size < 1)
+        grain_size = 1;
+    if (end - begin <= grain_size || workers.empty())
+    {
+        if (begin < end)
+            func(begin, end);
+        return;
+    }
+    JobCounter counter;
+    for (int chunk = begin; chunk < end; chunk += grain_size)
+    {
+        auto chunk_end = std::min(chunk + grain_size, end);
+        submit([&func, chunk, chunk_end]()
+            { func(chunk, chunk_end); },
+            counter);
+    }
+    wait(counter);
+}
+
+ThreadPool& ThreadPool::get_global()
+{
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// @brief Counts outstanding jobs so a caller can wait for a batch of work it submitted
+struct JobCounter
+{
+    std::atomic<int> remaining = 0;
+};
+
+/// @brief Work-stealing thread pool.
+/// Every worker owns a queue it pushes to and pops from at the back, idle workers steal from the front of the other queues.
+/// Threads that are not workers submit to a shared queue and help run jobs while they wait.
+class ThreadPool
+{
+private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    // Queue 0 is shared by non-worker threads, worker i owns queue i + 1
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<int> pending = 0;
+    std::atomic<bool> stopping = false;
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_condition;
+
+    void worker_loop(unsigned index);
+    bool pop_local(unsigned index, std::function<void()>& job);
+    bool steal(unsigned thief, std::function<void()>& job);
+    unsigned get_current_queue() const;
+
+public:
+    /// @brief Creates a pool
+    /// @param thread_count The number of worker threads, the calling thread is expected to help so one less than the core count is a good default
+    explicit ThreadPool(unsigned thread_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// @brief Queues a job and counts it on the counter until it has run
+    void submit(std::function<void()> job, JobCounter& counter);
+    /// @brief Runs queued jobs on the calling thread until every job counted by the counter has finished
+    void wait(JobCounter& counter);
+    /// @brief Runs a single queued job on the calling thread if there is one
+    /// @return true if a job was run
+    bool run_one();
+
+    /// @brief Splits [begin, end) into chunks of at most grain_size and runs func(chunk_begin, chunk_end) on the pool, returns when every chunk is done
+    void parallel_for(int begin, int end, int grain_size, const std::function<void(int, int)>& func);
+
+    /// @brief Gets the number of threads that run jobs, the workers plus the thread that waits
+    unsigned get_concurrency() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    /// @brief Gets the pool shared by the engine, sized from the hardware concurrency
+    static ThreadPool& get_global();
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+
+/// @brief Hands the newest value from one producer thread to one consumer thread without locks.
+/// Each side owns a slot and the third slot sits between them. The producer fills its slot and swaps it with the middle one,
+/// the consumer swaps its slot with the middle one when the middle holds something new. Neither side ever waits, the consumer
+/// always reads a complete value and skips the values it was too slow to see.
+template <typename T>
+class TripleBuffer
+{
+private:
+    // Set on the middle index when the producer swapped in a value the consumer has not taken yet
+    static constexpr unsigned FRESH = 4;
+
+    T slots[3];
+    std::atomic<unsigned> middle = 1;
+    unsigned back = 0;
+    unsigned front = 2;
+
+public:
+    /// @brief Gets the slot the producer writes, it holds an older value that has to be overwritten
+    T& get_back() { return slots[back]; }
+
+    /// @brief Makes the back slot the newest value, the producer continues in the slot that was in the middle
+    void publish()
+    {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+    }
+
+    /// @brief Takes the newest value if the producer published one since the last call
+    /// @return true if the front slot changed
+    bool acquire()
+    {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+        return true;
+    }
+
+    /// @brief Gets the slot the consumer reads, it stays the same until the next acquire
+    const T& get_front() const { return slots[front]; }
+};
\ No newline at end of file
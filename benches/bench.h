@@ -0,0 +1,25 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+/// @brief Timing helpers for the benchmark executables
+namespace bench
+{
+    /// @brief Gets the median time of one call of func in milliseconds, after a call that is not timed to warm the caches
+    template <typename F>
+    double median_ms(int runs, F&& func)
+    {
+        func();
+        std::vector<double> times;
+        for (int i = 0; i < runs; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            func();
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+};
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include "bench.h"
+#include "ecs/ecs_map.h"
+#include "ecs/components/physics.h"
+#include "ecs/components/transform.h"
+#include "ecs/system/physics.h"
+#include <cstdio>
+
+struct Position : BaseComponent
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+};
+
+struct Velocity : BaseComponent
+{
+    float x = 1.0f;
+    float y = 2.0f;
+    float z = 3.0f;
+};
+
+// Every other entity also gets a component the view does not ask for, so the stores are not all the same size
+static void fill(ECSGlobalMap& ecs, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        auto entity = ecs.create_entity();
+        ecs.insert(entity, Position());
+        ecs.insert(entity, Velocity());
+        ecs.insert(entity, TransformComponent(glm::vec3(float(i), 0.0f, 0.0f), glm::quat(1, 0, 0, 0), glm::vec3(1.0f)));
+        ecs.insert(entity, PhysicsComponent());
+    }
+}
+
+// Per tick cost of walking a two component view and of a physics tick on one thread
+int main()
+{
+    std::printf("%10s %14s %14s %14s\n", "entities", "view (ms)", "physics (ms)", "ns/entity");
+    for (int count : { 1000, 10000, 100000 })
+    {
+        ECSGlobalMap ecs;
+        fill(ecs, count);
+        auto view_time = bench::median_ms(51, [&ecs]()
+            {
+                for (auto [entity, position, velocity] : ecs.view<Position, Velocity>())
+                {
+                    position.x += velocity.x * 0.01f;
+                    position.y += velocity.y * 0.01f;
+                    position.z += velocity.z * 0.01f;
+                }
+            });
+        PhysicsSystem physics(&ecs, nullptr);
+        auto physics_time = bench::median_ms(51, [&physics]() { physics.update(1.0f / 60.0f); });
+        std::printf("%10d %14.4f %14.4f %14.2f\n", count, view_time, physics_time, physics_time * 1e6 / count);
+    }
+    return 0;
+}
\ No newline at end of file
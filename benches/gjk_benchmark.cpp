@@ -0,0 +1,95 @@
+#include "colliders/ConvexHull.h"
+#include "colliders/GJK.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+static std::vector<glm::vec3> random_blob(std::mt19937& random, int count, float radius)
+{
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<glm::vec3> points;
+    for (int i = 0; i < count; i++)
+    {
+        auto direction = glm::normalize(glm::vec3(normal(random), normal(random), normal(random)));
+        points.push_back(direction * radius * (0.8f + 0.2f * std::abs(normal(random))));
+    }
+    return points;
+}
+
+/// @brief Pairs of hulls that drift through each other a little further every tick, the motion the cache is meant for
+struct Scene
+{
+    std::vector<std::vector<glm::vec3>> shapes;
+    std::vector<std::unique_ptr<ConvexHull>> hulls;
+    std::vector<glm::vec3> starts;
+    std::vector<glm::vec3> velocities;
+
+    Scene(int pairs)
+    {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+        for (int i = 0; i < 2 * pairs; i++)
+        {
+            shapes.push_back(random_blob(random, 40, 1.0f));
+            hulls.push_back(std::make_unique<ConvexHull>(shapes.back(), nullptr));
+            starts.push_back(i % 2 == 0 ? glm::vec3(0.0f) : glm::vec3(-3.0f, offset(random), offset(random)));
+            velocities.push_back(i % 2 == 0 ? glm::vec3(0.0f) : glm::vec3(6.0f, offset(random), offset(random)));
+        }
+    }
+
+    void move(float t)
+    {
+        for (size_t i = 1; i < hulls.size(); i += 2)
+        {
+            auto points = shapes[i];
+            for (auto& point : points)
+                point += starts[i] + velocities[i] * t;
+            hulls[i]->set_points(points);
+        }
+    }
+};
+
+// Runs every pair through GJK on every tick, then through GJK and EPA, each with and without the simplex of the last tick
+int main()
+{
+    constexpr int PAIRS = 200;
+    constexpr int TICKS = 300;
+    Scene scene(PAIRS);
+    std::printf("%12s %8s %14s %14s %14s\n", "query", "cache", "GJK it/query", "EPA it/query", "us/query");
+    for (bool penetration : { false, true })
+    {
+        for (bool cached : { false, true })
+        {
+            GJK::Cache cache;
+            GJK::reset_stats();
+            double elapsed = 0.0;
+            for (int tick = 0; tick < TICKS; tick++)
+            {
+                scene.move(tick / float(TICKS));
+                cache.next_frame();
+                auto start = std::chrono::steady_clock::now();
+                for (unsigned pair = 0; pair < PAIRS; pair++)
+                {
+                    auto& a = *scene.hulls[2 * pair];
+                    auto& b = *scene.hulls[2 * pair + 1];
+                    auto simplex = cached ? cache.get(2 * pair, 2 * pair + 1) : nullptr;
+                    glm::vec3 normal;
+                    float depth;
+                    if (penetration)
+                        GJK::penetration(a, b, normal, depth, simplex);
+                    else
+                        GJK::intersects(a, b, simplex);
+                }
+                elapsed += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            }
+            auto stats = GJK::get_stats();
+            std::printf("%12s %8s %14.2f %14.2f %14.3f\n", penetration ? "penetration" : "intersects", cached ? "yes" : "no",
+                double(stats.iterations) / stats.queries, double(stats.epa_iterations) / stats.queries, elapsed / stats.queries);
+        }
+    }
+    std::printf("%d pairs over %d ticks\n", PAIRS, TICKS);
+    return 0;
+}
\ No newline at end of file
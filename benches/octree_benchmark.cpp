@@ -0,0 +1,77 @@
+#include "bench.h"
+#include "World.h"
+#include "collections/LinearOcTree.h"
+#include "collections/Octree.h"
+#include "objects/base/GameObject.h"
+#include "threading/ThreadPool.h"
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+static glm::vec3 get_position(GameObject* const& object)
+{
+    return object->get_component<TransformComponent>()->get_position();
+}
+
+// Builds both trees over the same objects and runs the same range queries on them.
+// The pointer tree is built by inserting one object at a time, the linear tree sorts all of them at once.
+int main()
+{
+    constexpr int QUERIES = 1000;
+    ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    std::printf("%10s %14s %14s %14s %14s %14s\n", "objects", "build (ms)", "linear (ms)", "linear pool", "query (ms)", "linear query");
+    for (int count : { 10000, 100000 })
+    {
+        World world;
+        std::mt19937 random(count);
+        std::uniform_real_distribution<float> spread(-100.0f, 100.0f);
+        std::vector<GameObject*> objects;
+        for (int i = 0; i < count; i++)
+        {
+            auto object = new GameObject();
+            world.insert(object, glm::vec3(spread(random), spread(random) * 0.1f, spread(random)));
+            objects.push_back(object);
+        }
+        std::vector<AABB> ranges;
+        std::uniform_real_distribution<float> size(1.0f, 10.0f);
+        for (int i = 0; i < QUERIES; i++)
+            ranges.push_back(AABB(glm::vec3(spread(random), 0.0f, spread(random)), glm::vec3(size(random))));
+
+        OcTree<GameObject*> tree;
+        tree.set_bounds(glm::vec3(0.0f), glm::vec3(100.0f));
+        auto build_time = bench::median_ms(5, [&tree, &objects]()
+            {
+                tree.clear();
+                for (auto object : objects)
+                    tree.insert(object);
+            });
+        LinearOcTree<GameObject*> linear(get_position);
+        linear.set_bounds(glm::vec3(0.0f), glm::vec3(100.0f));
+        auto linear_time = bench::median_ms(5, [&linear, &objects]() { linear.build(objects); });
+        LinearOcTree<GameObject*> parallel(get_position, &pool);
+        parallel.set_bounds(glm::vec3(0.0f), glm::vec3(100.0f));
+        auto parallel_time = bench::median_ms(5, [&parallel, &objects]() { parallel.build(objects); });
+
+        std::vector<GameObject*> found;
+        auto query_time = bench::median_ms(5, [&tree, &ranges, &found]()
+            {
+                for (auto& range : ranges)
+                {
+                    found.clear();
+                    tree.query_range(range, found);
+                }
+            });
+        auto linear_query_time = bench::median_ms(5, [&linear, &ranges, &found]()
+            {
+                for (auto& range : ranges)
+                {
+                    found.clear();
+                    linear.query_range(range, found);
+                }
+            });
+        std::printf("%10d %14.3f %14.3f %14.3f %14.3f %14.3f\n", count, build_time, linear_time, parallel_time, query_time, linear_query_time);
+    }
+    std::printf("query times are for %d range queries\n", QUERIES);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "bench.h"
+#include "ecs/ecs_map.h"
+#include "ecs/components/physics.h"
+#include "ecs/components/transform.h"
+#include "ecs/system/physics.h"
+#include <cstdio>
+
+#if defined(__AVX__)
+static const char* SIMD_PATH = "AVX";
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+static const char* SIMD_PATH = "SSE";
+#else
+static const char* SIMD_PATH = "scalar";
+#endif
+
+static void fill(ECSGlobalMap& ecs, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        auto entity = ecs.create_entity();
+        PhysicsComponent physics;
+        physics.velocity = glm::vec3(float(i % 7), float(i % 5), float(i % 3));
+        physics.mass = 1.0f + float(i % 4);
+        ecs.insert(entity, TransformComponent(glm::vec3(float(i), 0.0f, 0.0f), glm::quat(1, 0, 0, 0), glm::vec3(1.0f)));
+        ecs.insert(entity, physics);
+    }
+}
+
+// One tick of the integrator on one thread: the velocity kernel alone, with SIMD and without, and the whole physics system,
+// which also moves the positions in the transforms
+int main()
+{
+    constexpr float DELTA_TIME = 1.0f / 60.0f;
+    std::printf("kernel: %s\n", SIMD_PATH);
+    std::printf("%10s %14s %14s %14s %14s\n", "bodies", "kernel (ms)", "scalar (ms)", "tick (ms)", "ns/body");
+    for (int count : { 10000, 100000, 1000000 })
+    {
+        ECSGlobalMap ecs;
+        fill(ecs, count);
+        auto& bodies = *ecs.get<PhysicsComponent>();
+        auto kernel_time = bench::median_ms(21, [&bodies, count]() { PhysicsSystem::integrate(bodies, 0, count, DELTA_TIME, PhysicsSystem::GRAVITY); });
+        auto scalar_time = bench::median_ms(21, [&bodies, count]() { PhysicsSystem::integrate_scalar(bodies, 0, count, DELTA_TIME, PhysicsSystem::GRAVITY); });
+        PhysicsSystem physics(&ecs, nullptr);
+        auto tick_time = bench::median_ms(21, [&physics]() { physics.update(DELTA_TIME); });
+        std::printf("%10d %14.4f %14.4f %14.4f %14.2f\n", count, kernel_time, scalar_time, tick_time, tick_time * 1e6 / count);
+    }
+    return 0;
+}
\ No newline at end of file
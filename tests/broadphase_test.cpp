@@ -0,0 +1,190 @@
+#include "check.h"
+#include "colliders/DynamicAABBTree.h"
+#include "colliders/SpatialHashGrid.h"
+#include "colliders/SweepAndPrune.h"
+#include "threading/ThreadPool.h"
+#include <glm/vector_relational.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+struct Box
+{
+    Entity entity;
+    glm::vec3 min;
+    glm::vec3 max;
+    bool removed = false;
+};
+
+using PairSet = std::vector<std::pair<unsigned, unsigned>>;
+
+static std::vector<Box> make_boxes(unsigned count, float extent, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-extent, extent);
+    std::uniform_real_distribution<float> radius(0.5f, 1.0f);
+    std::vector<Box> boxes(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        auto center = glm::vec3(position(random), position(random), position(random));
+        auto r = glm::vec3(radius(random));
+        boxes[i] = { Entity::create(i, i % 3), center - r, center + r };
+    }
+    return boxes;
+}
+
+/// @brief Sorts the pairs with the lower id first so pair sets from different broadphases can be compared
+static PairSet normalize(const std::vector<BroadphasePair>& pairs)
+{
+    PairSet set;
+    for (auto& pair : pairs)
+        set.push_back(std::minmax(pair.a.id, pair.b.id));
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+static PairSet brute_force(const std::vector<Box>& boxes)
+{
+    PairSet set;
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        for (size_t j = i + 1; j < boxes.size(); j++)
+        {
+            auto& a = boxes[i];
+            auto& b = boxes[j];
+            if (a.removed || b.removed)
+                continue;
+            if (glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max)))
+                set.push_back(std::minmax(a.entity.id, b.entity.id));
+        }
+    }
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+static size_t count_duplicates(const PairSet& set)
+{
+    size_t duplicates = 0;
+    for (size_t i = 1; i < set.size(); i++)
+    {
+        if (set[i] == set[i - 1])
+            duplicates++;
+    }
+    return duplicates;
+}
+
+static bool contains_all(const PairSet& found, const PairSet& expected)
+{
+    return std::includes(found.begin(), found.end(), expected.begin(), expected.end());
+}
+
+/// @brief Checks a broadphase against brute force after inserting, moving and removing bodies
+/// @param conservative The broadphase may report extra pairs for moved bodies, like the tree stretching bounds ahead of a moving body
+static void matches_brute_force(Broadphase& broadphase, unsigned count, float extent, bool conservative)
+{
+    auto boxes = make_boxes(count, extent, 11);
+    for (auto& box : boxes)
+        broadphase.update(box.entity, box.min, box.max);
+
+    std::vector<BroadphasePair> pairs;
+    broadphase.find_pairs(pairs);
+    auto found = normalize(pairs);
+    CHECK(count_duplicates(found) == 0);
+    CHECK(found == brute_force(boxes));
+    CHECK(broadphase.size() == count);
+
+    // Move every third body and remove every seventh
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+    for (unsigned i = 0; i < count; i++)
+    {
+        auto& box = boxes[i];
+        if (i % 7 == 0)
+        {
+            box.removed = true;
+            broadphase.remove(box.entity);
+        }
+        else if (i % 3 == 0)
+        {
+            auto move = glm::vec3(offset(random), offset(random), offset(random));
+            box.min += move;
+            box.max += move;
+            broadphase.update(box.entity, box.min, box.max);
+        }
+    }
+    broadphase.remove(Entity::create(count + 10, 0));
+
+    broadphase.find_pairs(pairs);
+    found = normalize(pairs);
+    CHECK(count_duplicates(found) == 0);
+    if (conservative)
+        CHECK(contains_all(found, brute_force(boxes)));
+    else
+        CHECK(found == brute_force(boxes));
+    for (auto& pair : found)
+        CHECK(!boxes[Entity{ pair.first }.get_index()].removed && !boxes[Entity{ pair.second }.get_index()].removed);
+    CHECK(broadphase.size() == count - (count + 6) / 7);
+    std::printf("%s: %zu pairs\n", broadphase.get_name(), found.size());
+}
+
+/// @brief Checks that searching on a pool finds the same pairs as searching on the calling thread, each pair once
+static void parallel_matches_serial(Broadphase& serial, Broadphase& parallel, ThreadPool& pool, unsigned count, float extent)
+{
+    auto boxes = make_boxes(count, extent, 23);
+    // Two touching bodies far from the crowd end up as leaves near the root of the tree,
+    // so the search meets them while it is still splitting the work into tasks
+    auto far = glm::vec3(10.0f * extent);
+    boxes.push_back({ Entity::create(count, 0), far - glm::vec3(1.0f), far + glm::vec3(1.0f) });
+    boxes.push_back({ Entity::create(count + 1, 0), far, far + glm::vec3(2.0f) });
+    for (auto& box : boxes)
+    {
+        serial.update(box.entity, box.min, box.max);
+        parallel.update(box.entity, box.min, box.max);
+    }
+    parallel.set_pool(&pool);
+
+    std::vector<BroadphasePair> serial_pairs;
+    std::vector<BroadphasePair> parallel_pairs;
+    serial.find_pairs(serial_pairs);
+    parallel.find_pairs(parallel_pairs);
+    auto expected = normalize(serial_pairs);
+    auto found = normalize(parallel_pairs);
+    CHECK(parallel_pairs.size() == serial_pairs.size());
+    CHECK(count_duplicates(found) == 0);
+    CHECK(found == expected);
+    std::printf("%s on %u threads: %zu pairs\n", parallel.get_name(), pool.get_concurrency(), found.size());
+}
+
+int main()
+{
+    // Dense enough that most bodies touch a few others
+    for (unsigned count : { 2u, 100u, 3000u })
+    {
+        float extent = 2.0f * std::cbrt(static_cast<float>(count));
+        // The tree fattens its bounds by the margin, without one it reports exactly the overlapping bounds
+        DynamicAABBTree tree(0.0f);
+        SweepAndPrune sweep;
+        SpatialHashGrid grid;
+        matches_brute_force(tree, count, extent, true);
+        matches_brute_force(sweep, count, extent, false);
+        matches_brute_force(grid, count, extent, false);
+    }
+
+    // Above the size where the broadphases split the search across the pool
+    for (unsigned threads : { 1u, 2u, 3u, 7u })
+    {
+        ThreadPool pool(threads);
+        unsigned count = 5000;
+        float extent = 2.0f * std::cbrt(static_cast<float>(count));
+        DynamicAABBTree serial_tree(0.0f), parallel_tree(0.0f);
+        SweepAndPrune serial_sweep, parallel_sweep;
+        SpatialHashGrid serial_grid, parallel_grid;
+        parallel_matches_serial(serial_tree, parallel_tree, pool, count, extent);
+        parallel_matches_serial(serial_sweep, parallel_sweep, pool, count, extent);
+        parallel_matches_serial(serial_grid, parallel_grid, pool, count, extent);
+    }
+    return check::result();
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdio>
+
+/// @brief Minimal checks for the test executables, a failed check is printed and counted and the test keeps going
+namespace check
+{
+    inline int failures = 0;
+
+    inline void fail(const char* expression, const char* file, int line)
+    {
+        std::printf("%s:%d: check failed: %s\n", file, line, expression);
+        failures++;
+    }
+
+    /// @brief Gets the exit code of the test, prints a summary of the failed checks
+    inline int result()
+    {
+        if (failures != 0)
+            std::printf("%d check(s) failed\n", failures);
+        return failures == 0 ? 0 : 1;
+    }
+};
+
+#define CHECK(expression) ((expression) ? (void)0 : check::fail(#expression, __FILE__, __LINE__))
\ No newline at end of file
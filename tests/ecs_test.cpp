@@ -0,0 +1,144 @@
+#include "check.h"
+#include "ecs/ecs_map.h"
+
+struct Position : BaseComponent
+{
+    int value = 0;
+};
+
+struct Velocity : BaseComponent
+{
+    int value = 0;
+};
+
+static Position make_position(int value)
+{
+    Position position;
+    position.value = value;
+    return position;
+}
+
+static Velocity make_velocity(int value)
+{
+    Velocity velocity;
+    velocity.value = value;
+    return velocity;
+}
+
+// A handle kept after its entity was destroyed must not reach the entity that reuses the index
+static void stale_handle()
+{
+    ECSGlobalMap ecs;
+    auto old_entity = ecs.create_entity();
+    ecs.insert(old_entity, make_position(1));
+    ecs.destroy_entity(old_entity);
+
+    CHECK(!ecs.is_alive(old_entity));
+    CHECK(ecs.get<Position>(old_entity) == nullptr);
+
+    auto new_entity = ecs.create_entity();
+    CHECK(new_entity.get_index() == old_entity.get_index());
+    CHECK(new_entity.get_generation() == old_entity.get_generation() + 1);
+    CHECK(new_entity != old_entity);
+    CHECK(ecs.is_alive(new_entity));
+    CHECK(!ecs.is_alive(old_entity));
+
+    ecs.insert(new_entity, make_position(2));
+    CHECK(ecs.get<Position>(old_entity) == nullptr);
+    CHECK(ecs.get<Position>(new_entity) != nullptr && ecs.get<Position>(new_entity)->value == 2);
+
+    // Destroying through the stale handle leaves the new entity alone
+    ecs.destroy_entity(old_entity);
+    CHECK(ecs.is_alive(new_entity));
+    CHECK(ecs.get<Position>(new_entity) != nullptr);
+    CHECK(ecs.get_entity_count() == 1);
+}
+
+// The generation wraps after 256 reuses of an index, the handle still never becomes null
+static void generation_wraps()
+{
+    EntityRegistry registry;
+    auto first = registry.create();
+    auto entity = first;
+    for (int i = 0; i < 256; i++)
+    {
+        registry.destroy(entity);
+        entity = registry.create();
+        CHECK(!entity.is_null());
+        CHECK(entity.get_index() == first.get_index());
+    }
+    CHECK(entity.get_generation() == first.get_generation());
+    CHECK(!registry.is_alive(Entity::null()));
+}
+
+// Removing moves the last component into the hole, every remaining entity still finds its own component
+static void sparse_set_remove()
+{
+    ECSMap<Position> map;
+    Entity entities[8];
+    for (unsigned i = 0; i < 8; i++)
+    {
+        entities[i] = Entity::create(i * 3, 0);
+        map.insert(entities[i], make_position(static_cast<int>(i)));
+    }
+
+    map.remove(entities[2]);
+    map.remove(entities[0]);
+    map.remove(entities[7]);
+    map.remove(entities[2]);
+
+    CHECK(map.get_size() == 5);
+    for (unsigned i = 0; i < 8; i++)
+    {
+        bool removed = i == 0 || i == 2 || i == 7;
+        CHECK(map.contains(entities[i]) == !removed);
+        if (!removed)
+            CHECK(map.get(entities[i]) != nullptr && map.get(entities[i])->value == static_cast<int>(i));
+    }
+    for (int i = 0; i < map.get_size(); i++)
+    {
+        CHECK(map.get(map.get_id(i)) == map.get(i));
+    }
+
+    // Same index, other generation
+    CHECK(map.get(Entity::create(3, 1)) == nullptr);
+    // Past the end of the sparse array
+    CHECK(map.get(Entity::create(1000, 0)) == nullptr);
+}
+
+// A view only visits entities with every component
+static void view_matches()
+{
+    ECSGlobalMap ecs;
+    int expected = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        auto entity = ecs.create_entity();
+        ecs.insert(entity, make_position(i));
+        if (i % 3 == 0)
+        {
+            ecs.insert(entity, make_velocity(i));
+            expected += i;
+        }
+    }
+
+    int visited = 0;
+    int sum = 0;
+    for (auto [entity, position, velocity] : ecs.view<Position, Velocity>())
+    {
+        CHECK(position.value == velocity.value);
+        sum += position.value;
+        visited++;
+    }
+    CHECK(visited == 4);
+    CHECK(sum == expected);
+}
+
+int main()
+{
+    stale_handle();
+    generation_wraps();
+    sparse_set_remove();
+    view_matches();
+    return check::result();
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "check.h"
+#include "colliders/ColliderHandler.h"
+#include "colliders/ConvexHull.h"
+#include "colliders/GJK.h"
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static std::vector<glm::vec3> random_blob(std::mt19937& random, int count, float radius)
+{
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<glm::vec3> points;
+    for (int i = 0; i < count; i++)
+    {
+        auto direction = glm::normalize(glm::vec3(normal(random), normal(random), normal(random)));
+        points.push_back(direction * radius * (0.8f + 0.2f * std::abs(normal(random))));
+    }
+    return points;
+}
+
+static std::vector<glm::vec3> moved(const std::vector<glm::vec3>& points, const glm::vec3& offset)
+{
+    auto result = points;
+    for (auto& point : result)
+        point += offset;
+    return result;
+}
+
+// Two hulls drift past each other over many ticks, the answers must not depend on the simplex kept from the tick before
+static void cache_gives_same_results()
+{
+    std::mt19937 random(3);
+    auto shape_a = random_blob(random, 40, 1.0f);
+    auto shape_b = random_blob(random, 40, 1.2f);
+    ConvexHull a(shape_a, nullptr);
+    ConvexHull b(shape_b, nullptr);
+    GJK::Simplex intersect_cache;
+    GJK::Simplex penetration_cache;
+
+    uint64_t cached_iterations = 0;
+    uint64_t uncached_iterations = 0;
+    int overlapping = 0;
+    for (int tick = 0; tick < 400; tick++)
+    {
+        float t = tick / 400.0f;
+        b.set_points(moved(shape_b, glm::vec3(-3.0f + 6.0f * t, 0.3f * std::sin(t * 20.0f), 0.2f)));
+
+        GJK::reset_stats();
+        bool hit = GJK::intersects(a, b);
+        glm::vec3 normal(0.0f);
+        float depth = 0.0f;
+        bool penetrating = GJK::penetration(a, b, normal, depth);
+        uncached_iterations += GJK::get_stats().iterations;
+
+        GJK::reset_stats();
+        bool cached_hit = GJK::intersects(a, b, &intersect_cache);
+        glm::vec3 cached_normal(0.0f);
+        float cached_depth = 0.0f;
+        bool cached_penetrating = GJK::penetration(a, b, cached_normal, cached_depth, &penetration_cache);
+        cached_iterations += GJK::get_stats().iterations;
+
+        CHECK(hit == cached_hit);
+        CHECK(penetrating == cached_penetrating);
+        CHECK(hit == penetrating);
+        if (penetrating && cached_penetrating)
+        {
+            overlapping++;
+            CHECK(std::abs(depth - cached_depth) < 1e-3f);
+            CHECK(glm::dot(normal, cached_normal) > 0.999f);
+        }
+    }
+    CHECK(overlapping > 50 && overlapping < 350);
+    CHECK(cached_iterations <= uncached_iterations);
+    std::printf("GJK iterations over 800 queries: %llu without the cache, %llu with it\n",
+        static_cast<unsigned long long>(uncached_iterations), static_cast<unsigned long long>(cached_iterations));
+}
+
+// A pair that is not queried for a tick loses its simplex
+static void cache_forgets_unused_pairs()
+{
+    GJK::Cache cache;
+    cache.next_frame();
+    cache.get(1, 2)->size = 3;
+    cache.get(3, 4)->size = 2;
+    CHECK(cache.size() == 2);
+
+    cache.next_frame();
+    CHECK(cache.get(1, 2)->size == 3);
+    cache.next_frame();
+    CHECK(cache.size() == 1);
+    CHECK(cache.get(1, 2)->size == 3);
+    CHECK(cache.get(3, 4)->size == 0);
+}
+
+// Sphere and AABB pairs have dedicated tests and never hold a simplex
+static void only_convex_pairs_use_gjk()
+{
+    CHECK(!ColliderHandler::uses_gjk(SHAPE_SPHERE, SHAPE_SPHERE));
+    CHECK(!ColliderHandler::uses_gjk(SHAPE_SPHERE, SHAPE_AABB));
+    CHECK(!ColliderHandler::uses_gjk(SHAPE_AABB, SHAPE_AABB));
+    CHECK(ColliderHandler::uses_gjk(SHAPE_CONVEX, SHAPE_SPHERE));
+    CHECK(ColliderHandler::uses_gjk(SHAPE_AABB, SHAPE_CONVEX));
+    CHECK(ColliderHandler::uses_gjk(SHAPE_CONVEX, SHAPE_CONVEX));
+}
+
+int main()
+{
+    cache_gives_same_results();
+    cache_forgets_unused_pairs();
+    only_convex_pairs_use_gjk();
+    return check::result();
+}
\ No newline at end of file
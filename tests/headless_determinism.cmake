@@ -0,0 +1,22 @@
+# Steps the same world on pools of different sizes and sequentially, the final state hashes have to match.
+# Enough bodies that the broadphases split their pair search across the pool.
+# Usage: cmake -DHEADLESS=<path to GameEngineHeadless> -P headless_determinism.cmake
+set(ARGS --grid 100 --bodies 3000 --ticks 150 --hash)
+
+set(EXPECTED "")
+foreach(MODE "--threads;1" "--threads;2" "--threads;4" "--threads;8" "--sequential")
+  execute_process(COMMAND ${HEADLESS} ${ARGS} ${MODE} OUTPUT_VARIABLE OUTPUT RESULT_VARIABLE RESULT)
+  if (NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "${HEADLESS} ${MODE} failed: ${RESULT}\n${OUTPUT}")
+  endif()
+  string(REGEX MATCH "hash: [0-9a-f]+" HASH "${OUTPUT}")
+  if (HASH STREQUAL "")
+    message(FATAL_ERROR "${HEADLESS} ${MODE} printed no hash\n${OUTPUT}")
+  endif()
+  message(STATUS "${MODE}: ${HASH}")
+  if (EXPECTED STREQUAL "")
+    set(EXPECTED "${HASH}")
+  elseif (NOT HASH STREQUAL EXPECTED)
+    message(FATAL_ERROR "${MODE} gave ${HASH}, the first run gave ${EXPECTED}")
+  endif()
+endforeach()
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "check.h"
+#include "World.h"
+#include "collections/LinearOcTree.h"
+#include "collections/Octree.h"
+#include "objects/base/GameObject.h"
+#include "threading/ThreadPool.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+static glm::vec3 get_position(GameObject* const& object)
+{
+    return object->get_component<TransformComponent>()->get_position();
+}
+
+static std::vector<GameObject*> sorted(std::vector<GameObject*> objects)
+{
+    std::sort(objects.begin(), objects.end());
+    return objects;
+}
+
+static std::vector<GameObject*> brute_force(const std::vector<GameObject*>& objects, const AABB& bounds, const AABB& range, const Frustum* frustum)
+{
+    std::vector<GameObject*> found;
+    for (auto object : objects)
+    {
+        auto position = get_position(object);
+        if (bounds.contains(position) && range.contains(position) && (frustum == nullptr || frustum->contains(position)))
+            found.push_back(object);
+    }
+    return sorted(found);
+}
+
+static bool is_subset(const std::vector<GameObject*>& subset, const std::vector<GameObject*>& set)
+{
+    return std::includes(set.begin(), set.end(), subset.begin(), subset.end());
+}
+
+// A convex region standing in for a camera frustum, looking down +z from the origin and widening with distance
+static Frustum make_frustum()
+{
+    Frustum frustum;
+    frustum.near_face = Plane(glm::vec3(0.0f, 0.0f, -20.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    frustum.far_face = Plane(glm::vec3(0.0f, 0.0f, 30.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+    frustum.left_face = Plane(glm::vec3(0.0f, 0.0f, -40.0f), glm::vec3(1.0f, 0.0f, 0.5f));
+    frustum.right_face = Plane(glm::vec3(0.0f, 0.0f, -40.0f), glm::vec3(-1.0f, 0.0f, 0.5f));
+    frustum.bottom_face = Plane(glm::vec3(0.0f, 0.0f, -40.0f), glm::vec3(0.0f, 1.0f, 0.5f));
+    frustum.top_face = Plane(glm::vec3(0.0f, 0.0f, -40.0f), glm::vec3(0.0f, -1.0f, 0.5f));
+    return frustum;
+}
+
+// Both trees hold the same objects, some of them clustered so the cells split deep and some outside the bounds.
+// Every query has to find the objects a check of every object finds.
+static void matches_pointer_tree(ThreadPool* pool, int count)
+{
+    World world;
+    std::mt19937 random(count);
+    std::uniform_real_distribution<float> spread(-60.0f, 60.0f);
+    std::normal_distribution<float> cluster(10.0f, 0.5f);
+    std::vector<GameObject*> objects;
+    for (int i = 0; i < count; i++)
+    {
+        auto object = new GameObject();
+        auto position = i % 4 == 0 ? glm::vec3(cluster(random), cluster(random), cluster(random)) : glm::vec3(spread(random), spread(random), spread(random));
+        world.insert(object, position);
+        objects.push_back(object);
+    }
+
+    auto center = glm::vec3(0.0f);
+    auto extent = glm::vec3(50.0f);
+    OcTree<GameObject*> tree;
+    tree.set_bounds(center, extent);
+    LinearOcTree<GameObject*> linear(get_position, pool);
+    linear.set_bounds(center, extent);
+    for (auto object : objects)
+        tree.insert(object);
+    linear.build(objects);
+    auto bounds = linear.get_bounds();
+    CHECK(linear.size() == tree.size());
+    CHECK(linear.size() == brute_force(objects, bounds, bounds, nullptr).size());
+
+    std::uniform_real_distribution<float> corner(-55.0f, 55.0f);
+    std::uniform_real_distribution<float> size(0.5f, 30.0f);
+    for (int i = 0; i < 40; i++)
+    {
+        auto range = AABB(glm::vec3(corner(random), corner(random), corner(random)), glm::vec3(size(random), size(random), size(random)));
+        auto expected = brute_force(objects, bounds, range, nullptr);
+        std::vector<GameObject*> from_tree, from_linear;
+        tree.query_range(range, from_tree);
+        linear.query_range(range, from_linear);
+        CHECK(sorted(from_linear) == expected);
+        CHECK(sorted(from_tree) == expected);
+    }
+
+    // Cells outside the frustum are skipped, the items of the cells left are only tested against the range, so the result
+    // is every object in the range and the frustum and possibly more of the range
+    auto frustum = make_frustum();
+    auto range = AABB(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(40.0f));
+    auto in_range = brute_force(objects, bounds, range, nullptr);
+    auto in_both = brute_force(objects, bounds, range, &frustum);
+    std::vector<GameObject*> culled_linear, culled_tree;
+    linear.query_range(range, culled_linear, &frustum);
+    tree.query_range(range, culled_tree, &frustum);
+    CHECK(is_subset(in_both, sorted(culled_linear)));
+    CHECK(is_subset(sorted(culled_linear), in_range));
+    CHECK(is_subset(in_both, sorted(culled_tree)));
+
+    std::vector<GameObject*> visible_linear, visible_tree;
+    linear.query(visible_linear, &frustum);
+    tree.query<GameObject*>(visible_tree, &frustum, [](GameObject* const object) { return get_position(object); });
+    auto expected_visible = brute_force(objects, bounds, bounds, &frustum);
+    CHECK(sorted(visible_linear) == expected_visible);
+    CHECK(sorted(visible_tree) == expected_visible);
+
+    // get_node finds an object by predicate whichever cell it is in, and nothing for objects outside the bounds
+    for (int i = 0; i < count; i += count / 16 + 1)
+    {
+        auto target = objects[i];
+        auto predicate = [target](GameObject* object) { return object == target; };
+        auto inside = bounds.contains(get_position(target));
+        CHECK(linear.get_node(predicate) == (inside ? target : nullptr));
+        CHECK(tree.get_node(predicate) == (inside ? target : nullptr));
+    }
+    CHECK(linear.get_node([](GameObject*) { return false; }) == nullptr);
+}
+
+int main()
+{
+    ThreadPool pool(3);
+    matches_pointer_tree(nullptr, 1);
+    matches_pointer_tree(nullptr, 500);
+    // Large enough for the build to sort on the pool
+    matches_pointer_tree(&pool, 40000);
+    return check::result();
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "check.h"
+#include "ecs/ecs_map.h"
+#include "ecs/components/physics.h"
+#include "ecs/components/transform.h"
+#include "ecs/system/physics.h"
+#include <cmath>
+#include <vector>
+
+static PhysicsComponent make_body(int i)
+{
+    PhysicsComponent physics;
+    physics.velocity = glm::vec3(float(i % 7) - 3.0f, float(i % 5) * 0.5f, float(i % 3) - 1.0f);
+    physics.acceleration = glm::vec3(0.0f, float(i % 2), 0.0f);
+    physics.mass = 1.0f + float(i % 4);
+    physics.dragCoefficient = 0.05f * float(i % 3);
+    return physics;
+}
+
+// The SIMD kernel has to give exactly the results of the scalar one, including the tail that does not fill a register
+static void simd_matches_scalar()
+{
+    constexpr int COUNT = 37;
+    ECSGlobalMap simd;
+    ECSGlobalMap scalar;
+    for (int i = 0; i < COUNT; i++)
+    {
+        simd.insert(simd.create_entity(), make_body(i));
+        scalar.insert(scalar.create_entity(), make_body(i));
+    }
+    // A nan drag is skipped instead of spreading into the velocity
+    simd.get<PhysicsComponent>()->drag[5] = NAN;
+    scalar.get<PhysicsComponent>()->drag[5] = NAN;
+
+    auto& a = *simd.get<PhysicsComponent>();
+    auto& b = *scalar.get<PhysicsComponent>();
+    PhysicsSystem::integrate(a, 0, COUNT, 1.0f / 60.0f, PhysicsSystem::GRAVITY);
+    PhysicsSystem::integrate_scalar(b, 0, COUNT, 1.0f / 60.0f, PhysicsSystem::GRAVITY);
+    for (unsigned i = 0; i < COUNT; i++)
+    {
+        CHECK(a.get_velocity(i) == b.get_velocity(i));
+        CHECK(a.get_acceleration(i) == glm::vec3(0.0f));
+        CHECK(!std::isnan(a.velocity_x[i]));
+    }
+}
+
+// Removing a body moves the last one into its slot, the moved body keeps its state and is found by its entity
+static void remove_moves_last()
+{
+    ECSGlobalMap ecs;
+    auto first = ecs.create_entity();
+    auto second = ecs.create_entity();
+    auto third = ecs.create_entity();
+    ecs.insert(first, make_body(1));
+    ecs.insert(second, make_body(2));
+    ecs.insert(third, make_body(3));
+    ecs.destroy_entity(first);
+
+    auto& bodies = *ecs.get<PhysicsComponent>();
+    CHECK(bodies.get_size() == 2);
+    CHECK(!bodies.contains(first));
+    auto slot = bodies.find(third);
+    CHECK(slot == 0);
+    CHECK(bodies.get_velocity(slot) == make_body(3).velocity);
+    CHECK(bodies.mass[slot] == make_body(3).mass);
+}
+
+// A force wakes a sleeping body, the integrator picks it up again
+static void force_wakes()
+{
+    ECSGlobalMap ecs;
+    auto entity = ecs.create_entity();
+    auto body = make_body(0);
+    body.sleeping = true;
+    body.rest_time = 1.0f;
+    ecs.insert(entity, body);
+
+    auto& bodies = *ecs.get<PhysicsComponent>();
+    auto slot = bodies.find(entity);
+    bodies.apply_force(slot, glm::vec3(0.0f));
+    CHECK(bodies.is_sleeping(slot));
+    bodies.apply_force(slot, glm::vec3(1.0f, 0.0f, 0.0f));
+    slot = bodies.find(entity);
+    CHECK(!bodies.is_sleeping(slot));
+    CHECK(bodies.rest_time[slot] == 0.0f);
+}
+
+// Awake bodies stay in front of the sleeping ones through inserts, removes and changes of sleep state,
+// and the integrator leaves the sleeping ones alone
+static void awake_bodies_first()
+{
+    ECSGlobalMap ecs;
+    PhysicsSystem physics(&ecs, nullptr);
+    std::vector<Entity> entities;
+    for (int i = 0; i < 20; i++)
+    {
+        auto body = make_body(i);
+        body.sleeping = i % 3 == 0;
+        entities.push_back(ecs.create_entity());
+        ecs.insert(entities.back(), TransformComponent(glm::vec3(float(i)), glm::quat(1, 0, 0, 0), glm::vec3(1.0f)));
+        ecs.insert(entities.back(), body);
+    }
+    auto& bodies = *ecs.get<PhysicsComponent>();
+    CHECK(bodies.get_awake_count() == 13);
+
+    bodies.set_sleeping(bodies.find(entities[1]), true);
+    bodies.set_sleeping(bodies.find(entities[3]), false);
+    ecs.destroy_entity(entities[4]);
+    ecs.destroy_entity(entities[6]);
+    CHECK(bodies.get_awake_count() == 12);
+    CHECK(bodies.get_size() == 18);
+
+    std::vector<glm::vec3> velocities;
+    for (int i = 0; i < 20; i++)
+    {
+        auto slot = bodies.find(entities[i]);
+        CHECK((slot == PhysicsStore::INVALID) == (i == 4 || i == 6));
+        if (slot == PhysicsStore::INVALID)
+        {
+            velocities.push_back(glm::vec3(0.0f));
+            continue;
+        }
+        auto asleep = i == 1 || (i % 3 == 0 && i != 3 && i != 6);
+        CHECK(bodies.is_sleeping(slot) == asleep);
+        CHECK(bodies.get_entity(slot) == entities[i]);
+        CHECK(bodies.mass[slot] == make_body(i).mass);
+        velocities.push_back(bodies.get_velocity(slot));
+    }
+
+    physics.update(1.0f / 60.0f);
+    for (int i = 0; i < 20; i++)
+    {
+        auto slot = bodies.find(entities[i]);
+        if (slot == PhysicsStore::INVALID)
+            continue;
+        auto moved = ecs.get<TransformComponent>(entities[i])->position != glm::vec3(float(i));
+        CHECK(moved == !bodies.is_sleeping(slot));
+        CHECK((bodies.get_velocity(slot) != velocities[i]) == !bodies.is_sleeping(slot));
+    }
+}
+
+int main()
+{
+    simd_matches_scalar();
+    remove_moves_last();
+    force_wakes();
+    awake_bodies_first();
+    return check::result();
+}
\ No newline at end of file
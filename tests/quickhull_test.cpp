@@ -0,0 +1,74 @@
+#include "check.h"
+#include "colliders/QuickHull.h"
+#include <random>
+#include <vector>
+#include <glm/geometric.hpp>
+
+static std::vector<glm::vec3> random_points(unsigned seed, int count)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<glm::vec3> points;
+    for (int i = 0; i < count; i++)
+        points.push_back(glm::vec3(unit(random), unit(random), unit(random)));
+    return points;
+}
+
+// Every point lies behind or on every face of the hull
+static bool encloses(const QuickHull::Hull& hull, const std::vector<glm::vec3>& points)
+{
+    for (size_t i = 0; i < hull.indices.size(); i += 3)
+    {
+        auto& a = hull.points[hull.indices[i]];
+        auto& b = hull.points[hull.indices[i + 1]];
+        auto& c = hull.points[hull.indices[i + 2]];
+        auto normal = glm::normalize(glm::cross(b - a, c - a));
+        for (auto& point : points)
+        {
+            if (glm::dot(point - a, normal) > 1e-4f)
+                return false;
+        }
+    }
+    return true;
+}
+
+// The same points and cap share one hull, anything else gets its own
+static void cache_compares_inputs()
+{
+    auto points = random_points(1, 500);
+    auto first = QuickHull::get_cached(points, 0);
+    auto second = QuickHull::get_cached(points, 0);
+    CHECK(first == second);
+    CHECK(encloses(*first, points));
+
+    auto capped = QuickHull::get_cached(points, 8);
+    CHECK(capped != first);
+    CHECK(capped->points.size() <= 8);
+
+    auto moved = points;
+    moved[17].x += 0.5f;
+    auto other = QuickHull::get_cached(moved, 0);
+    CHECK(other != first);
+    CHECK(encloses(*other, moved));
+}
+
+// Once nobody holds a hull the cache lets it go and builds it again on the next call
+static void cache_releases_hulls()
+{
+    auto points = random_points(2, 200);
+    std::weak_ptr<const QuickHull::Hull> released;
+    {
+        auto hull = QuickHull::get_cached(points, 0);
+        released = hull;
+    }
+    CHECK(released.expired());
+    auto rebuilt = QuickHull::get_cached(points, 0);
+    CHECK(rebuilt != nullptr && encloses(*rebuilt, points));
+}
+
+int main()
+{
+    cache_compares_inputs();
+    cache_releases_hulls();
+    return check::result();
+}
\ No newline at end of file
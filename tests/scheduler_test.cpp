@@ -0,0 +1,151 @@
+#include "check.h"
+#include "ecs/ecs_map.h"
+#include "ecs/system/scheduler.h"
+#include "threading/ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+struct Position : BaseComponent
+{
+    int value = 0;
+};
+
+struct Velocity : BaseComponent
+{
+    int value = 0;
+};
+
+struct Score : BaseComponent
+{
+    int value = 0;
+};
+
+static std::atomic<int> clock_ticks;
+
+/// @brief Records when it ran, then applies a step to the components it declared
+class RecordingSystem : public BaseSystem
+{
+public:
+    const char* name;
+    int started = -1;
+    int finished = -1;
+    std::function<void(ECSGlobalMap&)> step;
+
+    RecordingSystem(ECSGlobalMap* ecs, const char* name, std::function<void(ECSGlobalMap&)> step) : BaseSystem(ecs, nullptr), name(name), step(std::move(step)) {}
+
+    template <typename T>
+    RecordingSystem* reads() { reads_component<T>(); return this; }
+    template <typename T>
+    RecordingSystem* writes() { writes_component<T>(); return this; }
+
+    void update(float delta_time) override
+    {
+        started = clock_ticks++;
+        // Gives the systems that do not wait on this one a chance to overlap it
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        step(*get_ecs());
+        finished = clock_ticks++;
+    }
+
+    const char* get_name() const override { return name; }
+};
+
+static void fill(ECSGlobalMap& ecs)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        auto entity = ecs.create_entity();
+        ecs.insert(entity, Position());
+        ecs.insert(entity, Velocity());
+        ecs.insert(entity, Score());
+    }
+}
+
+struct Pipeline
+{
+    RecordingSystem* accelerate;
+    RecordingSystem* move;
+    RecordingSystem* score;
+    RecordingSystem* observe;
+};
+
+// accelerate writes Velocity, move reads it and writes Position, score reads Position, observe only reads Velocity
+static Pipeline add_pipeline(SystemScheduler& scheduler, ECSGlobalMap& ecs)
+{
+    Pipeline pipeline;
+    pipeline.accelerate = (new RecordingSystem(&ecs, "accelerate", [](ECSGlobalMap& ecs)
+        { for (auto [entity, velocity] : ecs.view<Velocity>()) velocity.value += 2; }))->writes<Velocity>();
+    pipeline.move = (new RecordingSystem(&ecs, "move", [](ECSGlobalMap& ecs)
+        { for (auto [entity, position, velocity] : ecs.view<Position, Velocity>()) position.value += velocity.value; }))->reads<Velocity>()->writes<Position>();
+    pipeline.score = (new RecordingSystem(&ecs, "score", [](ECSGlobalMap& ecs)
+        { for (auto [entity, score, position] : ecs.view<Score, Position>()) score.value = score.value * 3 + position.value; }))->reads<Position>()->writes<Score>();
+    pipeline.observe = (new RecordingSystem(&ecs, "observe", [](ECSGlobalMap& ecs)
+        { for (auto [entity, velocity] : ecs.view<Velocity>()) (void)velocity; }))->reads<Velocity>();
+    scheduler.add(pipeline.accelerate);
+    scheduler.add(pipeline.move);
+    scheduler.add(pipeline.score);
+    scheduler.add(pipeline.observe);
+    return pipeline;
+}
+
+static long long checksum(ECSGlobalMap& ecs)
+{
+    long long sum = 0;
+    for (auto [entity, position, velocity, score] : ecs.view<Position, Velocity, Score>())
+        sum = sum * 31 + position.value * 7 + velocity.value * 5 + score.value;
+    return sum;
+}
+
+// A system starts only after every earlier system it conflicts with has finished
+static void respects_dependencies()
+{
+    ThreadPool pool(3);
+    ECSGlobalMap ecs;
+    fill(ecs);
+    SystemScheduler scheduler(&pool);
+    auto pipeline = add_pipeline(scheduler, ecs);
+
+    for (int tick = 0; tick < 5; tick++)
+    {
+        scheduler.run(0.016f);
+        CHECK(pipeline.move->started > pipeline.accelerate->finished);
+        CHECK(pipeline.score->started > pipeline.move->finished);
+        CHECK(pipeline.observe->started > pipeline.accelerate->finished);
+    }
+
+    CHECK(!pipeline.accelerate->conflicts_with(*pipeline.score));
+    CHECK(!pipeline.move->conflicts_with(*pipeline.observe));
+    CHECK(pipeline.accelerate->conflicts_with(*pipeline.observe));
+    CHECK(scheduler.get_timings().size() == 4);
+}
+
+// Running on the pool gives the same components as running the systems one after another
+static void matches_sequential()
+{
+    ThreadPool pool(3);
+    ECSGlobalMap parallel_ecs;
+    ECSGlobalMap sequential_ecs;
+    fill(parallel_ecs);
+    fill(sequential_ecs);
+
+    SystemScheduler parallel(&pool);
+    SystemScheduler sequential(&pool);
+    add_pipeline(parallel, parallel_ecs);
+    add_pipeline(sequential, sequential_ecs);
+    sequential.set_parallel(false);
+
+    for (int tick = 0; tick < 10; tick++)
+    {
+        parallel.run(0.016f);
+        sequential.run(0.016f);
+    }
+    CHECK(checksum(parallel_ecs) == checksum(sequential_ecs));
+}
+
+int main()
+{
+    respects_dependencies();
+    matches_sequential();
+    return check::result();
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "check.h"
+#include "objects/curves/BSplineSurface.h"
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// Rolling hills on a 40 by 40 grid of control points one unit apart
+static std::unique_ptr<BSplineSurface> make_surface(bool tessellate)
+{
+    const int size = 40;
+    std::vector<glm::vec3> points;
+    for (int z = 0; z < size; z++)
+    {
+        for (int x = 0; x < size; x++)
+            points.push_back(glm::vec3(float(x), 2.0f * std::sin(x * 0.3f) * std::cos(z * 0.2f), float(z)));
+    }
+    auto knot_vector = BSpline<glm::vec3>::get_knot_vector(size - 1);
+    return std::make_unique<BSplineSurface>(2, 2, size, size, knot_vector, knot_vector, points, 0.1f, tessellate);
+}
+
+// A surface without a mesh still stops fast spheres, close to where the mesh of the same surface stops them
+static void exact_sweep_matches_mesh()
+{
+    auto meshed = make_surface(true);
+    auto exact = make_surface(false);
+    CHECK(!meshed->get_heightfield().empty());
+    CHECK(exact->get_heightfield().empty());
+
+    int hits = 0;
+    for (int i = 0; i < 50; i++)
+    {
+        auto x = 5.0f + 0.53f * i;
+        auto z = 30.0f - 0.41f * i;
+        // Falls and drifts sideways far more than its radius in one step
+        auto start = glm::vec3(x, 8.0f, z);
+        auto end = glm::vec3(x + 1.5f, -8.0f, z - 0.7f);
+        float radius = 0.3f;
+
+        float mesh_time, exact_time;
+        glm::vec3 mesh_normal, exact_normal;
+        bool mesh_hit = meshed->sweep_sphere(start, end, radius, mesh_time, mesh_normal);
+        bool exact_hit = exact->sweep_sphere(start, end, radius, exact_time, exact_normal);
+        CHECK(mesh_hit);
+        CHECK(exact_hit);
+        if (!mesh_hit || !exact_hit)
+            continue;
+        hits++;
+        // The mesh cuts corners of the surface by at most a few hundredths of a unit at this spacing
+        auto distance = glm::length(end - start);
+        CHECK(std::abs(mesh_time - exact_time) * distance < 0.05f);
+        CHECK(glm::dot(mesh_normal, exact_normal) > 0.95f);
+
+        // The sphere is above the exact surface where the sweep stops it
+        auto center = glm::mix(start, end, exact_time);
+        auto [height, normal] = exact->get_exact_y_at(center);
+        CHECK(center.y > height);
+    }
+    std::printf("%d of 50 sweeps hit both surfaces\n", hits);
+}
+
+static void exact_sweep_misses()
+{
+    auto exact = make_surface(false);
+    float time;
+    glm::vec3 normal;
+    // Stays high above the hills
+    CHECK(!exact->sweep_sphere(glm::vec3(5.0f, 10.0f, 5.0f), glm::vec3(30.0f, 9.0f, 30.0f), 0.5f, time, normal));
+    // Already touching the surface at the start, left to the discrete tests
+    auto [height, up] = exact->get_exact_y_at(glm::vec3(10.0f, 0.0f, 10.0f));
+    CHECK(!exact->sweep_sphere(glm::vec3(10.0f, height, 10.0f), glm::vec3(10.0f, height - 5.0f, 10.0f), 0.5f, time, normal));
+    // Outside the surface
+    CHECK(!exact->sweep_sphere(glm::vec3(-20.0f, 5.0f, -20.0f), glm::vec3(-20.0f, -5.0f, -20.0f), 0.5f, time, normal));
+}
+
+int main()
+{
+    exact_sweep_matches_mesh();
+    exact_sweep_misses();
+    return check::result();
+}
\ No newline at end of file